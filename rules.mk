@@ -3,12 +3,13 @@ MAKEFLAGS += -r
 Dependency_file = $(addprefix target/dependencies/,$(addsuffix .mk,$(subst /,.,$(basename $(1)))))
 Object_file = $(addprefix target/object_files/,$(addsuffix .o,$(subst /,.,$(basename $(1)))))
 Executable_file = $(addprefix target/bin/,$(addsuffix ,$(subst /,.,$(basename $(1)))))
+Library_file = $(addprefix target/lib/lib,$(addsuffix .a,$(1)))
 Manpage = $(addprefix target/manpages/,$(1))
 
 clean:
 	@rm -rfv target
 
-target target/object_files target/dependencies target/bin target/coverage target/manpages:
+target target/object_files target/dependencies target/bin target/lib target/coverage target/manpages:
 	@mkdir -p $@
 
 define Variable_rule # target_file, string_value
@@ -29,6 +30,9 @@ $(call Object_file,%): src/%.cpp target/compile_flags | target/object_files targ
 $(call Executable_file,%): target/link_flags | target/bin
 	$(CXX) -o $@ $(LDFLAGS) $(wordlist 2,$(words $^),$^) $(LDLIBS)
 
+$(call Library_file,%): | target/lib
+	$(AR) rcs $@ $^
+
 coverage: CXXFLAGS += --coverage -fno-elide-constructors -fno-default-inline
 coverage: LDFLAGS += --coverage
 coverage: test | target/coverage
@@ -0,0 +1,92 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <bit>
+#include <vector>
+
+/*!
+ * A bit set with a size determined at runtime.
+ */
+struct Bitset
+{
+	Bitset() = default;
+	
+	explicit Bitset(std::ptrdiff_t size)
+		:
+		words_((size + 63) / 64),
+		size_(size)
+	{
+	}
+	
+	[[nodiscard]] std::ptrdiff_t size() const noexcept
+	{
+		return size_;
+	}
+	
+	[[nodiscard]] bool test(std::ptrdiff_t index) const noexcept
+	{
+		return (words_[index / 64] >> (index % 64)) & 1;
+	}
+	
+	void set(std::ptrdiff_t index) noexcept
+	{
+		words_[index / 64] |= std::uint64_t(1) << (index % 64);
+	}
+	
+	/*!
+	 * @return The index of the first set bit or the size if no bit is set.
+	 */
+	[[nodiscard]] std::ptrdiff_t find_first() const noexcept
+	{
+		for (std::size_t i = 0; i != words_.size(); ++i)
+		{
+			if (words_[i] != 0)
+			{
+				return std::ptrdiff_t(i * 64) + std::countr_zero(words_[i]);
+			}
+		}
+		
+		return size_;
+	}
+	
+	[[nodiscard]] std::ptrdiff_t count() const noexcept
+	{
+		auto result = std::ptrdiff_t(0);
+		
+		for (auto word : words_)
+		{
+			result += std::popcount(word);
+		}
+		
+		return result;
+	}
+	
+	[[nodiscard]] bool any() const noexcept
+	{
+		return std::ranges::any_of(words_, [](std::uint64_t word) noexcept -> bool {return word != 0;});
+	}
+	
+	[[nodiscard]] bool all() const noexcept
+	{
+		return count() == size_;
+	}
+	
+	Bitset& operator|=(const Bitset& other) noexcept
+	{
+		for (std::size_t i = 0; i != words_.size(); ++i)
+		{
+			words_[i] |= other.words_[i];
+		}
+		
+		return *this;
+	}
+	
+	bool operator==(const Bitset& other) const = default;
+	
+private:
+	std::vector<std::uint64_t> words_;
+	std::ptrdiff_t size_ = 0;
+};
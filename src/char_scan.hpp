@@ -0,0 +1,442 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <string_view>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define JURAND_CHAR_SCAN_X86 1
+#endif
+
+/*!
+ * Classification of bytes of Java source code and scanning for the next byte of
+ * a class. Equivalent to the "C" locale versions of std::isspace and
+ * std::ispunct, but does not depend on the current locale.
+ */
+namespace char_scan
+{
+enum Char_class : std::uint8_t
+{
+	whitespace = 1 << 0,
+	identifier = 1 << 1,
+	quote = 1 << 2,
+	backslash = 1 << 3,
+	slash = 1 << 4,
+	at_sign = 1 << 5,
+	parenthesis = 1 << 6,
+	newline = 1 << 7,
+};
+
+inline constexpr auto classes = []() noexcept -> std::array<std::uint8_t, 256>
+{
+	auto result = std::array<std::uint8_t, 256>();
+	
+	for (int c = 0; c != 256; ++c)
+	{
+		bool is_space = c == ' ' or (c >= '\t' and c <= '\r');
+		bool is_punct = (c >= 33 and c <= 47) or (c >= 58 and c <= 64) or (c >= 91 and c <= 96) or (c >= 123 and c <= 126);
+		
+		if (is_space)
+		{
+			result[c] |= whitespace;
+		}
+		
+		if (c == '_' or (not is_punct and not is_space))
+		{
+			result[c] |= identifier;
+		}
+	}
+	
+	result['"'] |= quote;
+	result['\''] |= quote;
+	result['\\'] |= backslash;
+	result['/'] |= slash;
+	result['@'] |= at_sign;
+	result['('] |= parenthesis;
+	result[')'] |= parenthesis;
+	result['\n'] |= newline;
+	
+	return result;
+}();
+
+[[nodiscard]] inline bool is_a(char c, std::uint8_t mask) noexcept
+{
+	return classes[static_cast<unsigned char>(c)] & mask;
+}
+
+using Scanner = std::ptrdiff_t(const char* data, std::ptrdiff_t position, std::ptrdiff_t size) noexcept;
+
+/*!
+ * Portable implementation, finds the first byte starting at @p position which
+ * belongs to a class of @p Mask or, if @p Negated, does not belong to any of
+ * them.
+ * 
+ * @return The position of the byte or @p size if not found.
+ */
+template<std::uint8_t Mask, bool Negated>
+std::ptrdiff_t find_scalar(const char* data, std::ptrdiff_t position, std::ptrdiff_t size) noexcept
+{
+	while (position != size and is_a(data[position], Mask) == Negated)
+	{
+		++position;
+	}
+	
+	return position;
+}
+
+#ifdef JURAND_CHAR_SCAN_X86
+/*!
+ * @return A vector with bytes of all bits set where the byte of @p v is in
+ * the inclusive range [@p low, @p high].
+ */
+inline __m128i in_range_sse2(__m128i v, char low, char high) noexcept
+{
+	auto shifted = _mm_sub_epi8(v, _mm_set1_epi8(low));
+	return _mm_cmpeq_epi8(_mm_min_epu8(shifted, _mm_set1_epi8(static_cast<char>(high - low))), shifted);
+}
+
+template<std::uint8_t Mask>
+__m128i classify_sse2(__m128i v) noexcept
+{
+	auto result = _mm_setzero_si128();
+	
+	if constexpr ((Mask & (whitespace | identifier)) != 0)
+	{
+		auto space = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(' ')), in_range_sse2(v, '\t', '\r'));
+		
+		if constexpr ((Mask & whitespace) != 0)
+		{
+			result = _mm_or_si128(result, space);
+		}
+		
+		if constexpr ((Mask & identifier) != 0)
+		{
+			auto punct = _mm_or_si128(_mm_or_si128(in_range_sse2(v, 33, 47), in_range_sse2(v, 58, 64)),
+				_mm_or_si128(_mm_or_si128(in_range_sse2(v, 91, 94), _mm_cmpeq_epi8(v, _mm_set1_epi8(96))), in_range_sse2(v, 123, 126)));
+			result = _mm_or_si128(result, _mm_andnot_si128(_mm_or_si128(space, punct), _mm_set1_epi8(-1)));
+		}
+	}
+	
+	if constexpr ((Mask & quote) != 0)
+	{
+		result = _mm_or_si128(result, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('"')), _mm_cmpeq_epi8(v, _mm_set1_epi8('\''))));
+	}
+	
+	if constexpr ((Mask & backslash) != 0)
+	{
+		result = _mm_or_si128(result, _mm_cmpeq_epi8(v, _mm_set1_epi8('\\')));
+	}
+	
+	if constexpr ((Mask & slash) != 0)
+	{
+		result = _mm_or_si128(result, _mm_cmpeq_epi8(v, _mm_set1_epi8('/')));
+	}
+	
+	if constexpr ((Mask & at_sign) != 0)
+	{
+		result = _mm_or_si128(result, _mm_cmpeq_epi8(v, _mm_set1_epi8('@')));
+	}
+	
+	if constexpr ((Mask & parenthesis) != 0)
+	{
+		result = _mm_or_si128(result, _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8('(')), _mm_cmpeq_epi8(v, _mm_set1_epi8(')'))));
+	}
+	
+	if constexpr ((Mask & newline) != 0)
+	{
+		result = _mm_or_si128(result, _mm_cmpeq_epi8(v, _mm_set1_epi8('\n')));
+	}
+	
+	return result;
+}
+
+template<std::uint8_t Mask, bool Negated>
+std::ptrdiff_t find_sse2(const char* data, std::ptrdiff_t position, std::ptrdiff_t size) noexcept
+{
+	for (; position + 16 <= size; position += 16)
+	{
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+		auto bits = static_cast<std::uint32_t>(_mm_movemask_epi8(classify_sse2<Mask>(v)));
+		
+		if constexpr (Negated)
+		{
+			bits = ~bits & 0xFFFF;
+		}
+		
+		if (bits != 0)
+		{
+			return position + __builtin_ctz(bits);
+		}
+	}
+	
+	return find_scalar<Mask, Negated>(data, position, size);
+}
+
+__attribute__((target("avx2")))
+inline __m256i in_range_avx2(__m256i v, char low, char high) noexcept
+{
+	auto shifted = _mm256_sub_epi8(v, _mm256_set1_epi8(low));
+	return _mm256_cmpeq_epi8(_mm256_min_epu8(shifted, _mm256_set1_epi8(static_cast<char>(high - low))), shifted);
+}
+
+template<std::uint8_t Mask>
+__attribute__((target("avx2")))
+__m256i classify_avx2(__m256i v) noexcept
+{
+	auto result = _mm256_setzero_si256();
+	
+	if constexpr ((Mask & (whitespace | identifier)) != 0)
+	{
+		auto space = _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8(' ')), in_range_avx2(v, '\t', '\r'));
+		
+		if constexpr ((Mask & whitespace) != 0)
+		{
+			result = _mm256_or_si256(result, space);
+		}
+		
+		if constexpr ((Mask & identifier) != 0)
+		{
+			auto punct = _mm256_or_si256(_mm256_or_si256(in_range_avx2(v, 33, 47), in_range_avx2(v, 58, 64)),
+				_mm256_or_si256(_mm256_or_si256(in_range_avx2(v, 91, 94), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(96))), in_range_avx2(v, 123, 126)));
+			result = _mm256_or_si256(result, _mm256_andnot_si256(_mm256_or_si256(space, punct), _mm256_set1_epi8(-1)));
+		}
+	}
+	
+	if constexpr ((Mask & quote) != 0)
+	{
+		result = _mm256_or_si256(result, _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('"')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\''))));
+	}
+	
+	if constexpr ((Mask & backslash) != 0)
+	{
+		result = _mm256_or_si256(result, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\\')));
+	}
+	
+	if constexpr ((Mask & slash) != 0)
+	{
+		result = _mm256_or_si256(result, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('/')));
+	}
+	
+	if constexpr ((Mask & at_sign) != 0)
+	{
+		result = _mm256_or_si256(result, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('@')));
+	}
+	
+	if constexpr ((Mask & parenthesis) != 0)
+	{
+		result = _mm256_or_si256(result, _mm256_or_si256(_mm256_cmpeq_epi8(v, _mm256_set1_epi8('(')), _mm256_cmpeq_epi8(v, _mm256_set1_epi8(')'))));
+	}
+	
+	if constexpr ((Mask & newline) != 0)
+	{
+		result = _mm256_or_si256(result, _mm256_cmpeq_epi8(v, _mm256_set1_epi8('\n')));
+	}
+	
+	return result;
+}
+
+template<std::uint8_t Mask, bool Negated>
+__attribute__((target("avx2")))
+std::ptrdiff_t find_avx2(const char* data, std::ptrdiff_t position, std::ptrdiff_t size) noexcept
+{
+	for (; position + 32 <= size; position += 32)
+	{
+		auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position));
+		auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(classify_avx2<Mask>(v)));
+		
+		if constexpr (Negated)
+		{
+			bits = ~bits;
+		}
+		
+		if (bits != 0)
+		{
+			return position + __builtin_ctz(bits);
+		}
+	}
+	
+	return find_sse2<Mask, Negated>(data, position, size);
+}
+#endif
+
+template<std::uint8_t Mask, bool Negated>
+Scanner* select_scanner() noexcept
+{
+#ifdef JURAND_CHAR_SCAN_X86
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return &find_avx2<Mask, Negated>;
+	}
+	
+	return &find_sse2<Mask, Negated>;
+#else
+	return &find_scalar<Mask, Negated>;
+#endif
+}
+
+/*!
+ * Finds the first byte of @p content starting at @p position which belongs to
+ * any of the classes of @p Mask. The implementation is selected at runtime
+ * according to the instruction sets supported by the processor.
+ * 
+ * @return The position of the byte or the length of @p content if not found.
+ */
+template<std::uint8_t Mask>
+std::ptrdiff_t find_any(std::string_view content, std::ptrdiff_t position) noexcept
+{
+	static Scanner* const scanner = select_scanner<Mask, false>();
+	return scanner(content.data(), position, std::ssize(content));
+}
+
+/*!
+ * Finds the first byte of @p content starting at @p position which does not
+ * belong to any of the classes of @p Mask.
+ * 
+ * @return The position of the byte or the length of @p content if not found.
+ */
+template<std::uint8_t Mask>
+std::ptrdiff_t find_not(std::string_view content, std::ptrdiff_t position) noexcept
+{
+	static Scanner* const scanner = select_scanner<Mask, true>();
+	return scanner(content.data(), position, std::ssize(content));
+}
+
+//! A small set of bytes which is only known at runtime, found by find_any_of().
+struct Byte_set
+{
+	static constexpr std::ptrdiff_t capacity = 8;
+	
+	Byte_set() = default;
+	
+	//! @param bytes At most `capacity` distinct bytes.
+	explicit Byte_set(std::string_view bytes) noexcept
+	{
+		for (auto c : bytes)
+		{
+			bytes_[size_++] = c;
+			members_[static_cast<unsigned char>(c)] = true;
+		}
+	}
+	
+	[[nodiscard]] bool contains(char c) const noexcept
+	{
+		return members_[static_cast<unsigned char>(c)];
+	}
+	
+	[[nodiscard]] std::string_view bytes() const noexcept
+	{
+		return std::string_view(bytes_.data(), size_);
+	}
+	
+private:
+	std::array<char, capacity> bytes_ {};
+	std::ptrdiff_t size_ = 0;
+	std::array<bool, 256> members_ {};
+};
+
+using Set_scanner = std::ptrdiff_t(const Byte_set& set, const char* data, std::ptrdiff_t position, std::ptrdiff_t size) noexcept;
+
+/*!
+ * Portable implementation, finds the first byte starting at @p position which
+ * belongs to @p set.
+ * 
+ * @return The position of the byte or @p size if not found.
+ */
+inline std::ptrdiff_t find_any_of_scalar(const Byte_set& set, const char* data, std::ptrdiff_t position, std::ptrdiff_t size) noexcept
+{
+	while (position != size and not set.contains(data[position]))
+	{
+		++position;
+	}
+	
+	return position;
+}
+
+#ifdef JURAND_CHAR_SCAN_X86
+inline std::ptrdiff_t find_any_of_sse2(const Byte_set& set, const char* data, std::ptrdiff_t position, std::ptrdiff_t size) noexcept
+{
+	__m128i needles[Byte_set::capacity];
+	
+	for (std::ptrdiff_t i = 0; i != std::ssize(set.bytes()); ++i)
+	{
+		needles[i] = _mm_set1_epi8(set.bytes()[i]);
+	}
+	
+	for (; position + 16 <= size; position += 16)
+	{
+		auto v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(data + position));
+		auto found = _mm_setzero_si128();
+		
+		for (std::ptrdiff_t i = 0; i != std::ssize(set.bytes()); ++i)
+		{
+			found = _mm_or_si128(found, _mm_cmpeq_epi8(v, needles[i]));
+		}
+		
+		if (auto bits = static_cast<std::uint32_t>(_mm_movemask_epi8(found)); bits != 0)
+		{
+			return position + __builtin_ctz(bits);
+		}
+	}
+	
+	return find_any_of_scalar(set, data, position, size);
+}
+
+__attribute__((target("avx2")))
+inline std::ptrdiff_t find_any_of_avx2(const Byte_set& set, const char* data, std::ptrdiff_t position, std::ptrdiff_t size) noexcept
+{
+	__m256i needles[Byte_set::capacity];
+	
+	for (std::ptrdiff_t i = 0; i != std::ssize(set.bytes()); ++i)
+	{
+		needles[i] = _mm256_set1_epi8(set.bytes()[i]);
+	}
+	
+	for (; position + 32 <= size; position += 32)
+	{
+		auto v = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(data + position));
+		auto found = _mm256_setzero_si256();
+		
+		for (std::ptrdiff_t i = 0; i != std::ssize(set.bytes()); ++i)
+		{
+			found = _mm256_or_si256(found, _mm256_cmpeq_epi8(v, needles[i]));
+		}
+		
+		if (auto bits = static_cast<std::uint32_t>(_mm256_movemask_epi8(found)); bits != 0)
+		{
+			return position + __builtin_ctz(bits);
+		}
+	}
+	
+	return find_any_of_sse2(set, data, position, size);
+}
+#endif
+
+inline Set_scanner* select_set_scanner() noexcept
+{
+#ifdef JURAND_CHAR_SCAN_X86
+	if (__builtin_cpu_supports("avx2"))
+	{
+		return &find_any_of_avx2;
+	}
+	
+	return &find_any_of_sse2;
+#else
+	return &find_any_of_scalar;
+#endif
+}
+
+/*!
+ * Finds the first byte of @p content starting at @p position which belongs to
+ * @p set, like find_any().
+ * 
+ * @return The position of the byte or the length of @p content if not found.
+ */
+inline std::ptrdiff_t find_any_of(const Byte_set& set, std::string_view content, std::ptrdiff_t position) noexcept
+{
+	static Set_scanner* const scanner = select_set_scanner();
+	return scanner(set, content.data(), position, std::ssize(content));
+}
+} // namespace char_scan
@@ -0,0 +1,571 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <charconv>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <mutex>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "bitset.hpp"
+#include "edited_content.hpp"
+#include "file_content.hpp"
+
+/*!
+ * A persistent cache of the results of handling files with one set of
+ * parameters. The results are keyed by a hash of the content of a file, the
+ * hash of a file path is additionally remembered together with the
+ * modification time, size and inode of the file so that an unchanged file can
+ * be found in the cache without reading it.
+ * 
+ * The cache of one set of parameters is a single file in the cache directory
+ * named by their fingerprint. It is loaded at once and replaced at once when
+ * saved, only the entries used by the run are kept.
+ */
+struct Content_cache
+{
+	//! Increased whenever the format of the file or the results change
+	static constexpr std::string_view format = "jurand-cache 5";
+	
+	struct Entry
+	{
+		//! The size of the original content
+		std::ptrdiff_t size_ = 0;
+		
+		//! The ranges of the original content which are kept, if it changed
+		std::vector<std::pair<std::ptrdiff_t, std::ptrdiff_t>> kept_;
+		bool changed_ = false;
+		
+		//! Whether the matches below were recorded
+		bool matches_known_ = false;
+		bool annotation_removed_ = false;
+		Bitset names_;
+		Bitset patterns_;
+		Bitset module_patterns_;
+		
+		//! Whether the hit counts of the matchers below were recorded
+		bool hits_known_ = false;
+		std::vector<std::ptrdiff_t> name_hits_;
+		std::vector<std::ptrdiff_t> pattern_hits_;
+		std::vector<std::ptrdiff_t> module_pattern_hits_;
+	};
+	
+	//! The properties of a file which change whenever its content changes
+	struct File_state
+	{
+		std::int64_t mtime_ = 0;
+		std::int64_t size_ = 0;
+		std::uint64_t inode_ = 0;
+		
+		bool operator==(const File_state&) const = default;
+	};
+	
+	/*!
+	 * Loads the cache of @p fingerprint from @p directory, an unreadable or
+	 * malformed cache is treated as empty.
+	 */
+	Content_cache(const std::filesystem::path& directory, std::uint64_t fingerprint)
+		:
+		path_(directory / hex(fingerprint)),
+		start_time_(std::chrono::duration_cast<std::chrono::nanoseconds>(
+			std::chrono::system_clock::now().time_since_epoch()).count())
+	{
+		try
+		{
+			auto buffer = std::string();
+			auto file_content = File_content(path_, buffer);
+			
+			if (not parse(file_content.view()))
+			{
+				entries_.clear();
+				paths_.clear();
+			}
+		}
+		catch (std::system_error&)
+		{
+		}
+	}
+	
+	Content_cache(const Content_cache&) = delete;
+	Content_cache& operator=(const Content_cache&) = delete;
+	
+	/*!
+	 * @param seed Selects one of independent hash functions, so that contents
+	 * which are handled differently get different keys.
+	 * @return A fast non-cryptographic hash of @p content.
+	 */
+	[[nodiscard]] static std::uint64_t hash(std::string_view content, std::uint64_t seed = 0) noexcept
+	{
+		constexpr auto multiplier = std::uint64_t(0x9e3779b97f4a7c15);
+		
+		// Four independent lanes so that the multiplications overlap
+		auto lanes = std::array<std::uint64_t, 4> {1 ^ (seed * multiplier), 2, 3, std::uint64_t(content.size())};
+		auto position = std::size_t(0);
+		
+		for (; position + 32 <= content.size(); position += 32)
+		{
+			for (std::size_t lane = 0; lane != lanes.size(); ++lane)
+			{
+				auto word = std::uint64_t();
+				std::memcpy(&word, content.data() + position + lane * 8, 8);
+				lanes[lane] = std::rotl(lanes[lane] ^ (word * multiplier), 29) * multiplier;
+			}
+		}
+		
+		for (std::size_t lane = 0; position < content.size(); position += 8, ++lane)
+		{
+			auto word = std::uint64_t();
+			std::memcpy(&word, content.data() + position, std::min<std::size_t>(8, content.size() - position));
+			lanes[lane] = std::rotl(lanes[lane] ^ (word * multiplier), 29) * multiplier;
+		}
+		
+		auto result = std::uint64_t(0);
+		
+		for (auto lane : lanes)
+		{
+			result = mix(result ^ mix(lane));
+		}
+		
+		return result;
+	}
+	
+	//! @return The state of the file at @p path or nothing if it is not a regular file.
+	[[nodiscard]] static std::optional<File_state> state(const std::filesystem::path& path) noexcept
+	{
+		struct ::stat status;
+		
+		if (::stat(path.c_str(), &status) == -1 or not S_ISREG(status.st_mode))
+		{
+			return std::nullopt;
+		}
+		
+		return File_state(std::int64_t(status.st_mtim.tv_sec) * 1'000'000'000 + status.st_mtim.tv_nsec,
+			std::int64_t(status.st_size), std::uint64_t(status.st_ino));
+	}
+	
+	//! @return The content hash remembered for @p path if its state is still @p state.
+	[[nodiscard]] std::optional<std::uint64_t> find_path(const std::filesystem::path& path, const File_state& state)
+	{
+		auto lock = std::lock_guard(mutex_);
+		
+		if (auto it = paths_.find(path.native()); it != paths_.end() and it->second.state_ == state)
+		{
+			it->second.used_ = true;
+			return it->second.hash_;
+		}
+		
+		return std::nullopt;
+	}
+	
+	/*!
+	 * @param size The size of the content, an entry of another size is ignored.
+	 * @param matches_needed Whether entries without the recorded matches are ignored.
+	 * @param hits_needed Whether entries without the recorded hit counts are ignored.
+	 * @return The entry of the content with @p hash.
+	 */
+	[[nodiscard]] std::optional<Entry> find(std::uint64_t hash, std::ptrdiff_t size, bool matches_needed, bool hits_needed = false)
+	{
+		auto lock = std::lock_guard(mutex_);
+		
+		if (auto it = entries_.find(hash); it != entries_.end() and it->second.size_ == size
+			and (it->second.matches_known_ or not matches_needed) and (it->second.hits_known_ or not hits_needed))
+		{
+			it->second.used_ = true;
+			return it->second;
+		}
+		
+		return std::nullopt;
+	}
+	
+	void insert(std::uint64_t hash, Entry entry)
+	{
+		auto lock = std::lock_guard(mutex_);
+		entries_.insert_or_assign(hash, Used_entry(std::move(entry), true));
+		modified_ = true;
+	}
+	
+	/*!
+	 * Remembers that the file at @p path in @p state has the content with
+	 * @p hash. Files modified too recently are not remembered, because another
+	 * modification may not change their state.
+	 */
+	void insert_path(const std::filesystem::path& path, const File_state& state, std::uint64_t hash)
+	{
+		if (state.mtime_ >= start_time_ - racy_time or path.native().find('\n') != std::string::npos)
+		{
+			return;
+		}
+		
+		auto lock = std::lock_guard(mutex_);
+		auto& value = paths_[path.native()];
+		modified_ = modified_ or value.state_ != state or value.hash_ != hash;
+		value = Path_entry(state, hash, true);
+	}
+	
+	/*!
+	 * @return The content which the @p entry makes of @p original or nothing if
+	 * it does not fit. The kept ranges must be as made by kept_ranges() of a
+	 * changed content of the same size: non-empty, in order and separated by
+	 * removed ranges.
+	 */
+	[[nodiscard]] static std::optional<Edited_content> apply(const Entry& entry, std::string_view original)
+	{
+		auto result = Edited_content(original);
+		
+		if (entry.size_ != std::ssize(original))
+		{
+			return std::nullopt;
+		}
+		
+		if (not entry.changed_)
+		{
+			return result;
+		}
+		
+		auto position = std::ptrdiff_t(0);
+		auto kept_size = std::ptrdiff_t(0);
+		
+		for (auto [begin, end] : entry.kept_)
+		{
+			if (begin < position or (begin == position and position != 0) or end <= begin or end > std::ssize(original))
+			{
+				return std::nullopt;
+			}
+			
+			result.keep(begin, end);
+			position = end;
+			kept_size += end - begin;
+		}
+		
+		if (kept_size == std::ssize(original))
+		{
+			return std::nullopt;
+		}
+		
+		return result;
+	}
+	
+	//! @return The ranges kept in @p content, relative to its original content.
+	[[nodiscard]] static std::vector<std::pair<std::ptrdiff_t, std::ptrdiff_t>> kept_ranges(const Edited_content& content)
+	{
+		auto result = std::vector<std::pair<std::ptrdiff_t, std::ptrdiff_t>>();
+		
+		for (auto span : content.spans())
+		{
+			auto begin = span.data() - content.original().data();
+			result.emplace_back(begin, begin + std::ssize(span));
+		}
+		
+		return result;
+	}
+	
+	/*!
+	 * Replaces the cache file with the entries used by this run if anything
+	 * changed, must not be called concurrently with other functions.
+	 * 
+	 * @throws std::system_error If the cache could not be written.
+	 */
+	void save() const
+	{
+		bool all_used = std::ranges::all_of(entries_, [](const auto& entry) noexcept -> bool {return entry.second.used_;})
+			and std::ranges::all_of(paths_, [](const auto& path) noexcept -> bool {return path.second.used_;});
+		
+		if (not modified_ and all_used)
+		{
+			return;
+		}
+		
+		auto temporary_path = path_;
+		temporary_path += ".tmp" + std::to_string(::getpid());
+		auto stream = std::ofstream(temporary_path);
+		stream << format << "\n";
+		
+		for (const auto& [hash, entry] : entries_)
+		{
+			if (not entry.used_)
+			{
+				continue;
+			}
+			
+			stream << "c " << hex(hash) << " " << entry.changed_ << entry.matches_known_ << entry.annotation_removed_ << entry.hits_known_
+				<< " " << entry.size_;
+			
+			for (const auto* bits : {&entry.names_, &entry.patterns_, &entry.module_patterns_})
+			{
+				stream << " b";
+				
+				for (std::ptrdiff_t i = 0; i != bits->size(); ++i)
+				{
+					stream << bits->test(i);
+				}
+			}
+			
+			for (const auto* hits : {&entry.name_hits_, &entry.pattern_hits_, &entry.module_pattern_hits_})
+			{
+				stream << " h";
+				
+				for (std::size_t i = 0; i != hits->size(); ++i)
+				{
+					stream << (i == 0 ? "" : ",") << (*hits)[i];
+				}
+			}
+			
+			for (auto [begin, end] : entry.kept_)
+			{
+				stream << " " << begin << " " << end;
+			}
+			
+			stream << "\n";
+		}
+		
+		for (const auto& [path, entry] : paths_)
+		{
+			if (entry.used_)
+			{
+				stream << "p " << hex(entry.hash_) << " " << entry.state_.mtime_ << " " << entry.state_.size_
+					<< " " << entry.state_.inode_ << " " << path << "\n";
+			}
+		}
+		
+		stream.close();
+		
+		if (not stream or ::rename(temporary_path.c_str(), path_.c_str()) == -1)
+		{
+			auto error = errno;
+			auto ignored = std::error_code();
+			std::filesystem::remove(temporary_path, ignored);
+			throw std::system_error(stream ? error : EIO, std::generic_category(), "Could not write cache file " + path_.native());
+		}
+	}
+	
+private:
+	//! Files modified less than this many nanoseconds before the run are not remembered
+	static constexpr std::int64_t racy_time = 2'000'000'000;
+	
+	struct Used_entry : Entry
+	{
+		Used_entry() = default;
+		
+		Used_entry(Entry entry, bool used)
+			:
+			Entry(std::move(entry)),
+			used_(used)
+		{
+		}
+		
+		bool used_ = false;
+	};
+	
+	struct Path_entry
+	{
+		File_state state_;
+		std::uint64_t hash_ = 0;
+		bool used_ = false;
+	};
+	
+	static std::uint64_t mix(std::uint64_t value) noexcept
+	{
+		value ^= value >> 33;
+		value *= 0xff51afd7ed558ccd;
+		value ^= value >> 33;
+		value *= 0xc4ceb9fe1a85ec53;
+		value ^= value >> 33;
+		
+		return value;
+	}
+	
+	static std::string hex(std::uint64_t value)
+	{
+		auto result = std::string(16, '0');
+		std::to_chars(result.data() + 16 - (std::bit_width(value | 1) + 3) / 4, result.data() + 16, value, 16);
+		
+		return result;
+	}
+	
+	//! @return False if @p content is not a valid cache.
+	bool parse(std::string_view content)
+	{
+		auto line_end = content.find('\n');
+		
+		if (content.substr(0, line_end) != format)
+		{
+			return false;
+		}
+		
+		for (auto position = line_end + 1; position < content.size(); position = line_end + 1)
+		{
+			line_end = content.find('\n', position);
+			
+			if (line_end == std::string_view::npos)
+			{
+				return false;
+			}
+			
+			auto line = content.substr(position, line_end - position);
+			auto fields = Fields(line);
+			auto kind = fields.next();
+			auto hash = std::uint64_t();
+			
+			if (not fields.number(hash, 16))
+			{
+				return false;
+			}
+			
+			if (kind == "c")
+			{
+				auto flags = fields.next();
+				
+				if (flags.size() != 4)
+				{
+					return false;
+				}
+				
+				auto entry = Used_entry();
+				entry.changed_ = flags[0] == '1';
+				entry.matches_known_ = flags[1] == '1';
+				entry.annotation_removed_ = flags[2] == '1';
+				entry.hits_known_ = flags[3] == '1';
+				
+				if (not fields.number(entry.size_) or entry.size_ < 0)
+				{
+					return false;
+				}
+				
+				for (auto* bits : {&entry.names_, &entry.patterns_, &entry.module_patterns_})
+				{
+					auto field = fields.next();
+					
+					if (not field.starts_with('b'))
+					{
+						return false;
+					}
+					
+					*bits = Bitset(std::ssize(field) - 1);
+					
+					for (std::ptrdiff_t i = 0; i != bits->size(); ++i)
+					{
+						if (field[i + 1] == '1')
+						{
+							bits->set(i);
+						}
+					}
+				}
+				
+				for (auto* hits : {&entry.name_hits_, &entry.pattern_hits_, &entry.module_pattern_hits_})
+				{
+					auto field = fields.next();
+					
+					if (not field.starts_with('h'))
+					{
+						return false;
+					}
+					
+					for (auto counts = Fields(field.substr(1), ','); not counts.empty();)
+					{
+						if (not counts.number(hits->emplace_back()))
+						{
+							return false;
+						}
+					}
+				}
+				
+				while (not fields.empty())
+				{
+					auto& range = entry.kept_.emplace_back();
+					
+					if (not fields.number(range.first) or not fields.number(range.second))
+					{
+						return false;
+					}
+				}
+				
+				entries_.insert_or_assign(hash, std::move(entry));
+			}
+			else if (kind == "p")
+			{
+				auto entry = Path_entry();
+				entry.hash_ = hash;
+				
+				if (not fields.number(entry.state_.mtime_) or not fields.number(entry.state_.size_)
+					or not fields.number(entry.state_.inode_) or fields.empty())
+				{
+					return false;
+				}
+				
+				paths_.insert_or_assign(std::string(fields.rest()), entry);
+			}
+			else
+			{
+				return false;
+			}
+		}
+		
+		return true;
+	}
+	
+	//! Space-separated fields of a line of the cache file, or fields separated by @p separator
+	struct Fields
+	{
+		explicit Fields(std::string_view line, char separator = ' ') noexcept
+			:
+			line_(line),
+			separator_(separator)
+		{
+		}
+		
+		[[nodiscard]] bool empty() const noexcept
+		{
+			return line_.empty();
+		}
+		
+		[[nodiscard]] std::string_view rest() const noexcept
+		{
+			return line_;
+		}
+		
+		std::string_view next() noexcept
+		{
+			auto end = std::min(line_.find(separator_), line_.size());
+			auto result = line_.substr(0, end);
+			line_.remove_prefix(std::min(end + 1, line_.size()));
+			
+			return result;
+		}
+		
+		bool number(auto& value, int base = 10) noexcept
+		{
+			auto field = next();
+			auto [end, error] = std::from_chars(field.data(), field.data() + field.size(), value, base);
+			
+			return error == std::errc() and end == field.data() + field.size() and not field.empty();
+		}
+	
+	private:
+		std::string_view line_;
+		char separator_;
+	};
+	
+	std::filesystem::path path_;
+	std::int64_t start_time_;
+	std::mutex mutex_;
+	std::unordered_map<std::uint64_t, Used_entry> entries_;
+	std::unordered_map<std::string, Path_entry> paths_;
+	bool modified_ = false;
+};
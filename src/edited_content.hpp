@@ -0,0 +1,307 @@
+#pragma once
+
+#include <cerrno>
+#include <climits>
+#include <cstddef>
+
+#include <algorithm>
+#include <ostream>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <sys/uio.h>
+#include <unistd.h>
+
+/*!
+ * The result of removing ranges of a content. The content is represented by
+ * the spans of the original content which are kept, in order, so that no copy
+ * is made. An unchanged content is represented without any allocation.
+ */
+struct Edited_content
+{
+	Edited_content() = default;
+	
+	//! Creates an unchanged content, ranges to keep can be appended afterwards
+	explicit Edited_content(std::string_view original) noexcept
+		:
+		original_(original)
+	{
+	}
+	
+	/*!
+	 * Appends the range [@p begin, @p end) of the original content, the ranges
+	 * must be appended in increasing order.
+	 */
+	void keep(std::ptrdiff_t begin, std::ptrdiff_t end)
+	{
+		edited_ = true;
+		
+		if (begin == end)
+		{
+			return;
+		}
+		
+		if (not kept_.empty() and kept_.back().data() + kept_.back().size() == original_.data() + begin)
+		{
+			kept_.back() = std::string_view(kept_.back().data(), kept_.back().size() + (end - begin));
+			return;
+		}
+		
+		kept_.emplace_back(original_.data() + begin, end - begin);
+	}
+	
+	[[nodiscard]] std::string_view original() const noexcept
+	{
+		return original_;
+	}
+	
+	//! @return True if any range was removed.
+	[[nodiscard]] bool changed() const noexcept
+	{
+		return edited_ and size() != std::ssize(original_);
+	}
+	
+	[[nodiscard]] std::span<const std::string_view> spans() const noexcept
+	{
+		if (not edited_)
+		{
+			return std::span(&original_, 1);
+		}
+		
+		return kept_;
+	}
+	
+	[[nodiscard]] std::ptrdiff_t size() const noexcept
+	{
+		auto result = std::ptrdiff_t(0);
+		
+		for (auto span : spans())
+		{
+			result += std::ssize(span);
+		}
+		
+		return result;
+	}
+	
+	/*!
+	 * @return The offset of the first removed byte of the original content or
+	 * its length if nothing was removed.
+	 */
+	[[nodiscard]] std::ptrdiff_t first_removed() const noexcept
+	{
+		if (not edited_ or kept_.empty() or kept_.front().data() != original_.data())
+		{
+			return edited_ ? 0 : std::ssize(original_);
+		}
+		
+		return std::ssize(kept_.front());
+	}
+	
+	/*!
+	 * @return The content made by removing also the ranges removed by @p next,
+	 * whose original content is a copy of this content.
+	 */
+	[[nodiscard]] Edited_content then(const Edited_content& next) const
+	{
+		if (not next.changed())
+		{
+			return *this;
+		}
+		
+		auto result = Edited_content(original_);
+		result.keep(0, 0);
+		
+		auto kept = spans();
+		auto index = std::size_t(0);
+		auto kept_begin = std::ptrdiff_t(0);
+		
+		for (auto span : next.spans())
+		{
+			auto begin = span.data() - next.original_.data();
+			auto end = begin + std::ssize(span);
+			
+			while (begin != end)
+			{
+				while (kept_begin + std::ssize(kept[index]) <= begin)
+				{
+					kept_begin += std::ssize(kept[index]);
+					++index;
+				}
+				
+				auto part_end = std::min(end, kept_begin + std::ssize(kept[index]));
+				auto offset = kept[index].data() - original_.data() - kept_begin;
+				result.keep(begin + offset, part_end + offset);
+				begin = part_end;
+			}
+		}
+		
+		return result;
+	}
+	
+	[[nodiscard]] std::string str() const
+	{
+		auto result = std::string();
+		result.reserve(size());
+		
+		for (auto span : spans())
+		{
+			result += span;
+		}
+		
+		return result;
+	}
+	
+	bool operator==(std::string_view other) const noexcept
+	{
+		auto position = std::size_t(0);
+		
+		for (auto span : spans())
+		{
+			if (other.substr(position, span.size()) != span)
+			{
+				return false;
+			}
+			
+			position += span.size();
+		}
+		
+		return position == other.size();
+	}
+	
+	friend std::ostream& operator<<(std::ostream& os, const Edited_content& content)
+	{
+		for (auto span : content.spans())
+		{
+			os << span;
+		}
+		
+		return os;
+	}
+	
+	/*!
+	 * Writes @p prefix followed by the content to @p fd.
+	 * 
+	 * @throws std::system_error If writing fails.
+	 */
+	void write(int fd, std::string_view prefix = {}) const
+	{
+		auto iovecs = std::vector<::iovec>();
+		iovecs.reserve(spans().size() + 1);
+		
+		if (not prefix.empty())
+		{
+			iovecs.push_back(to_iovec(prefix));
+		}
+		
+		for (auto span : spans())
+		{
+			iovecs.push_back(to_iovec(span));
+		}
+		
+		write_all(fd, iovecs);
+	}
+	
+	/*!
+	 * Rewrites the file @p fd, which contains the original content, from the
+	 * first removed offset onwards and truncates it to the new size. If the
+	 * original content @p is_mapped from that file, the rewritten part is
+	 * copied first, because writing the file would change it.
+	 * 
+	 * @throws std::system_error If writing fails.
+	 */
+	void write_in_place(int fd, bool is_mapped) const
+	{
+		auto offset = first_removed();
+		auto tail = std::string();
+		auto iovecs = std::vector<::iovec>();
+		
+		for (auto span : spans())
+		{
+			auto span_end = span.data() + span.size() - original_.data();
+			
+			if (span_end <= offset)
+			{
+				continue;
+			}
+			
+			if (span.data() - original_.data() < offset)
+			{
+				span.remove_prefix(offset - (span.data() - original_.data()));
+			}
+			
+			if (is_mapped)
+			{
+				tail += span;
+			}
+			else
+			{
+				iovecs.push_back(to_iovec(span));
+			}
+		}
+		
+		if (is_mapped)
+		{
+			iovecs.assign({to_iovec(tail)});
+		}
+		
+		write_all(fd, iovecs, offset);
+		
+		if (::ftruncate(fd, size()) == -1)
+		{
+			throw std::system_error(errno, std::generic_category(), "Could not truncate file");
+		}
+	}
+	
+private:
+	static ::iovec to_iovec(std::string_view span) noexcept
+	{
+		return ::iovec {const_cast<char*>(span.data()), span.size()};
+	}
+	
+	/*!
+	 * Writes all of @p iovecs, using `writev` or if @p offset is not `-1`,
+	 * `pwritev` at that offset.
+	 */
+	static void write_all(int fd, std::span<::iovec> iovecs, std::ptrdiff_t offset = -1)
+	{
+		while (not iovecs.empty())
+		{
+			auto count = std::min<std::ptrdiff_t>(std::ssize(iovecs), IOV_MAX);
+			auto written = offset == -1 ? ::writev(fd, iovecs.data(), count) : ::pwritev(fd, iovecs.data(), count, offset);
+			
+			if (written == -1)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				
+				throw std::system_error(errno, std::generic_category(), "Could not write file");
+			}
+			
+			if (offset != -1)
+			{
+				offset += written;
+			}
+			
+			while (not iovecs.empty() and written >= static_cast<std::ptrdiff_t>(iovecs.front().iov_len))
+			{
+				written -= iovecs.front().iov_len;
+				iovecs = iovecs.subspan(1);
+			}
+			
+			if (written != 0)
+			{
+				iovecs.front().iov_base = static_cast<char*>(iovecs.front().iov_base) + written;
+				iovecs.front().iov_len -= written;
+			}
+		}
+	}
+	
+	std::string_view original_;
+	std::vector<std::string_view> kept_;
+	bool edited_ = false;
+};
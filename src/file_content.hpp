@@ -0,0 +1,161 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+
+#include <algorithm>
+#include <filesystem>
+#include <string>
+#include <string_view>
+#include <system_error>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+/*!
+ * The content of a file in memory. Files smaller than a threshold are read
+ * with a single `read` into a caller-provided buffer which is only ever grown,
+ * so that a thread reusing its buffer does not allocate for each file. Larger
+ * files are mapped into memory instead of being copied.
+ */
+struct File_content
+{
+	//! Files of at least this size are mapped into memory
+	static constexpr std::ptrdiff_t mapping_threshold = 256 * 1024;
+	
+	/*!
+	 * Reads the standard input into @p buffer.
+	 */
+	explicit File_content(std::string& buffer)
+	{
+		content_ = read_all(STDIN_FILENO, buffer, 0);
+	}
+	
+	/*!
+	 * Reads or maps the file at @p path, @p buffer is used for small files and
+	 * must outlive this object and not be modified while it exists.
+	 * 
+	 * @throws std::system_error If the file could not be read.
+	 */
+	File_content(const std::filesystem::path& path, std::string& buffer)
+	{
+		int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+		
+		if (fd == -1)
+		{
+			throw std::system_error(errno, std::generic_category(), "Could not open file for reading");
+		}
+		
+		struct ::stat status;
+		
+		if (::fstat(fd, &status) == -1)
+		{
+			auto error = errno;
+			::close(fd);
+			throw std::system_error(error, std::generic_category(), "Could not read file");
+		}
+		
+		auto size = static_cast<std::ptrdiff_t>(status.st_size);
+		
+		if (S_ISREG(status.st_mode) and size >= mapping_threshold)
+		{
+			if (auto* mapping = ::mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0); mapping != MAP_FAILED)
+			{
+				::madvise(mapping, size, MADV_SEQUENTIAL);
+				mapping_ = mapping;
+				content_ = std::string_view(static_cast<const char*>(mapping), size);
+				::close(fd);
+				
+				return;
+			}
+		}
+		
+		try
+		{
+			content_ = read_all(fd, buffer, size);
+		}
+		catch (...)
+		{
+			::close(fd);
+			throw;
+		}
+		
+		::close(fd);
+	}
+	
+	File_content(const File_content&) = delete;
+	File_content& operator=(const File_content&) = delete;
+	
+	~File_content()
+	{
+		if (mapping_)
+		{
+			::munmap(mapping_, content_.size());
+		}
+	}
+	
+	[[nodiscard]] std::string_view view() const noexcept
+	{
+		return content_;
+	}
+	
+	//! @return True if the content is mapped from the file rather than copied.
+	[[nodiscard]] bool is_mapped() const noexcept
+	{
+		return mapping_ != nullptr;
+	}
+	
+private:
+	/*!
+	 * Reads @p fd until the end of file into @p buffer, starting with a single
+	 * read of @p expected_size bytes.
+	 * 
+	 * @return The view of the read part of @p buffer.
+	 */
+	static std::string_view read_all(int fd, std::string& buffer, std::ptrdiff_t expected_size)
+	{
+		// One more byte so that reaching the end of file does not need
+		// another round of growing the buffer
+		auto capacity = std::max<std::ptrdiff_t>({expected_size + 1, 4096, std::ssize(buffer)});
+		auto length = std::ptrdiff_t(0);
+		
+		while (true)
+		{
+			if (std::ssize(buffer) < capacity)
+			{
+				buffer.resize(capacity);
+			}
+			
+			auto count = ::read(fd, buffer.data() + length, capacity - length);
+			
+			if (count == -1)
+			{
+				if (errno == EINTR)
+				{
+					continue;
+				}
+				
+				throw std::system_error(errno, std::generic_category(), "Could not read file");
+			}
+			
+			if (count == 0)
+			{
+				break;
+			}
+			
+			length += count;
+			
+			if (length == capacity)
+			{
+				capacity *= 2;
+			}
+		}
+		
+		return std::string_view(buffer.data(), length);
+	}
+	
+	std::string_view content_;
+	void* mapping_ = nullptr;
+};
@@ -2,69 +2,53 @@
 
 #include <cctype>
 #include <cstddef>
+#include <cstdint>
 
+#include <algorithm>
+#include <array>
 #include <atomic>
+#include <chrono>
 #include <filesystem>
-#include <fstream>
-#include <regex>
 #include <vector>
 #include <set>
 #include <map>
+#include <memory>
 #include <string_view>
 #include <tuple>
+#include <utility>
+#include <unordered_map>
 #include <optional>
 #include <mutex>
 #include <span>
 #include <syncstream>
+#include <thread>
 
 #include <iostream>
 
+#include "char_scan.hpp"
+#include "content_cache.hpp"
+#include "edited_content.hpp"
+#include "file_content.hpp"
+#include "literal_filter.hpp"
+#include "name_set.hpp"
+#include "ordered_output.hpp"
+#include "regex_set.hpp"
+#include "thread_pool.hpp"
+#include "tracer.hpp"
+
 using String_view_set = std::set<std::string_view, std::less<>>;
-using String_map = std::map<std::string, std::string, std::less<>>;
 
 using Parameter_dict = std::map<std::string_view, std::vector<std::string_view>, std::less<>>;
 
-struct Named_regex : std::regex
-{
-	Named_regex() = default;
-	
-	Named_regex(const char* pattern, auto&&... args)
-		:
-		Named_regex(std::string_view(pattern), std::forward<decltype(args)>(args)...)
-	{
-	}
-	
-	Named_regex(std::string_view pattern, auto&&... args)
-		:
-		std::regex(pattern.data(), pattern.length(), std::forward<decltype(args)>(args)...),
-		name_(pattern)
-	{
-	}
-	
-	Named_regex(std::string&& pattern, auto&&... args)
-		:
-		std::regex(pattern, std::forward<decltype(args)>(args)...),
-		name_(std::move(pattern))
-	{
-	}
-	
-	operator std::string_view() const noexcept
-	{
-		return name_;
-	}
-	
-private:
-	std::string name_;
-};
-
 struct Path_origin_entry : std::filesystem::path
 {
 	Path_origin_entry() = default;
 	
-	Path_origin_entry(auto&& path, std::string_view origin)
+	Path_origin_entry(auto&& path, std::string_view origin, std::ptrdiff_t origin_index = 0)
 		:
 		std::filesystem::path(std::forward<decltype(path)>(path)),
-		origin_(origin)
+		origin_(origin),
+		origin_index_(origin_index)
 	{
 	}
 	
@@ -73,8 +57,15 @@ struct Path_origin_entry : std::filesystem::path
 		return origin_;
 	}
 	
+	//! The index of the origin among the file paths given on the command line
+	[[nodiscard]] std::ptrdiff_t origin_index() const noexcept
+	{
+		return origin_index_;
+	}
+	
 private:
 	std::string_view origin_;
+	std::ptrdiff_t origin_index_ = 0;
 };
 
 template<typename Type, typename Mutex_type>
@@ -110,762 +101,3526 @@ private:
 	Type value_;
 };
 
+/*!
+ * A dense index of an instance whose threads each own a record of type
+ * @p Record. The index is reused once the instance is destroyed. Each thread
+ * remembers the records it has found in a vector indexed by the slot, so a
+ * thread alternating between many instances finds its record without locking.
+ */
+template<typename Record>
+struct Thread_slot
+{
+	Thread_slot()
+		:
+		index_(acquire()),
+		id_(next_id_.fetch_add(1, std::memory_order_relaxed))
+	{
+	}
+	
+	Thread_slot(const Thread_slot&) = delete;
+	Thread_slot& operator=(const Thread_slot&) = delete;
+	
+	~Thread_slot()
+	{
+		free_indices_.lock().get().push_back(index_);
+	}
+	
+	//! @return The record remembered by the current thread or null.
+	[[nodiscard]] Record* find() const noexcept
+	{
+		const auto& records = thread_records();
+		
+		if (index_ < std::ssize(records) and records[index_].first == id_)
+		{
+			return records[index_].second;
+		}
+		
+		return nullptr;
+	}
+	
+	//! Makes the current thread remember @p record as its record.
+	void remember(Record* record) const
+	{
+		auto& records = thread_records();
+		
+		if (index_ >= std::ssize(records))
+		{
+			records.resize(index_ + 1);
+		}
+		
+		records[index_] = std::pair(id_, record);
+	}
+	
+private:
+	/*!
+	 * @return The records found by the current thread with the id of their
+	 * instance, which tells apart the instances having used the same index.
+	 */
+	static std::vector<std::pair<std::uint64_t, Record*>>& thread_records() noexcept
+	{
+		thread_local auto result = std::vector<std::pair<std::uint64_t, Record*>>();
+		return result;
+	}
+	
+	static std::ptrdiff_t acquire()
+	{
+		auto free_indices = free_indices_.lock();
+		
+		if (free_indices.get().empty())
+		{
+			return next_index_.fetch_add(1, std::memory_order_relaxed);
+		}
+		
+		auto result = free_indices.get().back();
+		free_indices.get().pop_back();
+		
+		return result;
+	}
+	
+	inline static auto next_id_ = std::atomic<std::uint64_t>(1);
+	inline static auto next_index_ = std::atomic<std::ptrdiff_t>(0);
+	inline static auto free_indices_ = Mutex<std::vector<std::ptrdiff_t>>();
+	
+	std::ptrdiff_t index_;
+	std::uint64_t id_;
+};
+
 struct Parameters
 {
-	std::vector<Named_regex> patterns_;
-	std::vector<Named_regex> module_patterns_;
-	String_view_set names_;
+	Regex_set patterns_;
+	Regex_set module_patterns_;
+	Name_set names_;
+	std::optional<Literal_filter> filter_;
+	std::optional<Literal_filter> module_filter_;
 	bool also_remove_annotations_ = false;
 	bool in_place_ = false;
 	bool strict_mode_ = false;
 };
 
-struct Strict_mode
-{
-	std::atomic<bool> any_annotation_removed_ = false;
-	Mutex<std::map<std::string_view, bool, std::less<>>> patterns_matched_;
-	Mutex<std::map<std::string_view, bool, std::less<>>> module_patterns_matched_;
-	Mutex<std::map<std::string_view, bool, std::less<>>> names_matched_;
-	Mutex<std::map<std::string_view, bool>> files_truncated_;
-};
-
-inline static auto strict_mode = std::optional<Strict_mode>();
-
 /*!
- * Helper functions for manipulating java symbols
+ * The matchers and file paths which were used by one thread. The bits are
+ * indexed the same way as the corresponding sequences of Strict_mode.
  */
-namespace java_symbols
+struct Match_record
 {
+	Bitset names_;
+	Bitset patterns_;
+	Bitset module_patterns_;
+	Bitset origins_;
+	bool any_annotation_removed_ = false;
+};
+
 /*!
- * Iterates over @p content starting at @p position to find the first character
- * which is not part of a Java comment nor a whitespace character.
- * 
- * @return The position of the first non-whitespace non-comment character or the
- * length of the string if none is found.
+ * Bookkeeping of the strict mode. Each thread marks its own Match_record
+ * without locking, the records are merged after all the threads have finished.
  */
-inline std::ptrdiff_t ignore_whitespace_comments(std::string_view content, std::ptrdiff_t position) noexcept
+struct Strict_mode
 {
-	while (position != std::ssize(content))
+	Strict_mode(std::span<const std::string_view> origins, const Parameters& parameters)
+		:
+		names_(parameters.names_.begin(), parameters.names_.end()),
+		patterns_(parameters.patterns_.patterns().begin(), parameters.patterns_.patterns().end()),
+		module_patterns_(parameters.module_patterns_.patterns().begin(), parameters.module_patterns_.patterns().end()),
+		origins_(origins.begin(), origins.end())
+	{
+	}
+	
+	//! @param index The index of a name in Parameters::names_.
+	void mark_name(std::ptrdiff_t index)
+	{
+		mark(&Match_record::names_, index);
+	}
+	
+	//! @param index The index of a pattern in Parameters::patterns_.
+	void mark_pattern(std::ptrdiff_t index)
+	{
+		mark(&Match_record::patterns_, index);
+	}
+	
+	//! @param index The index of a pattern in Parameters::module_patterns_.
+	void mark_module_pattern(std::ptrdiff_t index)
+	{
+		mark(&Match_record::module_patterns_, index);
+	}
+	
+	void mark_origin(std::ptrdiff_t index)
 	{
-		if (std::isspace(static_cast<unsigned char>(content[position])))
+		record().origins_.set(index);
+	}
+	
+	void mark_annotation_removed()
+	{
+		for_each_target([](Match_record& target) noexcept -> void
 		{
-			++position;
-			continue;
-		}
+			target.any_annotation_removed_ = true;
+		});
+	}
+	
+	//! Marks the matchers marked in @p matches, which was made by new_record().
+	void mark(const Match_record& matches)
+	{
+		for_each_target([&](Match_record& target) -> void
+		{
+			target.names_ |= matches.names_;
+			target.patterns_ |= matches.patterns_;
+			target.module_patterns_ |= matches.module_patterns_;
+			target.any_annotation_removed_ = target.any_annotation_removed_ or matches.any_annotation_removed_;
+		});
+	}
+	
+	//! @return An empty record of the right size for begin_capture().
+	[[nodiscard]] Match_record new_record() const
+	{
+		auto result = Match_record();
+		result.names_ = Bitset(std::ssize(names_));
+		result.patterns_ = Bitset(std::ssize(patterns_));
+		result.module_patterns_ = Bitset(std::ssize(module_patterns_));
+		result.origins_ = Bitset(std::ssize(origins_));
 		
-		auto result = position;
+		return result;
+	}
+	
+	/*!
+	 * Marks the matchers marked by the current thread also in @p matches, until
+	 * end_capture() is called. Used to find the matches of a single file.
+	 * 
+	 * @return The previous capture of the current thread, to be restored by
+	 * passing it to end_capture().
+	 */
+	Match_record* begin_capture(Match_record& matches)
+	{
+		return std::exchange(thread_record().capture_, &matches);
+	}
+	
+	void end_capture(Match_record* previous = nullptr)
+	{
+		thread_record().capture_ = previous;
+	}
+	
+	/*!
+	 * Marks the matchers marked by the current thread only in @p matches
+	 * instead of its record and capture, until end_isolation() is called. Used
+	 * for matches which only count once it is known that their result is kept,
+	 * they are then marked by mark(const Match_record&).
+	 * 
+	 * @return The previous isolation of the current thread, to be restored by
+	 * passing it to end_isolation().
+	 */
+	Match_record* begin_isolation(Match_record& matches)
+	{
+		return std::exchange(thread_record().isolation_, &matches);
+	}
+	
+	void end_isolation(Match_record* previous = nullptr)
+	{
+		thread_record().isolation_ = previous;
+	}
+	
+	/*!
+	 * Merges the records of all threads, must not be called concurrently with
+	 * marking.
+	 * 
+	 * @return The sorted unique file paths in which no changes were made.
+	 */
+	[[nodiscard]] std::vector<std::string_view> unchanged_origins() const
+	{
+		return unmarked(origins_, &Match_record::origins_);
+	}
+	
+	//! @return The sorted unique names which did not match anything.
+	[[nodiscard]] std::vector<std::string_view> unmatched_names() const
+	{
+		return unmarked(names_, &Match_record::names_);
+	}
+	
+	//! @return The sorted unique patterns which did not match anything.
+	[[nodiscard]] std::vector<std::string_view> unmatched_patterns() const
+	{
+		return unmarked(patterns_, &Match_record::patterns_);
+	}
+	
+	//! @return The sorted unique module patterns which did not match anything.
+	[[nodiscard]] std::vector<std::string_view> unmatched_module_patterns() const
+	{
+		return unmarked(module_patterns_, &Match_record::module_patterns_);
+	}
+	
+	[[nodiscard]] bool any_annotation_removed() const
+	{
+		auto records = records_.lock();
 		
-		if (auto subst = content.substr(position, 2); subst == "//")
+		return std::ranges::any_of(records.get(), [](const auto& record) noexcept -> bool
 		{
-			position = content.find('\n', position + 2);
+			return record->matches_.any_annotation_removed_;
+		});
+	}
+	
+private:
+	//! The marks of one thread
+	struct Thread_record
+	{
+		std::thread::id thread_;
+		Match_record matches_;
+		
+		//! The record capturing the marks of the thread or null
+		Match_record* capture_ = nullptr;
+		
+		//! The record marked instead of all the others or null
+		Match_record* isolation_ = nullptr;
+	};
+	
+	/*!
+	 * @return The record of the current thread. The records are only looked
+	 * up under the lock the first time each thread uses this strict mode.
+	 */
+	Thread_record& thread_record()
+	{
+		auto* current = slot_.find();
+		
+		if (not current)
+		{
+			auto thread = std::this_thread::get_id();
+			auto records = records_.lock();
+			auto it = std::ranges::find(records.get(), thread, [](const auto& record) noexcept -> std::thread::id
+			{
+				return record->thread_;
+			});
 			
-			if (position == std::ptrdiff_t(content.npos))
+			if (it == records.get().end())
 			{
-				return std::ssize(content);
+				auto record = std::make_unique<Thread_record>();
+				record->thread_ = thread;
+				record->matches_ = new_record();
+				it = records.get().insert(it, std::move(record));
 			}
 			
-			++position;
+			current = it->get();
+			slot_.remember(current);
 		}
-		else if (subst == "/*")
+		
+		return *current;
+	}
+	
+	Match_record& record()
+	{
+		return thread_record().matches_;
+	}
+	
+	//! Calls @p function with each record in which the current thread marks.
+	void for_each_target(auto function)
+	{
+		auto& thread = thread_record();
+		
+		if (thread.isolation_)
 		{
-			position = content.find("*/", position + 2);
+			function(*thread.isolation_);
+			return;
+		}
+		
+		function(thread.matches_);
+		
+		if (thread.capture_)
+		{
+			function(*thread.capture_);
+		}
+	}
+	
+	void mark(Bitset Match_record::* bits, std::ptrdiff_t index)
+	{
+		for_each_target([&](Match_record& target) -> void
+		{
+			(target.*bits).set(index);
+		});
+	}
+	
+	std::vector<std::string_view> unmarked(std::span<const std::string_view> keys, Bitset Match_record::* bits) const
+	{
+		auto marked = std::map<std::string_view, bool>();
+		auto records = records_.lock();
+		
+		for (std::ptrdiff_t i = 0; i != std::ssize(keys); ++i)
+		{
+			auto& value = marked[keys[i]];
 			
-			if (position == std::ptrdiff_t(content.npos))
+			for (const auto& record : records.get())
 			{
-				return std::ssize(content);
+				value = value or (record->matches_.*bits).test(i);
 			}
-			
-			position += 2;
 		}
 		
-		if (result == position)
+		auto result = std::vector<std::string_view>();
+		
+		for (auto [key, value] : marked)
 		{
-			return result;
+			if (not value)
+			{
+				result.push_back(key);
+			}
 		}
+		
+		return result;
 	}
 	
-	return position;
-}
+	std::vector<std::string_view> names_;
+	std::vector<std::string_view> patterns_;
+	std::vector<std::string_view> module_patterns_;
+	std::vector<std::string_view> origins_;
+	Thread_slot<Thread_record> slot_;
+	mutable Mutex<std::vector<std::unique_ptr<Thread_record>>> records_;
+};
 
-inline bool is_identifier_char(char c) noexcept
+//! The stages of handling input files whose time is measured
+enum class Stage : std::uint8_t
 {
-	return c == '_' or (not std::ispunct(static_cast<unsigned char>(c)) and not std::isspace(static_cast<unsigned char>(c)));
-}
+	traversal,
+	reading,
+	remove_imports,
+	remove_imports_annotations,
+	remove_jpms_requires,
+	writing,
+};
+
+inline constexpr auto stage_names = std::array<std::string_view, 6>
+{
+	"traversal",
+	"reading",
+	"remove_imports",
+	"remove_imports_annotations",
+	"remove_jpms_requires",
+	"writing",
+};
+
+struct File_time
+{
+	std::chrono::nanoseconds time_ {};
+	std::ptrdiff_t size_ = 0;
+	std::string path_;
+};
 
 /*!
- * Iterates over @p content starting at @p position to find the next uncommented
- * symbol and returns it and an index pointing past it. The symbol is either a
- * sequence of alphanumeric characters or a single non-alphanumeric character or
- * an empty string if the end has been reached.
+ * The counters of one thread. The hit counts of matchers are indexed the same
+ * way as the corresponding sequences of Statistics.
  */
-inline std::tuple<std::string_view, std::ptrdiff_t> next_symbol(std::string_view content, std::ptrdiff_t position = 0) noexcept
+struct Statistics_record
 {
-	auto symbol_length = std::ptrdiff_t(0);
+	//! The index of the worker thread or `-1` for other threads
+	std::ptrdiff_t worker_ = -1;
 	
-	if (position < std::ssize(content))
-	{
-		position = ignore_whitespace_comments(content, position);
-		
-		if (position < std::ssize(content))
-		{
-			symbol_length = 1;
-			
-			if (is_identifier_char(content[position]))
-			{
-				while (position + symbol_length != std::ssize(content) and is_identifier_char(content[position + symbol_length]))
-				{
-					++symbol_length;
-				}
-			}
-		}
-	}
+	std::thread::id thread_;
 	
-	return std::tuple(content.substr(position, symbol_length), position + symbol_length);
-}
+	std::ptrdiff_t files_discovered_ = 0;
+	std::ptrdiff_t files_read_ = 0;
+	std::ptrdiff_t files_changed_ = 0;
+	std::ptrdiff_t files_prefiltered_ = 0;
+	std::ptrdiff_t files_cached_ = 0;
+	std::ptrdiff_t bytes_read_ = 0;
+	std::ptrdiff_t bytes_written_ = 0;
+	std::ptrdiff_t match_cache_front_hits_ = 0;
+	std::ptrdiff_t match_cache_shared_hits_ = 0;
+	std::ptrdiff_t match_cache_misses_ = 0;
+	std::array<std::chrono::nanoseconds, stage_names.size()> stage_times_ {};
+	std::chrono::nanoseconds busy_time_ {};
+	std::chrono::nanoseconds idle_time_ {};
+	std::vector<std::ptrdiff_t> name_hits_;
+	std::vector<std::ptrdiff_t> pattern_hits_;
+	std::vector<std::ptrdiff_t> module_pattern_hits_;
+	
+	//! The record into which the hits are counted instead, see Statistics::begin_capture()
+	Statistics_record* capture_ = nullptr;
+	
+	//! The slowest files ordered as a heap with the fastest one on top
+	std::vector<File_time> slowest_files_;
+};
 
 /*!
- * Iterates over @p content starting at @p position to find a string @p token
- * which is present in the source code neither inside a comment nor inside a
- * string nor inside a character literal.
- * 
- * Special case when @p token == ')', this function counts opening and closing
- * parentheses and returns the first parenthesis outside.
- * 
- * @param alphanumeric If true, considers only tokens that are surrounded by
- * whitespace, comments or are at the boundaries of @p content.
- * 
- * @return The starting index of the token or the length of @p content if not
- * found.
+ * Statistics about a run. Each thread counts into its own Statistics_record
+ * without locking or atomic operations, the records are merged after all the
+ * threads have finished.
  */
-inline std::ptrdiff_t find_token(std::string_view content, std::string_view token,
-	std::ptrdiff_t position = 0, bool alphanumeric = false, std::ptrdiff_t stack = 0) noexcept
+struct Statistics
 {
-	while (position + std::ssize(token) <= std::ssize(content))
+	explicit Statistics(const Parameters& parameters, std::ptrdiff_t slowest_count = 10)
+		:
+		names_(parameters.names_.begin(), parameters.names_.end()),
+		patterns_(parameters.patterns_.patterns().begin(), parameters.patterns_.patterns().end()),
+		module_patterns_(parameters.module_patterns_.patterns().begin(), parameters.module_patterns_.patterns().end()),
+		slowest_count_(slowest_count)
 	{
-		position = ignore_whitespace_comments(content, position);
+	}
+	
+	/*!
+	 * @return The record of the current thread. The records are only looked
+	 * up under the lock the first time each thread uses this Statistics.
+	 */
+	Statistics_record& record()
+	{
+		auto* current = slot_.find();
 		
-		if (position == std::ssize(content))
+		if (not current)
 		{
-			break;
+			auto thread = std::this_thread::get_id();
+			auto records = records_.lock();
+			auto it = std::ranges::find(records.get(), thread, [](const auto& record) noexcept -> std::thread::id
+			{
+				return record->thread_;
+			});
+			
+			if (it == records.get().end())
+			{
+				auto record = std::make_unique<Statistics_record>();
+				record->thread_ = thread;
+				record->name_hits_.resize(names_.size());
+				record->pattern_hits_.resize(patterns_.size());
+				record->module_pattern_hits_.resize(module_patterns_.size());
+				it = records.get().insert(it, std::move(record));
+			}
+			
+			current = it->get();
+			slot_.remember(current);
 		}
 		
-		auto substr = content.substr(position, token.length());
+		return *current;
+	}
+	
+	//! @param index The index of a name in Parameters::names_.
+	void count_name(std::ptrdiff_t index)
+	{
+		++hits().name_hits_[index];
+	}
+	
+	//! @param index The index of a pattern in Parameters::patterns_.
+	void count_pattern(std::ptrdiff_t index)
+	{
+		++hits().pattern_hits_[index];
+	}
+	
+	//! @param index The index of a pattern in Parameters::module_patterns_.
+	void count_module_pattern(std::ptrdiff_t index)
+	{
+		++hits().module_pattern_hits_[index];
+	}
+	
+	//! @return A record without hits of the right size for begin_capture().
+	[[nodiscard]] Statistics_record new_record() const
+	{
+		auto result = Statistics_record();
+		result.name_hits_.resize(names_.size());
+		result.pattern_hits_.resize(patterns_.size());
+		result.module_pattern_hits_.resize(module_patterns_.size());
 		
-		if ((token != ")" or stack == 0) and substr == token
-			and not (alphanumeric and ((position > 0 and is_identifier_char(content[position - 1]))
-				or (position + std::ssize(token) < std::ssize(content) and (is_identifier_char(content[position + token.length()]))))))
+		return result;
+	}
+	
+	/*!
+	 * Counts the hits of matchers counted by the current thread in @p hits
+	 * instead of its record, until end_capture() is called. Used to find the
+	 * hits in a single file, which are then counted by count_hits().
+	 * 
+	 * @return The previous capture of the current thread, to be restored by
+	 * passing it to end_capture().
+	 */
+	Statistics_record* begin_capture(Statistics_record& hits)
+	{
+		return std::exchange(record().capture_, &hits);
+	}
+	
+	void end_capture(Statistics_record* previous = nullptr)
+	{
+		record().capture_ = previous;
+	}
+	
+	//! Counts the hits of matchers in @p hits, which was made by new_record().
+	void count_hits(const Statistics_record& hits)
+	{
+		auto& target = this->hits();
+		
+		for (auto [counts, added] : {
+			std::pair(&target.name_hits_, &hits.name_hits_),
+			std::pair(&target.pattern_hits_, &hits.pattern_hits_),
+			std::pair(&target.module_pattern_hits_, &hits.module_pattern_hits_),
+		})
 		{
-			return position;
+			for (std::size_t i = 0; i != counts->size(); ++i)
+			{
+				(*counts)[i] += (*added)[i];
+			}
 		}
-		else if (content[position] == '\'')
+	}
+	
+	/*!
+	 * Adds the hit counts of @p other, whose matchers are also matchers of
+	 * this Statistics, under the indices of this one. Must not be called
+	 * concurrently with counting.
+	 */
+	void add_hits(const Statistics& other)
+	{
+		auto hits = other.merged();
+		auto record = std::make_unique<Statistics_record>();
+		record->name_hits_.resize(names_.size());
+		record->pattern_hits_.resize(patterns_.size());
+		record->module_pattern_hits_.resize(module_patterns_.size());
+		
+		for (std::size_t i = 0; i != other.names_.size(); ++i)
 		{
-			if (content.substr(position, 4) == "'\\''")
+			record->name_hits_[std::ranges::lower_bound(names_, other.names_[i]) - names_.begin()] += hits.name_hits_[i];
+		}
+		
+		for (auto [keys, other_keys, target, source] : {
+			std::tuple(&patterns_, &other.patterns_, &record->pattern_hits_, &hits.pattern_hits_),
+			std::tuple(&module_patterns_, &other.module_patterns_, &record->module_pattern_hits_, &hits.module_pattern_hits_),
+		})
+		{
+			for (std::size_t i = 0; i != other_keys->size(); ++i)
 			{
-				position += 3;
+				(*target)[std::ranges::find(*keys, (*other_keys)[i]) - keys->begin()] += (*source)[i];
 			}
-			else
+		}
+		
+		records_.lock().get().push_back(std::move(record));
+	}
+	
+	//! Records the time of handling a file if it is among the slowest ones.
+	void add_file_time(std::chrono::nanoseconds time, std::ptrdiff_t size, const std::filesystem::path& path)
+	{
+		auto& slowest = record().slowest_files_;
+		
+		if (std::ssize(slowest) == slowest_count_)
+		{
+			if (slowest_count_ == 0 or slowest.front().time_ >= time)
 			{
-				do
-				{
-					++position;
-				}
-				while (position < std::ssize(content) and content[position] != '\'');
+				return;
 			}
+			
+			std::ranges::pop_heap(slowest, std::greater(), &File_time::time_);
+			slowest.pop_back();
 		}
-		else if (content[position] == '"')
+		
+		slowest.push_back(File_time(time, size, path.native()));
+		std::ranges::push_heap(slowest, std::greater(), &File_time::time_);
+	}
+	
+	/*!
+	 * Merges the records of all threads, must not be called concurrently with
+	 * counting. The worker index of the result is `-1` and its slowest files
+	 * are sorted from the slowest one.
+	 */
+	[[nodiscard]] Statistics_record merged() const
+	{
+		auto result = Statistics_record();
+		result.name_hits_.resize(names_.size());
+		result.pattern_hits_.resize(patterns_.size());
+		result.module_pattern_hits_.resize(module_patterns_.size());
+		
+		for (const auto& record : records_.lock().get())
 		{
-			++position;
+			result.files_discovered_ += record->files_discovered_;
+			result.files_read_ += record->files_read_;
+			result.files_changed_ += record->files_changed_;
+			result.files_prefiltered_ += record->files_prefiltered_;
+			result.files_cached_ += record->files_cached_;
+			result.bytes_read_ += record->bytes_read_;
+			result.bytes_written_ += record->bytes_written_;
+			result.match_cache_front_hits_ += record->match_cache_front_hits_;
+			result.match_cache_shared_hits_ += record->match_cache_shared_hits_;
+			result.match_cache_misses_ += record->match_cache_misses_;
+			result.busy_time_ += record->busy_time_;
+			result.idle_time_ += record->idle_time_;
 			
-			while (position < std::ssize(content) and content[position] != '"')
+			for (std::size_t i = 0; i != stage_names.size(); ++i)
 			{
-				if (content.substr(position, 2) == "\\\\"
-					or content.substr(position, 2) == "\\\"")
-				{
-					position += 2;
-				}
-				else
+				result.stage_times_[i] += record->stage_times_[i];
+			}
+			
+			for (auto [hits, record_hits] : {
+				std::pair(&result.name_hits_, &record->name_hits_),
+				std::pair(&result.pattern_hits_, &record->pattern_hits_),
+				std::pair(&result.module_pattern_hits_, &record->module_pattern_hits_),
+			})
+			{
+				for (std::size_t i = 0; i != hits->size(); ++i)
 				{
-					++position;
+					(*hits)[i] += (*record_hits)[i];
 				}
 			}
+			
+			result.slowest_files_.insert(result.slowest_files_.end(), record->slowest_files_.begin(), record->slowest_files_.end());
 		}
-		else if (stack != 0 and content[position] == ')')
+		
+		std::ranges::sort(result.slowest_files_, std::greater(), &File_time::time_);
+		
+		if (std::ssize(result.slowest_files_) > slowest_count_)
 		{
-			--stack;
+			result.slowest_files_.resize(slowest_count_);
 		}
-		else if (content[position] == '(')
+		
+		return result;
+	}
+	
+	//! @return The records of the worker threads ordered by their index.
+	[[nodiscard]] std::vector<Statistics_record> workers() const
+	{
+		auto result = std::vector<Statistics_record>();
+		
+		for (const auto& record : records_.lock().get())
 		{
-			++stack;
+			if (record->worker_ != -1)
+			{
+				result.push_back(*record);
+			}
 		}
 		
-		++position;
+		std::ranges::sort(result, {}, &Statistics_record::worker_);
+		
+		return result;
 	}
 	
-	return std::ssize(content);
-}
+	std::vector<std::string_view> names_;
+	std::vector<std::string_view> patterns_;
+	std::vector<std::string_view> module_patterns_;
+	
+private:
+	//! @return The record into which the current thread counts hits.
+	Statistics_record& hits()
+	{
+		auto& result = record();
+		return result.capture_ ? *result.capture_ : result;
+	}
+	
+	std::ptrdiff_t slowest_count_;
+	Thread_slot<Statistics_record> slot_;
+	mutable Mutex<std::vector<std::unique_ptr<Statistics_record>>> records_;
+};
+
+struct String_hash : std::hash<std::string_view>
+{
+	using is_transparent = void;
+};
 
 /*!
- * Iterates over @p content starting at @p position to find the next Java
- * annotation.
- * 
- * @return A pair consisting of the whole extent of the annotation as present in
- * the @p content and the name of the annotation with all whitespace and comments
- * stripped. If no annotation is found, returns a view pointing past the
- * @p content with length 0 and an empty string.
+ * Memoized results of searching names with a Regex_set during one run. Each
+ * result is the index of the first matching pattern or `-1`. Every thread has
+ * its own front table which is looked up without locking, misses go to a
+ * shared table split into shards with separate locks.
  */
-inline std::tuple<std::string_view, std::string> next_annotation(std::string_view content, std::ptrdiff_t position = 0)
+struct Match_cache
 {
-	auto result = std::string();
-	auto end_pos = std::ssize(content);
-	position = find_token(content, "@", position);
-	bool expecting_dot = false;
+	explicit Match_cache(const Regex_set& patterns) noexcept
+		:
+		patterns_(&patterns),
+		id_(next_id_.fetch_add(1, std::memory_order_relaxed))
+	{
+	}
 	
-	if (position < std::ssize(content))
+	[[nodiscard]] const Regex_set& patterns() const noexcept
 	{
-		auto symbol = std::string_view();
-		std::tie(symbol, end_pos) = next_symbol(content, position + 1);
-		auto new_end_pos = end_pos;
+		return *patterns_;
+	}
+	
+	/*!
+	 * @return The index of the first pattern matching @p name or `-1` if no
+	 * pattern matches it. The lookup is counted in @p statistics if it is not
+	 * null.
+	 */
+	std::ptrdiff_t find_first(std::string_view name, Statistics* statistics = nullptr)
+	{
+		thread_local auto front_id = std::uint64_t(0);
+		thread_local auto front = Table();
 		
-		while (not symbol.empty())
+		if (front_id != id_ or std::ssize(front) == max_front_size)
 		{
-			// catch `@A ...`
-			if (symbol == "." and content.substr(new_end_pos).starts_with(".."))
-			{
-				break;
-			}
+			front.clear();
+			front_id = id_;
+		}
+		
+		if (auto it = front.find(name); it != front.end())
+		{
+			count(statistics, &Statistics_record::match_cache_front_hits_);
+			return it->second;
+		}
+		
+		auto& shard = shards_[String_hash()(name) % shards_.size()];
+		
+		{
+			auto table = shard.lock();
 			
-			if (expecting_dot and symbol != ".")
+			if (auto it = table.get().find(name); it != table.get().end())
 			{
-				if (symbol == "(")
-				{
-					end_pos = find_token(content, ")", new_end_pos);
-					
-					if (end_pos == std::ssize(content))
-					{
-						result = std::string();
-						position = end_pos;
-						break;
-					}
-					
-					++end_pos;
-				}
-				
-				break;
+				count(statistics, &Statistics_record::match_cache_shared_hits_);
+				return front.try_emplace(it->first, it->second).first->second;
 			}
-			
-			result += symbol;
-			expecting_dot = not expecting_dot;
-			end_pos = new_end_pos;
-			std::tie(symbol, new_end_pos) = next_symbol(content, new_end_pos);
 		}
+		
+		count(statistics, &Statistics_record::match_cache_misses_);
+		auto result = std::ptrdiff_t(-1);
+		
+		if (auto matched = Bitset(patterns_->size()); patterns_->search(name, matched))
+		{
+			result = matched.find_first();
+		}
+		
+		shard.lock().get().try_emplace(std::string(name), result);
+		
+		return front.try_emplace(std::string(name), result).first->second;
 	}
 	
-	return std::tuple(content.substr(position, end_pos - position), std::move(result));
-}
+private:
+	using Table = std::unordered_map<std::string, std::ptrdiff_t, String_hash, std::equal_to<>>;
+	
+	static constexpr std::ptrdiff_t max_front_size = 4096;
+	
+	static void count(Statistics* statistics, std::ptrdiff_t Statistics_record::* counter)
+	{
+		if (statistics)
+		{
+			++(statistics->record().*counter);
+		}
+	}
+	
+	inline static auto next_id_ = std::atomic<std::uint64_t>(1);
+	
+	const Regex_set* patterns_;
+	std::uint64_t id_;
+	std::array<Mutex<Table>, 16> shards_;
+};
 
 /*!
- * @param name Class name found in code, may be fully-qualified or simple.
- * @param patterns A range of patterns.
- * @param names A table of names, these are matched exactly by the simple class
- * names.
- * @param imported_names Names that have their import declarations removed. In
- * this case, we match the full name, and this will only remove names that are
- * used in their simple form in code (therefore, they refer to the removed
- * import declaration. If a name is used in its fully qualified form in the
- * code, it will be caught by the other matchers.
- * 
- * @return The simple class name.
+ * The state of a run which handling files records into or looks results up
+ * in, passed explicitly so that runs do not share anything. A null member
+ * disables its feature. The jobs of a jobs file count their hits in their own
+ * Statistics, whose matchers are numbered differently from those of the run.
  */
-inline bool name_matches(std::string_view name, std::span<const Named_regex> patterns,
-	const String_view_set& names, const String_map& imported_names) noexcept
+struct Context
 {
-	auto simple_name = name;
+	Strict_mode* strict_mode_ = nullptr;
 	
-	if (auto pos = name.rfind('.'); pos != name.npos)
-	{
-		simple_name = name.substr(pos + 1);
-	}
+	//! Where the times of stages, the counters of files and of the match cache go
+	Statistics* statistics_ = nullptr;
+	
+	//! Where the hits of matchers are counted
+	Statistics* hits_ = nullptr;
 	
-	if (names.contains(simple_name))
+	//! Only used by matching with the patterns it was made for
+	Match_cache* match_cache_ = nullptr;
+	
+	Content_cache* content_cache_ = nullptr;
+	Ordered_output* ordered_output_ = nullptr;
+	Tracer* tracer_ = nullptr;
+};
+
+/*!
+ * Adds the time from its construction to its destruction to a stage of the
+ * record of the current thread in the statistics of a Context and adds it as a
+ * span named by the stage to its tracer, if either is present. Traversal spans
+ * are added to their own track.
+ */
+struct Stage_timer
+{
+	//! @param detail Must outlive the timer.
+	explicit Stage_timer(const Context& context, Stage stage, std::string_view detail = {}) noexcept
+		:
+		statistics_(context.statistics_),
+		tracer_(context.tracer_),
+		stage_(stage),
+		detail_(detail)
 	{
-		if (strict_mode)
+		if (statistics_ or tracer_)
 		{
-			strict_mode->names_matched_.lock().get().at(simple_name) = true;
+			start_ = std::chrono::steady_clock::now();
 		}
-		
-		return true;
 	}
 	
-	if (auto it = imported_names.find(simple_name); it != imported_names.end())
+	Stage_timer(const Stage_timer&) = delete;
+	Stage_timer& operator=(const Stage_timer&) = delete;
+	
+	~Stage_timer()
 	{
-		if (name == simple_name or it->second == name)
+		if (not statistics_ and not tracer_)
 		{
-			return true;
+			return;
 		}
-	}
-	
-	for (const auto& pattern : patterns)
-	{
-		if (std::regex_search(name.begin(), name.end(), pattern))
+		
+		auto end = std::chrono::steady_clock::now();
+		auto index = static_cast<std::size_t>(stage_);
+		
+		if (statistics_)
 		{
-			if (strict_mode)
-			{
-				strict_mode->patterns_matched_.lock().get().at(pattern) = true;
-			}
-			
-			return true;
+			statistics_->record().stage_times_[index] += end - start_;
+		}
+		
+		if (tracer_ and stage_ == Stage::traversal)
+		{
+			tracer_->add_async(stage_names[index], start_, end, detail_);
+		}
+		else if (tracer_)
+		{
+			tracer_->add(stage_names[index], start_, end, detail_);
 		}
 	}
 	
-	return false;
-}
+private:
+	Statistics* statistics_;
+	Tracer* tracer_;
+	Stage stage_;
+	std::string_view detail_;
+	std::chrono::steady_clock::time_point start_;
+};
 
 /*!
- * Iterates over @p content to find newline starting from position @p pos.
+ * Helper functions for manipulating java symbols
+ */
+namespace java_symbols
+{
+/*!
+ * Iterates over @p content starting at @p position to find the first character
+ * which is not part of a Java comment nor a whitespace character.
  * 
- * @return The position of the newline or `-1` if not found.
+ * @return The position of the first non-whitespace non-comment character or the
+ * length of the string if none is found.
  */
-inline std::ptrdiff_t find_newline(std::string_view content, std::ptrdiff_t pos)
+inline std::ptrdiff_t ignore_whitespace_comments(std::string_view content, std::ptrdiff_t position) noexcept
 {
-	while (pos != std::ssize(content) and std::isspace(static_cast<unsigned char>(content[pos])))
+	while (position != std::ssize(content))
 	{
-		if (content[pos] == '\n')
+		position = char_scan::find_not<char_scan::whitespace>(content, position);
+		
+		if (position == std::ssize(content))
+		{
+			break;
+		}
+		
+		auto result = position;
+		
+		if (auto subst = content.substr(position, 2); subst == "//")
+		{
+			position = content.find('\n', position + 2);
+			
+			if (position == std::ptrdiff_t(content.npos))
+			{
+				return std::ssize(content);
+			}
+			
+			++position;
+		}
+		else if (subst == "/*")
+		{
+			position = content.find("*/", position + 2);
+			
+			if (position == std::ptrdiff_t(content.npos))
+			{
+				return std::ssize(content);
+			}
+			
+			position += 2;
+		}
+		
+		if (result == position)
+		{
+			return result;
+		}
+	}
+	
+	return position;
+}
+
+inline bool is_identifier_char(char c) noexcept
+{
+	return char_scan::is_a(c, char_scan::identifier);
+}
+
+/*!
+ * Finds the longest sequence of identifier characters which is present in every
+ * string matched by the POSIX extended regular expression @p pattern. Names are
+ * matched with whitespace and comments removed, therefore only sequences of
+ * identifier characters are guaranteed to be present verbatim in the source
+ * code.
+ * 
+ * @return The literal or std::nullopt if no such literal could be determined.
+ */
+inline std::optional<std::string> required_literal(std::string_view pattern)
+{
+	auto result = std::string();
+	auto current = std::string();
+	auto depth = std::ptrdiff_t(0);
+	bool last_atom_in_current = false;
+	
+	auto end_current = [&]() -> void
+	{
+		if (current.size() > result.size())
+		{
+			result = current;
+		}
+		
+		current.clear();
+		last_atom_in_current = false;
+	};
+	
+	for (auto i = std::size_t(0); i < pattern.size(); ++i)
+	{
+		auto c = pattern[i];
+		auto literal = std::optional<char>();
+		
+		if (c == '[')
+		{
+			auto end = i + 1;
+			bool negated = end < pattern.size() and pattern[end] == '^';
+			
+			if (negated)
+			{
+				++end;
+			}
+			
+			auto first = end;
+			
+			if (end < pattern.size() and pattern[end] == ']')
+			{
+				++end;
+			}
+			
+			while (end < pattern.size() and pattern[end] != ']')
+			{
+				if (pattern[end] == '[' and end + 1 < pattern.size()
+					and (pattern[end + 1] == ':' or pattern[end + 1] == '=' or pattern[end + 1] == '.'))
+				{
+					end = pattern.find(std::string{pattern[end + 1], ']'}, end + 2);
+					
+					if (end == pattern.npos)
+					{
+						return std::nullopt;
+					}
+					
+					end += 2;
+				}
+				else
+				{
+					++end;
+				}
+			}
+			
+			if (end >= pattern.size())
+			{
+				return std::nullopt;
+			}
+			
+			if (not negated and end == first + 1)
+			{
+				literal = pattern[first];
+			}
+			
+			i = end;
+		}
+		else if (c == '|' and depth == 0)
+		{
+			return std::nullopt;
+		}
+		else if (c == '(' or c == ')')
+		{
+			depth += c == '(' ? 1 : -1;
+		}
+		else if (c == '*' or c == '?' or c == '{')
+		{
+			if (last_atom_in_current)
+			{
+				current.pop_back();
+			}
+			
+			if (c == '{' and (i = pattern.find('}', i)) == pattern.npos)
+			{
+				return std::nullopt;
+			}
+		}
+		else if (c == '\\')
+		{
+			++i;
+		}
+		else if (c != '+' and c != '.' and c != '^' and c != '$')
+		{
+			literal = c;
+		}
+		
+		if (literal and depth == 0 and is_identifier_char(*literal))
+		{
+			current += *literal;
+			last_atom_in_current = true;
+		}
+		else
+		{
+			end_current();
+		}
+	}
+	
+	end_current();
+	
+	if (result.empty())
+	{
+		return std::nullopt;
+	}
+	
+	return result;
+}
+
+/*!
+ * Creates a filter of contents which can contain a name matched by any of
+ * @p patterns or @p names.
+ * 
+ * @return The filter or std::nullopt if a required literal could not be found
+ * for some of the patterns.
+ */
+inline std::optional<Literal_filter> make_literal_filter(std::span<const std::string_view> patterns, std::span<const std::string_view> names)
+{
+	auto literals = std::vector<std::string>(names.begin(), names.end());
+	
+	for (auto pattern : patterns)
+	{
+		auto literal = required_literal(pattern);
+		
+		if (not literal)
+		{
+			return std::nullopt;
+		}
+		
+		literals.push_back(std::move(*literal));
+	}
+	
+	return Literal_filter(literals);
+}
+
+/*!
+ * Iterates over @p content starting at @p position to find the next uncommented
+ * symbol and returns it and an index pointing past it. The symbol is either a
+ * sequence of alphanumeric characters or a single non-alphanumeric character or
+ * an empty string if the end has been reached.
+ */
+inline std::tuple<std::string_view, std::ptrdiff_t> next_symbol(std::string_view content, std::ptrdiff_t position = 0) noexcept
+{
+	auto symbol_length = std::ptrdiff_t(0);
+	
+	if (position < std::ssize(content))
+	{
+		position = ignore_whitespace_comments(content, position);
+		
+		if (position < std::ssize(content))
+		{
+			symbol_length = 1;
+			
+			if (is_identifier_char(content[position]))
+			{
+				while (position + symbol_length != std::ssize(content) and is_identifier_char(content[position + symbol_length]))
+				{
+					++symbol_length;
+				}
+			}
+		}
+	}
+	
+	return std::tuple(content.substr(position, symbol_length), position + symbol_length);
+}
+
+/*!
+ * Iterates over @p content starting at @p position to find a string @p token
+ * which is present in the source code neither inside a comment nor inside a
+ * string nor inside a character literal.
+ * 
+ * Special case when @p token == ')', this function counts opening and closing
+ * parentheses and returns the first parenthesis outside.
+ * 
+ * @param alphanumeric If true, considers only tokens that are surrounded by
+ * whitespace, comments or are at the boundaries of @p content.
+ * 
+ * @return The starting index of the token or the length of @p content if not
+ * found.
+ */
+inline std::ptrdiff_t find_token(std::string_view content, std::string_view token,
+	std::ptrdiff_t position = 0, bool alphanumeric = false, std::ptrdiff_t stack = 0) noexcept
+{
+	while (position + std::ssize(token) <= std::ssize(content))
+	{
+		position = ignore_whitespace_comments(content, position);
+		
+		if (position == std::ssize(content))
+		{
+			break;
+		}
+		
+		auto substr = content.substr(position, token.length());
+		
+		if ((token != ")" or stack == 0) and substr == token
+			and not (alphanumeric and ((position > 0 and is_identifier_char(content[position - 1]))
+				or (position + std::ssize(token) < std::ssize(content) and (is_identifier_char(content[position + token.length()]))))))
+		{
+			return position;
+		}
+		else if (content[position] == '\'')
+		{
+			if (content.substr(position, 4) == "'\\''")
+			{
+				position += 3;
+			}
+			else
+			{
+				do
+				{
+					++position;
+				}
+				while (position < std::ssize(content) and content[position] != '\'');
+			}
+		}
+		else if (content[position] == '"')
+		{
+			++position;
+			
+			// Only quotes and backslashes matter inside a string or a text block
+			while ((position = char_scan::find_any<char_scan::quote | char_scan::backslash>(content, position)) < std::ssize(content)
+				and content[position] != '"')
+			{
+				position += content.substr(position, 2) == "\\\\" or content.substr(position, 2) == "\\\"" ? 2 : 1;
+			}
+		}
+		else if (stack != 0 and content[position] == ')')
+		{
+			--stack;
+		}
+		else if (content[position] == '(')
+		{
+			++stack;
+		}
+		
+		++position;
+	}
+	
+	return std::ssize(content);
+}
+
+/*!
+ * A name concatenated from parts of a content, such as a qualified name split
+ * into tokens. The name is a view of the content as long as the parts are
+ * adjacent in it, the parts are copied into an owned string only if whitespace
+ * or comments are embedded in the name.
+ */
+struct Qualified_name
+{
+	Qualified_name() = default;
+	
+	//! A name viewing @p name, which must outlive it
+	explicit Qualified_name(std::string_view name) noexcept
+		:
+		view_(name)
+	{
+	}
+	
+	//! Appends @p part, which is a view of the same content as the previous parts.
+	void append(std::string_view part)
+	{
+		if (is_normalized_)
+		{
+			normalized_ += part;
+		}
+		else if (view_.empty())
+		{
+			view_ = part;
+		}
+		else if (view_.data() + view_.size() == part.data())
+		{
+			view_ = std::string_view(view_.data(), view_.size() + part.size());
+		}
+		else
+		{
+			normalized_.reserve(view_.size() + part.size());
+			normalized_ = view_;
+			normalized_ += part;
+			is_normalized_ = true;
+		}
+	}
+	
+	void clear() noexcept
+	{
+		view_ = std::string_view();
+		normalized_.clear();
+		is_normalized_ = false;
+	}
+	
+	[[nodiscard]] std::string_view view() const noexcept
+	{
+		return is_normalized_ ? std::string_view(normalized_) : view_;
+	}
+	
+	//! @return True if the name had to be copied.
+	[[nodiscard]] bool is_normalized() const noexcept
+	{
+		return is_normalized_;
+	}
+	
+	friend bool operator==(const Qualified_name& name, std::string_view other) noexcept
+	{
+		return name.view() == other;
+	}
+	
+	friend std::ostream& operator<<(std::ostream& os, const Qualified_name& name)
+	{
+		return os << name.view();
+	}
+	
+private:
+	std::string_view view_;
+	std::string normalized_;
+	bool is_normalized_ = false;
+};
+
+/*!
+ * The simple names of the classes whose import declarations were removed from
+ * a content and their qualified names. The names are kept sorted by the simple
+ * names in a vector of offsets and lengths, either in the content or, for the
+ * normalized names and the names not taken from the content, in a single
+ * buffer shared by all the names.
+ */
+struct Imported_names
+{
+	Imported_names() = default;
+	
+	//! @param source The content of which the added names are views, must outlive this.
+	explicit Imported_names(std::string_view source) noexcept
+		:
+		source_(source)
+	{
+	}
+	
+	Imported_names(std::initializer_list<std::string_view> names)
+	{
+		for (auto name : names)
+		{
+			add(Qualified_name(name));
+		}
+	}
+	
+	//! Adds @p name unless a name with the same simple name is present.
+	void add(const Qualified_name& name)
+	{
+		auto view = name.view();
+		auto it = lower_bound(simple_name(view));
+		
+		if (it != entries_.end() and simple_name(this->view(*it)) == simple_name(view))
+		{
+			return;
+		}
+		
+		auto entry = Entry(0, std::ssize(view), false);
+		
+		if (not name.is_normalized() and std::less_equal()(source_.data(), view.data())
+			and std::less_equal()(view.data() + view.size(), source_.data() + source_.size()))
+		{
+			entry.offset_ = view.data() - source_.data();
+		}
+		else
+		{
+			entry.offset_ = std::ssize(buffer_);
+			entry.in_buffer_ = true;
+			buffer_ += view;
+		}
+		
+		entries_.insert(it, entry);
+	}
+	
+	//! @return The qualified name whose simple name is @p simple_name or std::nullopt.
+	[[nodiscard]] std::optional<std::string_view> find(std::string_view simple_name) const noexcept
+	{
+		auto it = lower_bound(simple_name);
+		
+		if (it == entries_.end() or Imported_names::simple_name(view(*it)) != simple_name)
+		{
+			return std::nullopt;
+		}
+		
+		return view(*it);
+	}
+	
+	[[nodiscard]] bool empty() const noexcept
+	{
+		return entries_.empty();
+	}
+	
+	void clear() noexcept
+	{
+		entries_.clear();
+		buffer_.clear();
+	}
+	
+	/*!
+	 * @return The part of @p name following the last dot, a name without a dot
+	 * has an empty simple name.
+	 */
+	static std::string_view simple_name(std::string_view name) noexcept
+	{
+		auto pos = name.rfind('.');
+		return pos == name.npos ? std::string_view() : name.substr(pos + 1);
+	}
+	
+private:
+	struct Entry
+	{
+		std::ptrdiff_t offset_ = 0;
+		std::ptrdiff_t length_ = 0;
+		bool in_buffer_ = false;
+	};
+	
+	[[nodiscard]] std::string_view view(const Entry& entry) const noexcept
+	{
+		return (entry.in_buffer_ ? std::string_view(buffer_) : source_).substr(entry.offset_, entry.length_);
+	}
+	
+	//! @return The first entry whose simple name is not less than @p simple_name.
+	[[nodiscard]] std::vector<Entry>::const_iterator lower_bound(std::string_view simple_name) const noexcept
+	{
+		return std::ranges::lower_bound(entries_, simple_name, {}, [this](const Entry& entry) noexcept -> std::string_view
+		{
+			return Imported_names::simple_name(view(entry));
+		});
+	}
+	
+	std::string_view source_;
+	std::vector<Entry> entries_;
+	std::string buffer_;
+};
+
+/*!
+ * Iterates over @p content starting at @p position to find the next Java
+ * annotation.
+ * 
+ * @return A pair consisting of the whole extent of the annotation as present in
+ * the @p content and the name of the annotation with all whitespace and comments
+ * stripped. If no annotation is found, returns a view pointing past the
+ * @p content with length 0 and an empty name.
+ */
+inline std::tuple<std::string_view, Qualified_name> next_annotation(std::string_view content, std::ptrdiff_t position = 0)
+{
+	auto result = Qualified_name();
+	auto end_pos = std::ssize(content);
+	position = find_token(content, "@", position);
+	bool expecting_dot = false;
+	
+	if (position < std::ssize(content))
+	{
+		auto symbol = std::string_view();
+		std::tie(symbol, end_pos) = next_symbol(content, position + 1);
+		auto new_end_pos = end_pos;
+		
+		while (not symbol.empty())
+		{
+			// catch `@A ...`
+			if (symbol == "." and content.substr(new_end_pos).starts_with(".."))
+			{
+				break;
+			}
+			
+			if (expecting_dot and symbol != ".")
+			{
+				if (symbol == "(")
+				{
+					end_pos = find_token(content, ")", new_end_pos);
+					
+					if (end_pos == std::ssize(content))
+					{
+						result.clear();
+						position = end_pos;
+						break;
+					}
+					
+					++end_pos;
+				}
+				
+				break;
+			}
+			
+			result.append(symbol);
+			expecting_dot = not expecting_dot;
+			end_pos = new_end_pos;
+			std::tie(symbol, new_end_pos) = next_symbol(content, new_end_pos);
+		}
+	}
+	
+	return std::tuple(content.substr(position, end_pos - position), std::move(result));
+}
+
+/*!
+ * @param name Class name found in code, may be fully-qualified or simple.
+ * @param patterns A range of patterns.
+ * @param names A table of names, these are matched exactly by the simple class
+ * names.
+ * @param imported_names Names that have their import declarations removed. In
+ * this case, we match the full name, and this will only remove names that are
+ * used in their simple form in code (therefore, they refer to the removed
+ * import declaration. If a name is used in its fully qualified form in the
+ * code, it will be caught by the other matchers.
+ * @param context The matches are marked in its strict mode, their hits counted
+ * and the patterns searched through its match cache.
+ * 
+ * @return The simple class name.
+ */
+inline bool name_matches(std::string_view name, const Regex_set& patterns,
+	const Name_set& names, const Imported_names& imported_names, const Context& context = {}) noexcept
+{
+	auto simple_name = name;
+	
+	if (auto pos = name.rfind('.'); pos != name.npos)
+	{
+		simple_name = name.substr(pos + 1);
+	}
+	
+	auto* strict = context.strict_mode_;
+	auto* counted = context.hits_;
+	
+	if (auto index = names.find(simple_name); index != -1)
+	{
+		if (strict)
+		{
+			strict->mark_name(index);
+		}
+		
+		if (counted)
+		{
+			counted->count_name(index);
+		}
+		
+		return true;
+	}
+	
+	if (auto imported_name = imported_names.find(simple_name))
+	{
+		if (name == simple_name or *imported_name == name)
+		{
+			return true;
+		}
+	}
+	
+	if (auto* cache = context.match_cache_; cache and &cache->patterns() == &patterns)
+	{
+		auto index = cache->find_first(name, context.statistics_);
+		
+		if (index != -1 and strict)
+		{
+			strict->mark_pattern(index);
+		}
+		
+		if (index != -1 and counted)
+		{
+			counted->count_pattern(index);
+		}
+		
+		return index != -1;
+	}
+	
+	if (not strict and not counted)
+	{
+		return patterns.search(name);
+	}
+	
+	auto matched = Bitset(patterns.size());
+	
+	if (patterns.search(name, matched))
+	{
+		if (strict)
+		{
+			strict->mark_pattern(matched.find_first());
+		}
+		
+		if (counted)
+		{
+			counted->count_pattern(matched.find_first());
+		}
+		
+		return true;
+	}
+	
+	return false;
+}
+
+/*!
+ * Iterates over @p content to find newline starting from position @p pos.
+ * 
+ * @return The position of the newline or `-1` if not found.
+ */
+inline std::ptrdiff_t find_newline(std::string_view content, std::ptrdiff_t pos)
+{
+	auto end = char_scan::find_not<char_scan::whitespace>(content, pos);
+	
+	if (auto newline = content.substr(pos, end - pos).find('\n'); newline != content.npos)
+	{
+		return pos + std::ptrdiff_t(newline);
+	}
+	
+	return -1;
+}
+
+/*!
+ * Kinds of tokens produced by the Lexer.
+ */
+enum class Token_kind : std::uint8_t
+{
+	identifier,
+	punctuation,
+	string_literal,
+	character_literal,
+};
+
+/*!
+ * A token of Java source code stored as a range of the lexed content.
+ * Whitespace and comments are not represented, they are the gaps between
+ * tokens.
+ */
+struct Token
+{
+	std::ptrdiff_t offset_ = 0;
+	std::ptrdiff_t length_ = 0;
+	Token_kind kind_ = Token_kind::punctuation;
+	
+	[[nodiscard]] std::ptrdiff_t end() const noexcept
+	{
+		return offset_ + length_;
+	}
+	
+	[[nodiscard]] std::string_view text(std::string_view content) const noexcept
+	{
+		return content.substr(offset_, length_);
+	}
+	
+	[[nodiscard]] bool is_punctuation(std::string_view content, char c) const noexcept
+	{
+		return kind_ == Token_kind::punctuation and content[offset_] == c;
+	}
+	
+	[[nodiscard]] bool is_identifier(std::string_view content, std::string_view identifier) const noexcept
+	{
+		return kind_ == Token_kind::identifier and text(content) == identifier;
+	}
+};
+
+/*!
+ * Splits content into tokens following the same rules as find_token and
+ * next_symbol: whitespace and comments are skipped, string and character
+ * literals form a single token, a sequence of identifier characters forms a
+ * single token and every other character is a token on its own.
+ */
+struct Lexer
+{
+	explicit Lexer(std::string_view content, std::ptrdiff_t position = 0) noexcept
+		:
+		content_(content),
+		position_(position)
+	{
+	}
+	
+	/*!
+	 * @return The next token or std::nullopt if the end of the content has been
+	 * reached.
+	 */
+	std::optional<Token> next() noexcept
+	{
+		position_ = ignore_whitespace_comments(content_, position_);
+		
+		if (position_ == std::ssize(content_))
+		{
+			return std::nullopt;
+		}
+		
+		auto token = Token(position_, 1, Token_kind::punctuation);
+		auto end = position_ + 1;
+		
+		if (content_[position_] == '"')
+		{
+			token.kind_ = Token_kind::string_literal;
+			
+			while ((end = char_scan::find_any<char_scan::quote | char_scan::backslash>(content_, end)) < std::ssize(content_)
+				and content_[end] != '"')
+			{
+				if (content_.substr(end, 2) == "\\\\" or content_.substr(end, 2) == "\\\"")
+				{
+					end += 2;
+				}
+				else
+				{
+					++end;
+				}
+			}
+			
+			++end;
+		}
+		else if (content_[position_] == '\'')
+		{
+			token.kind_ = Token_kind::character_literal;
+			
+			if (content_.substr(position_, 4) == "'\\''")
+			{
+				end = position_ + 4;
+			}
+			else
+			{
+				end = std::ptrdiff_t(std::min(content_.find('\'', end), content_.size())) + 1;
+			}
+		}
+		else if (is_identifier_char(content_[position_]))
+		{
+			token.kind_ = Token_kind::identifier;
+			
+			end = char_scan::find_not<char_scan::identifier>(content_, end);
+		}
+		
+		position_ = std::min(end, std::ssize(content_));
+		token.length_ = position_ - token.offset_;
+		
+		return token;
+	}
+	
+	[[nodiscard]] std::ptrdiff_t position() const noexcept
+	{
+		return position_;
+	}
+	
+private:
+	std::string_view content_;
+	std::ptrdiff_t position_;
+};
+
+/*!
+ * Lexes the whole @p content at once, adding a span to @p tracer if it is not
+ * null.
+ */
+inline std::vector<Token> tokenize(std::string_view content, Tracer* tracer = nullptr)
+{
+	auto span = Trace_span(tracer, "lex");
+	auto result = std::vector<Token>();
+	result.reserve(content.size() / 8);
+	auto lexer = Lexer(content);
+	
+	while (auto token = lexer.next())
+	{
+		result.push_back(*token);
+	}
+	
+	return result;
+}
+
+/*!
+ * Iterates over @p tokens starting at @p index to find the first `)` token
+ * which closes an already open parenthesis, nested parentheses are skipped.
+ * 
+ * @return The index of the parenthesis or the size of @p tokens if not found.
+ */
+inline std::ptrdiff_t find_closing_parenthesis(std::string_view content, std::span<const Token> tokens, std::ptrdiff_t index) noexcept
+{
+	auto stack = std::ptrdiff_t(0);
+	
+	for (; index != std::ssize(tokens); ++index)
+	{
+		if (tokens[index].is_punctuation(content, ')'))
+		{
+			if (stack == 0)
+			{
+				break;
+			}
+			
+			--stack;
+		}
+		else if (tokens[index].is_punctuation(content, '('))
+		{
+			++stack;
+		}
+	}
+	
+	return index;
+}
+
+/*!
+ * Concatenates @p tokens starting at @p index up to the next `;` token.
+ * 
+ * @return The concatenated name and the index of the `;` token or std::nullopt
+ * if there is no such token.
+ */
+inline std::optional<std::tuple<Qualified_name, std::ptrdiff_t>> concatenate_until_semicolon(
+	std::string_view content, std::span<const Token> tokens, std::ptrdiff_t index)
+{
+	auto result = Qualified_name();
+	
+	for (; index != std::ssize(tokens); ++index)
+	{
+		if (tokens[index].is_punctuation(content, ';'))
+		{
+			return std::tuple(std::move(result), index);
+		}
+		
+		result.append(tokens[index].text(content));
+	}
+	
+	return std::nullopt;
+}
+
+/*!
+ * Token based counterpart of next_annotation, @p index is the index of the `@`
+ * token.
+ * 
+ * @return A tuple consisting of the whole extent of the annotation as present in
+ * the @p content, the name of the annotation with all whitespace and comments
+ * stripped and the index of the first token following the annotation. If the
+ * parentheses of the annotation are not closed, returns std::nullopt.
+ */
+inline std::optional<std::tuple<std::string_view, Qualified_name, std::ptrdiff_t>> parse_annotation(
+	std::string_view content, std::span<const Token> tokens, std::ptrdiff_t index)
+{
+	auto begin = tokens[index].offset_;
+	auto end_pos = std::ssize(content);
+	auto name = Qualified_name();
+	bool expecting_dot = false;
+	
+	if (++index != std::ssize(tokens))
+	{
+		end_pos = tokens[index].end();
+	}
+	
+	for (; index != std::ssize(tokens); ++index)
+	{
+		const auto& token = tokens[index];
+		
+		// catch `@A ...`
+		if (token.is_punctuation(content, '.') and content.substr(token.end()).starts_with(".."))
+		{
+			break;
+		}
+		
+		if (expecting_dot and not token.is_punctuation(content, '.'))
+		{
+			if (token.is_punctuation(content, '('))
+			{
+				index = find_closing_parenthesis(content, tokens, index + 1);
+				
+				if (index == std::ssize(tokens))
+				{
+					return std::nullopt;
+				}
+				
+				end_pos = tokens[index].end();
+			}
+			
+			break;
+		}
+		
+		name.append(token.text(content));
+		expecting_dot = not expecting_dot;
+		end_pos = token.end();
+	}
+	
+	while (index != std::ssize(tokens) and tokens[index].offset_ < end_pos)
+	{
+		++index;
+	}
+	
+	return std::tuple(content.substr(begin, end_pos - begin), std::move(name), index);
+}
+
+/*!
+ * An import declaration found by parse_import.
+ */
+struct Import_declaration
+{
+	//! The position of the `import` token
+	std::ptrdiff_t begin_ = 0;
+	
+	//! The position past the `;` token and the following newline, if any
+	std::ptrdiff_t end_ = 0;
+	
+	//! The index of the `;` token
+	std::ptrdiff_t semicolon_index_ = 0;
+	
+	Qualified_name name_;
+	bool is_static_ = false;
+	bool matches_ = false;
+};
+
+/*!
+ * Parses the import declaration at @p index, which is the index of an `import`
+ * token, and matches it against @p patterns and @p names in @p context.
+ * 
+ * @return The parsed declaration or std::nullopt if it is not terminated by
+ * `;`.
+ */
+inline std::optional<Import_declaration> parse_import(std::string_view content, std::span<const Token> tokens,
+	std::ptrdiff_t index, const Regex_set& patterns, const Name_set& names, const Context& context = {})
+{
+	auto result = Import_declaration();
+	result.begin_ = tokens[index].offset_;
+	
+	const auto empty_set = Name_set();
+	const auto* names_passed = &names;
+	
+	if (++index != std::ssize(tokens) and tokens[index].is_identifier(content, "static"))
+	{
+		result.is_static_ = true;
+		names_passed = &empty_set;
+		++index;
+	}
+	
+	auto parsed_import = concatenate_until_semicolon(content, tokens, index);
+	
+	if (not parsed_import)
+	{
+		return std::nullopt;
+	}
+	
+	std::tie(result.name_, result.semicolon_index_) = std::move(*parsed_import);
+	result.end_ = tokens[result.semicolon_index_].end();
+	
+	if (auto skip_space = find_newline(content, result.end_); skip_space != -1)
+	{
+		result.end_ = skip_space + 1;
+	}
+	
+	auto name = result.name_.view();
+	result.matches_ = name_matches(name, patterns, *names_passed, {}, context);
+	
+	if (result.is_static_)
+	{
+		if (auto pos = name.rfind('.'); pos != name.npos)
+		{
+			result.matches_ = result.matches_ or name_matches(name.substr(0, pos), patterns, names, {}, context);
+		}
+	}
+	
+	return result;
+}
+
+/*!
+ * Records the simple class name of the removed @p declaration in @p removed_classes
+ * unless it is a static or a star import.
+ */
+inline void add_removed_class(Imported_names& removed_classes, const Import_declaration& declaration)
+{
+	// Add only non-star and non-static imports
+	if (not declaration.name_.view().ends_with("*") and not declaration.is_static_)
+	{
+		removed_classes.add(declaration.name_);
+	}
+}
+
+/*!
+ * @return True if the token at @p index starts a class, interface, enum or
+ * record declaration, this marks the end of the header of the compilation unit.
+ * The keyword must be followed by the name of the type and must not be a part
+ * of a package or an import declaration, where `record` is a valid name.
+ */
+inline bool is_type_declaration(std::string_view content, std::span<const Token> tokens, std::ptrdiff_t index) noexcept
+{
+	const auto& token = tokens[index];
+	
+	if (token.kind_ != Token_kind::identifier or index + 1 == std::ssize(tokens)
+		or tokens[index + 1].kind_ != Token_kind::identifier
+		or (index != 0 and tokens[index - 1].is_punctuation(content, '.')))
+	{
+		return false;
+	}
+	
+	if (auto text = token.text(content); text != "class" and text != "interface" and text != "enum" and text != "record")
+	{
+		return false;
+	}
+	
+	// Only modifiers and annotations may precede the keyword in its declaration
+	for (auto previous = index - 1; previous >= 0 and not tokens[previous].is_punctuation(content, ';'); --previous)
+	{
+		if (tokens[previous].is_identifier(content, "import") or tokens[previous].is_identifier(content, "package"))
+		{
+			return false;
+		}
+	}
+	
+	return true;
+}
+
+/*!
+ * Iterates over @p content to remove all import statements provided
+ * as @p patterns and @p names. Patterns match the string representation
+ * following the `import [static]` string. @p names match only the simple
+ * class names.
+ * 
+ * @param header_only If true, stops at the first type declaration, the rest of
+ * @p content is copied without being lexed.
+ * @param context The context in which the imports are matched.
+ * 
+ * @return The resulting string with import statements removed and a map of
+ * removed simple class names to the fully qualified name as present in the
+ * import statement.
+ */
+inline std::tuple<Edited_content, Imported_names> remove_imports(std::string_view content,
+	const Regex_set& patterns, const Name_set& names, bool header_only = false, const Context& context = {})
+{
+	auto result = std::tuple(Edited_content(content), Imported_names(content));
+	auto& [new_content, removed_classes] = result;
+	auto position = std::ptrdiff_t(0);
+	auto lexer = Lexer(content);
+	auto tokens = std::vector<Token>();
+	
+	while (auto token = lexer.next())
+	{
+		auto index = std::ssize(tokens);
+		tokens.push_back(*token);
+		
+		// A type declaration is only known once the name following its keyword is lexed
+		if (header_only and index != 0 and is_type_declaration(content, tokens, index - 1))
+		{
+			break;
+		}
+		
+		if (not token->is_identifier(content, "import"))
+		{
+			continue;
+		}
+		
+		while (not tokens.back().is_punctuation(content, ';') and (token = lexer.next()))
+		{
+			tokens.push_back(*token);
+		}
+		
+		auto declaration = parse_import(content, tokens, index, patterns, names, context);
+		
+		if (not declaration)
+		{
+			new_content = Edited_content(content);
+			removed_classes.clear();
+			return result;
+		}
+		
+		if (declaration->matches_)
+		{
+			new_content.keep(position, declaration->begin_);
+			position = declaration->end_;
+			add_removed_class(removed_classes, *declaration);
+		}
+	}
+	
+	if (position != 0)
+	{
+		new_content.keep(position, std::ssize(content));
+	}
+	
+	return result;
+}
+
+/*!
+ * Iterates over @p content to remove all annotations provided as @p patterns
+ * and @p names. Patterns match the string representation of the annotations as
+ * present in the source code. @p names match only the simple class names.
+ * The annotations are matched in @p context.
+ * 
+ * @return The resulting content with annotations removed.
+ */
+inline Edited_content remove_annotations(std::string_view content, const Regex_set& patterns,
+	const Name_set& names, const Imported_names& imported_names, const Context& context = {})
+{
+	auto position = std::ptrdiff_t(0);
+	auto result = Edited_content(content);
+	const auto tokens = tokenize(content, context.tracer_);
+	auto index = std::ptrdiff_t(0);
+	
+	while (index != std::ssize(tokens))
+	{
+		if (not tokens[index].is_punctuation(content, '@'))
+		{
+			++index;
+			continue;
+		}
+		
+		auto parsed = parse_annotation(content, tokens, index);
+		
+		if (not parsed)
+		{
+			break;
+		}
+		
+		auto& [annotation, annotation_name, next_index] = *parsed;
+		index = next_index;
+		
+		if (annotation_name.view() != "interface" and name_matches(annotation_name.view(), patterns, names, imported_names, context))
+		{
+			result.keep(position, annotation.begin() - content.begin());
+			position = annotation.end() - content.begin();
+			
+			auto skip_space = char_scan::find_not<char_scan::whitespace>(content, position);
+			
+			if (skip_space != std::ssize(content))
+			{
+				position = skip_space;
+			}
+		}
+	}
+	
+	if (position != 0)
+	{
+		result.keep(position, std::ssize(content));
+	}
+	
+	return result;
+}
+
+/*!
+ * The state of removing import declarations and annotations from the tokens of
+ * a compilation unit, which can be scanned in several parts.
+ * 
+ * Annotations are matched against the imports removed before them. Annotations
+ * in the header of the compilation unit, such as those of a package
+ * declaration, are matched once the header ends so that they see all the
+ * imports.
+ */
+struct Import_annotation_scan
+{
+	using Range = std::pair<std::ptrdiff_t, std::ptrdiff_t>;
+	
+	Import_annotation_scan(std::string_view content, const Regex_set& patterns, const Name_set& names,
+		const Context& context = {}) noexcept
+		:
+		content_(content),
+		patterns_(patterns),
+		names_(names),
+		context_(context),
+		removed_classes_(content)
+	{
+	}
+	
+	/*!
+	 * Scans @p tokens, which are tokens of the whole content, and records the
+	 * ranges to remove.
+	 * 
+	 * @return False if an import declaration is not terminated by `;`.
+	 */
+	bool scan(std::span<const Token> tokens)
+	{
+		const auto content = content_;
+		auto index = std::ptrdiff_t(0);
+		
+		while (index != std::ssize(tokens))
+		{
+			if (tokens[index].is_identifier(content, "import"))
+			{
+				import_found_ = true;
+				auto declaration = parse_import(content, tokens, index, patterns_, names_, context_);
+				
+				if (not declaration)
+				{
+					return false;
+				}
+				
+				index = declaration->semicolon_index_ + 1;
+				
+				if (declaration->matches_)
+				{
+					removed_imports_.emplace_back(declaration->begin_, declaration->end_);
+					add_removed_class(removed_classes_, *declaration);
+				}
+			}
+			else if (in_header_ and tokens[index].is_identifier(content, "package"))
+			{
+				while (index != std::ssize(tokens) and not tokens[index].is_punctuation(content, ';'))
+				{
+					++index;
+				}
+			}
+			else if (not annotations_terminated_ and tokens[index].is_punctuation(content, '@'))
+			{
+				auto parsed = parse_annotation(content, tokens, index);
+				
+				if (not parsed)
+				{
+					annotations_terminated_ = true;
+					++index;
+					continue;
+				}
+				
+				auto& [annotation, annotation_name, next_index] = *parsed;
+				index = next_index;
+				
+				if (in_header_ and annotation_name == "interface")
+				{
+					end_header();
+				}
+				
+				if (in_header_)
+				{
+					header_annotations_.emplace_back(annotation, std::move(annotation_name));
+				}
+				else
+				{
+					remove_annotation(annotation, annotation_name);
+				}
+			}
+			else
+			{
+				if (in_header_ and is_type_declaration(content, tokens, index))
+				{
+					end_header();
+				}
+				
+				++index;
+			}
+		}
+		
+		return true;
+	}
+	
+	//! Ends the header, matching the annotations found in it.
+	void end_header()
+	{
+		in_header_ = false;
+		
+		for (const auto& [annotation, annotation_name] : header_annotations_)
+		{
+			remove_annotation(annotation, annotation_name);
+		}
+		
+		header_annotations_.clear();
+	}
+	
+	std::string_view content_;
+	const Regex_set& patterns_;
+	const Name_set& names_;
+	Context context_;
+	Imported_names removed_classes_;
+	std::vector<Range> removed_imports_;
+	std::vector<Range> removed_annotations_;
+	std::vector<std::tuple<std::string_view, Qualified_name>> header_annotations_;
+	bool in_header_ = true;
+	bool annotations_terminated_ = false;
+	bool import_found_ = false;
+	
+private:
+	void remove_annotation(std::string_view annotation, const Qualified_name& annotation_name)
+	{
+		if (annotation_name == "interface" or not name_matches(annotation_name.view(), patterns_, names_, removed_classes_, context_))
+		{
+			return;
+		}
+		
+		auto begin = annotation.begin() - content_.begin();
+		auto end = annotation.end() - content_.begin();
+		auto skip_space = end;
+		
+		while (skip_space != std::ssize(content_))
+		{
+			if (char_scan::is_a(content_[skip_space], char_scan::whitespace))
+			{
+				skip_space = char_scan::find_not<char_scan::whitespace>(content_, skip_space);
+			}
+			else if (auto it = std::ranges::lower_bound(removed_imports_, skip_space, {}, &Range::first);
+				it != removed_imports_.end() and it->first == skip_space)
+			{
+				skip_space = it->second;
+			}
+			else
+			{
+				end = skip_space;
+				break;
+			}
+		}
+		
+		removed_annotations_.emplace_back(begin, end);
+	}
+};
+
+/*!
+ * @return The @p content without the union of the @p removed ranges.
+ */
+inline Edited_content remove_ranges(std::string_view content, std::vector<Import_annotation_scan::Range>&& removed)
+{
+	if (removed.empty())
+	{
+		return Edited_content(content);
+	}
+	
+	std::ranges::sort(removed);
+	
+	auto result = Edited_content(content);
+	auto position = std::ptrdiff_t(0);
+	
+	for (const auto& [begin, end] : removed)
+	{
+		if (begin > position)
+		{
+			result.keep(position, begin);
+		}
+		
+		position = std::max(position, end);
+	}
+	
+	result.keep(position, std::ssize(content));
+	
+	return result;
+}
+
+/*!
+ * Removes import statements and annotations in a single pass over @p content,
+ * the result is the same as calling remove_annotations on the result of
+ * remove_imports.
+ * 
+ * @return The resulting content and whether any annotation was removed.
+ */
+inline std::tuple<Edited_content, bool> remove_imports_annotations(std::string_view content,
+	const Regex_set& patterns, const Name_set& names, const Context& context = {})
+{
+	const auto tokens = tokenize(content, context.tracer_);
+	auto scan = Import_annotation_scan(content, patterns, names, context);
+	
+	if (not scan.scan(tokens))
+	{
+		auto new_content = remove_annotations(content, patterns, names, {}, context);
+		bool annotation_removed = new_content.changed();
+		return std::tuple(std::move(new_content), annotation_removed);
+	}
+	
+	scan.end_header();
+	
+	bool annotation_removed = not scan.removed_annotations_.empty();
+	auto removed = std::move(scan.removed_imports_);
+	removed.insert(removed.end(), scan.removed_annotations_.begin(), scan.removed_annotations_.end());
+	
+	return std::tuple(remove_ranges(content, std::move(removed)), annotation_removed);
+}
+
+/*!
+ * Finds positions at which @p content can be split into parts which are lexed
+ * independently with the same result. A position is a beginning of a line
+ * outside of comments, literals and parentheses where the previous code
+ * character is one of `;`, `{` or `}`, so that no annotation can span it.
+ * Consecutive positions are at least @p min_distance apart.
+ * 
+ * The scan follows the rules of Lexer but only looks at the bytes which can
+ * change its state.
+ * 
+ * @return The positions in increasing order, not including `0` and the length
+ * of @p content.
+ */
+inline std::vector<std::ptrdiff_t> find_split_points(std::string_view content, std::ptrdiff_t min_distance)
+{
+	auto result = std::vector<std::ptrdiff_t>();
+	auto next_split = min_distance;
+	auto depth = std::ptrdiff_t(0);
+	auto last_code = '\0';
+	auto position = std::ptrdiff_t(0);
+	const auto size = std::ssize(content);
+	
+	// Updates the last code character with the code in [begin, end)
+	auto code = [&](std::ptrdiff_t begin, std::ptrdiff_t end) noexcept -> void
+	{
+		while (end != begin and char_scan::is_a(content[end - 1], char_scan::whitespace))
+		{
+			--end;
+		}
+		
+		if (end != begin)
+		{
+			last_code = content[end - 1];
+		}
+	};
+	
+	while (position < size)
+	{
+		auto found = char_scan::find_any<char_scan::quote | char_scan::slash | char_scan::parenthesis | char_scan::newline>(content, position);
+		code(position, found);
+		
+		if (found == size)
+		{
+			break;
+		}
+		
+		position = found + 1;
+		
+		switch (content[found])
+		{
+		case '"':
+			while ((position = char_scan::find_any<char_scan::quote | char_scan::backslash>(content, position)) < size
+				and content[position] != '"')
+			{
+				position += content.substr(position, 2) == "\\\\" or content.substr(position, 2) == "\\\"" ? 2 : 1;
+			}
+			
+			++position;
+			last_code = '"';
+			break;
+		case '\'':
+			if (content.substr(found, 4) == "'\\''")
+			{
+				position = found + 4;
+			}
+			else
+			{
+				position = std::ptrdiff_t(std::min(content.find('\'', position), content.size())) + 1;
+			}
+			
+			last_code = '\'';
+			break;
+		case '/':
+			if (content.substr(found, 2) == "//")
+			{
+				position = std::ptrdiff_t(std::min(content.find('\n', found + 2), content.size()));
+			}
+			else if (content.substr(found, 2) == "/*")
+			{
+				auto end = content.find("*/", found + 2);
+				position = end == content.npos ? size : std::ptrdiff_t(end) + 2;
+			}
+			else
+			{
+				last_code = '/';
+			}
+			break;
+		case '(':
+			++depth;
+			last_code = '(';
+			break;
+		case ')':
+			if (--depth < 0)
+			{
+				return result;
+			}
+			
+			last_code = ')';
+			break;
+		default:
+			if (depth == 0 and position >= next_split and position != size
+				and (last_code == ';' or last_code == '{' or last_code == '}'))
+			{
+				result.push_back(position);
+				next_split = position + min_distance;
+			}
+		}
+	}
+	
+	return result;
+}
+
+//! @return The helpers shared by all the threads which split a content into parts.
+inline Helper_pool& part_helpers()
+{
+	static auto result = Helper_pool(std::max<std::ptrdiff_t>(std::thread::hardware_concurrency(), 1) - 1);
+	return result;
+}
+
+/*!
+ * Same as remove_imports_annotations but the part of @p content after the
+ * part containing the header is split into at most @p part_count parts which
+ * are handled by the current thread and the available part_helpers(), falling
+ * back to remove_imports_annotations
+ * if the content contains anything which the parts could not handle
+ * independently, such as an import declaration after the header.
+ */
+inline std::tuple<Edited_content, bool> remove_imports_annotations_parallel(std::string_view content,
+	const Regex_set& patterns, const Name_set& names, std::ptrdiff_t part_count, const Context& context = {})
+{
+	auto split_points = find_split_points(content, std::ssize(content) / std::max<std::ptrdiff_t>(part_count, 1));
+	
+	if (split_points.empty())
+	{
+		return remove_imports_annotations(content, patterns, names, context);
+	}
+	
+	split_points.insert(split_points.begin(), 0);
+	split_points.push_back(std::ssize(content));
+	
+	auto tokenize_part = [&](std::ptrdiff_t part) -> std::vector<Token>
+	{
+		auto begin = split_points[part];
+		auto result = tokenize(content.substr(begin, split_points[part + 1] - begin), context.tracer_);
+		
+		for (auto& token : result)
+		{
+			token.offset_ += begin;
+		}
+		
+		return result;
+	};
+	
+	// The matches of each part are marked and its hits counted in records of
+	// the part, which are only merged into the current thread once the result
+	// of the part is kept, so that a capture gets them and the fallbacks do not
+	// count them twice
+	auto* strict = context.strict_mode_;
+	auto* counted = context.hits_;
+	auto part_matches = std::vector<Match_record>(strict ? split_points.size() - 1 : 0);
+	auto part_hits = std::vector<Statistics_record>(counted ? split_points.size() - 1 : 0);
+	
+	for (auto& matches : part_matches)
+	{
+		matches = strict->new_record();
+	}
+	
+	for (auto& hits : part_hits)
+	{
+		hits = counted->new_record();
+	}
+	
+	auto scan_part = [&](Import_annotation_scan& scan, std::ptrdiff_t part) -> bool
+	{
+		auto* previous = strict ? strict->begin_isolation(part_matches[part]) : nullptr;
+		auto* previous_hits = counted ? counted->begin_capture(part_hits[part]) : nullptr;
+		
+		bool result = scan.scan(tokenize_part(part));
+		
+		if (strict)
+		{
+			strict->end_isolation(previous);
+		}
+		
+		if (counted)
+		{
+			counted->end_capture(previous_hits);
+		}
+		
+		return result;
+	};
+	
+	auto head = Import_annotation_scan(content, patterns, names, context);
+	
+	if (not scan_part(head, 0) or head.in_header_)
+	{
+		return remove_imports_annotations(content, patterns, names, context);
+	}
+	
+	auto parts = std::vector<std::optional<Import_annotation_scan>>(split_points.size() - 1);
+	
+	for (std::ptrdiff_t part = 1; part != std::ssize(parts); ++part)
+	{
+		auto& scan = parts[part].emplace(content, patterns, names, context);
+		scan.in_header_ = false;
+		scan.annotations_terminated_ = head.annotations_terminated_;
+		scan.removed_classes_ = head.removed_classes_;
+	}
+	
+	part_helpers().run(std::ssize(parts) - 1, [&](std::ptrdiff_t index) -> void
+	{
+		scan_part(*parts[index + 1], index + 1);
+	});
+	
+	for (std::ptrdiff_t part = 1; part != std::ssize(parts); ++part)
+	{
+		if (parts[part]->import_found_)
+		{
+			return remove_imports_annotations(content, patterns, names, context);
+		}
+	}
+	
+	auto removed = std::move(head.removed_imports_);
+	removed.insert(removed.end(), head.removed_annotations_.begin(), head.removed_annotations_.end());
+	bool annotation_removed = not head.removed_annotations_.empty();
+	bool annotations_terminated = head.annotations_terminated_;
+	
+	// The parts after the one terminating annotations are not used
+	auto kept_parts = std::ptrdiff_t(1);
+	
+	for (; kept_parts != std::ssize(parts) and not annotations_terminated; ++kept_parts)
+	{
+		const auto& annotations = parts[kept_parts]->removed_annotations_;
+		removed.insert(removed.end(), annotations.begin(), annotations.end());
+		annotation_removed = annotation_removed or not annotations.empty();
+		annotations_terminated = parts[kept_parts]->annotations_terminated_;
+	}
+	
+	for (std::ptrdiff_t part = 0; part < std::min(std::ssize(part_matches), kept_parts); ++part)
+	{
+		strict->mark(part_matches[part]);
+	}
+	
+	for (std::ptrdiff_t part = 0; part < std::min(std::ssize(part_hits), kept_parts); ++part)
+	{
+		counted->count_hits(part_hits[part]);
+	}
+	
+	return std::tuple(remove_ranges(content, std::move(removed)), annotation_removed);
+}
+
+inline Edited_content remove_jpms_requires(std::string_view content, const Regex_set& module_patterns, const Context& context = {})
+{
+	const auto tokens = tokenize(content, context.tracer_);
+	auto index = std::ptrdiff_t(0);
+	
+	while (index != std::ssize(tokens) and not (tokens[index].kind_ == Token_kind::identifier
+		and tokens[index].text(content).find("module") != content.npos))
+	{
+		++index;
+	}
+	
+	while (index != std::ssize(tokens) and not tokens[index].is_punctuation(content, '{'))
+	{
+		++index;
+	}
+	
+	if (index == std::ssize(tokens))
+	{
+		return Edited_content(content);
+	}
+	
+	auto pos = tokens[index].end();
+	auto new_content = Edited_content(content);
+	new_content.keep(0, pos);
+	++index;
+	
+	while (index != std::ssize(tokens))
+	{
+		auto old_pos = pos;
+		
+		if (not tokens[index].is_identifier(content, "requires"))
+		{
+			while (index != std::ssize(tokens) and not tokens[index].is_punctuation(content, ';'))
+			{
+				++index;
+			}
+			
+			pos = std::ssize(content);
+			
+			if (index != std::ssize(tokens))
+			{
+				pos = tokens[index].end();
+				++index;
+			}
+			
+			new_content.keep(old_pos, pos);
+			continue;
+		}
+		
+		++index;
+		
+		if (index != std::ssize(tokens) and tokens[index].is_identifier(content, "transitive"))
+		{
+			++index;
+		}
+		else if (index != std::ssize(tokens) and tokens[index].is_identifier(content, "static"))
+		{
+			++index;
+			
+			if (index != std::ssize(tokens) and tokens[index].is_identifier(content, "transitive"))
+			{
+				++index;
+			}
+		}
+		
+		auto parsed_module = concatenate_until_semicolon(content, tokens, index);
+		
+		if (not parsed_module)
+		{
+			return Edited_content(content);
+		}
+		
+		const auto& [module_name, semicolon_index] = *parsed_module;
+		index = semicolon_index + 1;
+		pos = tokens[semicolon_index].end();
+		
+		bool matched = false;
+		
+		auto* strict = context.strict_mode_;
+		auto* counted = context.hits_;
+		
+		if (not strict and not counted)
+		{
+			matched = module_patterns.search(module_name.view());
+		}
+		else if (auto matched_patterns = Bitset(module_patterns.size()); module_patterns.search(module_name.view(), matched_patterns))
+		{
+			if (strict)
+			{
+				strict->mark_module_pattern(matched_patterns.find_first());
+			}
+			
+			if (counted)
+			{
+				counted->count_module_pattern(matched_patterns.find_first());
+			}
+			
+			matched = true;
+		}
+		
+		if (matched)
+		{
+			if (auto skip_space = find_newline(content, pos); skip_space != -1)
+			{
+				pos = skip_space;
+			}
+		}
+		else
+		{
+			new_content.keep(old_pos, pos);
+		}
+	}
+	
+	return new_content;
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+//! Contents of at least this size are split among the available part_helpers() when removing annotations
+inline constexpr std::ptrdiff_t parallel_content_size = 8 * 1024 * 1024;
+
+inline Edited_content handle_content(const Path_origin_entry& path, std::string_view content, const Parameters& parameters,
+	const Context& context = {})
+{
+	if (path.filename() == "module-info.java")
+	{
+		auto timer = Stage_timer(context, Stage::remove_jpms_requires);
+		return remove_jpms_requires(content, parameters.module_patterns_, context);
+	}
+	else
+	{
+		if (parameters.also_remove_annotations_)
+		{
+			auto timer = Stage_timer(context, Stage::remove_imports_annotations);
+			auto helper_count = std::ssize(content) >= parallel_content_size ? part_helpers().available() : 0;
+			auto [new_content, annotation_removed] = helper_count != 0
+				? remove_imports_annotations_parallel(content, parameters.patterns_, parameters.names_, helper_count + 1, context)
+				: remove_imports_annotations(content, parameters.patterns_, parameters.names_, context);
+			
+			if (auto* strict = context.strict_mode_; strict and annotation_removed)
+			{
+				strict->mark_annotation_removed();
+			}
+			
+			return new_content;
+		}
+		
+		auto timer = Stage_timer(context, Stage::remove_imports);
+		return std::get<0>(remove_imports(content, parameters.patterns_, parameters.names_, true, context));
+	}
+}
+
+//! @return A hash of everything in @p parameters which affects the result of handling a file.
+inline std::uint64_t parameters_fingerprint(const Parameters& parameters)
+{
+	auto key = std::string(Content_cache::format);
+	
+	for (auto [kind, values] : {
+		std::pair('n', std::vector<std::string_view>(parameters.names_.begin(), parameters.names_.end())),
+		std::pair('p', std::vector<std::string_view>(parameters.patterns_.patterns().begin(), parameters.patterns_.patterns().end())),
+		std::pair('m', std::vector<std::string_view>(parameters.module_patterns_.patterns().begin(), parameters.module_patterns_.patterns().end())),
+	})
+	{
+		for (auto value : values)
+		{
+			key += '\0';
+			key += kind;
+			key += value;
+		}
+	}
+	
+	key += parameters.also_remove_annotations_ ? std::string_view("\0a", 2) : std::string_view();
+	
+	return Content_cache::hash(key);
+}
+
+/*!
+ * @return The key of @p content of the file at @p path in a Content_cache. The
+ * same content has a different key in a module-info.java file, which is
+ * handled by remove_jpms_requires instead.
+ */
+inline std::uint64_t content_key(const Path_origin_entry& path, std::string_view content)
+{
+	return Content_cache::hash(content, path.filename() == "module-info.java");
+}
+
+/*!
+ * @return The entry of the content cache of @p context with @p hash of a
+ * content of @p size if it can be used by this run.
+ */
+inline std::optional<Content_cache::Entry> find_cached(std::uint64_t hash, std::ptrdiff_t size, const Parameters& parameters,
+	const Context& context)
+{
+	auto result = context.content_cache_->find(hash, size, context.strict_mode_ != nullptr, context.hits_ != nullptr);
+	
+	if (result and result->matches_known_ and (result->names_.size() != std::ssize(parameters.names_)
+		or result->patterns_.size() != parameters.patterns_.size()
+		or result->module_patterns_.size() != parameters.module_patterns_.size()))
+	{
+		return std::nullopt;
+	}
+	
+	if (result and result->hits_known_ and (std::ssize(result->name_hits_) != std::ssize(parameters.names_)
+		or std::ssize(result->pattern_hits_) != parameters.patterns_.size()
+		or std::ssize(result->module_pattern_hits_) != parameters.module_patterns_.size()))
+	{
+		return std::nullopt;
+	}
+	
+	return result;
+}
+
+/*!
+ * Marks the matches and counts the hits recorded in @p entry of the content
+ * cache in @p context as if its file was handled, once the entry is known to
+ * fit the file.
+ */
+inline void use_cached(const Content_cache::Entry& entry, const Context& context)
+{
+	if (auto* strict_mode = context.strict_mode_)
+	{
+		strict_mode->mark(Match_record(entry.names_, entry.patterns_, entry.module_patterns_, Bitset(), entry.annotation_removed_));
+	}
+	
+	if (auto* statistics = context.hits_)
+	{
+		auto hits = statistics->new_record();
+		hits.name_hits_ = entry.name_hits_;
+		hits.pattern_hits_ = entry.pattern_hits_;
+		hits.module_pattern_hits_ = entry.module_pattern_hits_;
+		statistics->count_hits(hits);
+	}
+	
+	if (auto* statistics = context.statistics_)
+	{
+		++statistics->record().files_cached_;
+	}
+}
+
+/*!
+ * Replaces the content of the file at @p path, from which the original content
+ * of @p new_content was read or, if @p is_mapped, to which it is mapped. The
+ * write is counted in the statistics of @p context.
+ */
+inline void write_in_place(const std::filesystem::path& path, const Edited_content& new_content, bool is_mapped,
+	const Context& context)
+{
+	int fd = ::open(path.c_str(), O_WRONLY | O_CLOEXEC);
+	
+	if (fd == -1)
+	{
+		throw std::system_error(errno, std::generic_category(), "Could not open file for writing");
+	}
+	
+	try
+	{
+		new_content.write_in_place(fd, is_mapped);
+	}
+	catch (...)
+	{
+		::close(fd);
+		throw;
+	}
+	
+	::close(fd);
+	std::osyncstream(std::clog) << "Removing symbols from file " << path.native() << "\n";
+	
+	if (auto* statistics = context.statistics_)
+	{
+		auto& record = statistics->record();
+		++record.files_changed_;
+		record.bytes_written_ += new_content.size() - new_content.first_removed();
+	}
+}
+
+/*!
+ * Handles the file at @p path or the standard input if it is empty in
+ * @p context. Without the in-place mode, the result is written to
+ * @p output_slot of the ordered output of @p context if it is not `nullptr` or
+ * directly to the standard output otherwise.
+ */
+inline void handle_file(const Path_origin_entry& path, const Parameters& parameters, const Context& context,
+	Ordered_output::Slot* output_slot = nullptr)
+try
+{
+	thread_local auto buffer = std::string();
+	auto span = Trace_span(context.tracer_, "file", path.native());
+	auto* const statistics = context.statistics_;
+	auto* const strict_mode = context.strict_mode_;
+	auto* const hits_statistics = context.hits_;
+	auto* const content_cache = context.content_cache_;
+	const auto start = statistics ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+	
+	// The content cache is looked up by the state of the file first, so that
+	// an unchanged file is not even read in the in-place mode
+	auto file_state = std::optional<Content_cache::File_state>();
+	auto content_hash = std::optional<std::uint64_t>();
+	auto cached = std::optional<Content_cache::Entry>();
+	
+	if (content_cache and not path.empty())
+	{
+		if ((file_state = Content_cache::state(path)))
+		{
+			content_hash = content_cache->find_path(path, *file_state);
+		}
+		
+		if (content_hash)
+		{
+			cached = find_cached(*content_hash, file_state->size_, parameters, context);
+		}
+		
+		if (cached and not cached->changed_ and parameters.in_place_)
+		{
+			use_cached(*cached, context);
+			
+			if (statistics)
+			{
+				statistics->add_file_time(std::chrono::steady_clock::now() - start, file_state->size_, path);
+			}
+			
+			return;
+		}
+	}
+	
+	const auto file_content = [&]() -> File_content
+	{
+		auto timer = Stage_timer(context, Stage::reading);
+		return path.empty() ? File_content(buffer) : File_content(path, buffer);
+	}();
+	const auto original_content = file_content.view();
+	
+	if (statistics)
+	{
+		auto& record = statistics->record();
+		++record.files_read_;
+		record.bytes_read_ += std::ssize(original_content);
+	}
+	
+	if (content_cache and not path.empty() and not content_hash)
+	{
+		content_hash = content_key(path, original_content);
+		cached = find_cached(*content_hash, std::ssize(original_content), parameters, context);
+	}
+	
+	auto new_content = Edited_content(original_content);
+	auto cached_content = cached ? Content_cache::apply(*cached, original_content) : std::nullopt;
+	
+	if (cached and not cached_content)
+	{
+		// The file changed since its state was read
+		file_state.reset();
+		content_hash = content_key(path, original_content);
+	}
+	
+	const auto& filter = path.filename() == "module-info.java" ? parameters.module_filter_ : parameters.filter_;
+	
+	if (cached_content)
+	{
+		new_content = *cached_content;
+		use_cached(*cached, context);
+	}
+	else if (content_hash)
+	{
+		auto matches = strict_mode ? strict_mode->new_record() : Match_record();
+		auto hits = hits_statistics ? hits_statistics->new_record() : Statistics_record();
+		
+		if (strict_mode)
+		{
+			strict_mode->begin_capture(matches);
+		}
+		
+		if (hits_statistics)
+		{
+			hits_statistics->begin_capture(hits);
+		}
+		
+		try
+		{
+			if (not filter or filter->matches(original_content))
+			{
+				new_content = handle_content(path, original_content, parameters, context);
+			}
+			else if (statistics)
+			{
+				++statistics->record().files_prefiltered_;
+			}
+		}
+		catch (...)
+		{
+			if (strict_mode)
+			{
+				strict_mode->end_capture();
+			}
+			
+			if (hits_statistics)
+			{
+				hits_statistics->end_capture();
+			}
+			
+			throw;
+		}
+		
+		if (strict_mode)
+		{
+			strict_mode->end_capture();
+		}
+		
+		if (hits_statistics)
+		{
+			hits_statistics->end_capture();
+			hits_statistics->count_hits(hits);
+		}
+		
+		auto entry = Content_cache::Entry();
+		entry.size_ = std::ssize(original_content);
+		entry.changed_ = new_content.changed();
+		
+		if (entry.changed_)
+		{
+			entry.kept_ = Content_cache::kept_ranges(new_content);
+		}
+		
+		entry.matches_known_ = strict_mode != nullptr;
+		entry.annotation_removed_ = matches.any_annotation_removed_;
+		entry.names_ = std::move(matches.names_);
+		entry.patterns_ = std::move(matches.patterns_);
+		entry.module_patterns_ = std::move(matches.module_patterns_);
+		entry.hits_known_ = hits_statistics != nullptr;
+		entry.name_hits_ = std::move(hits.name_hits_);
+		entry.pattern_hits_ = std::move(hits.pattern_hits_);
+		entry.module_pattern_hits_ = std::move(hits.module_pattern_hits_);
+		content_cache->insert(*content_hash, std::move(entry));
+	}
+	else if (not filter or filter->matches(original_content))
+	{
+		new_content = handle_content(path, original_content, parameters, context);
+	}
+	else if (statistics)
+	{
+		++statistics->record().files_prefiltered_;
+	}
+	
+	auto timer = std::optional<Stage_timer>(std::in_place, context, Stage::writing);
+	
+	if (not parameters.in_place_)
+	{
+		auto header = path.empty() ? std::string() : path.native() + ":\n";
+		
+		if (output_slot)
+		{
+			context.ordered_output_->write(*output_slot, header, new_content);
+		}
+		else
+		{
+			static auto stdout_mutex = std::mutex();
+			auto lock = std::lock_guard(stdout_mutex);
+			new_content.write(STDOUT_FILENO, header);
+		}
+		
+		if (statistics)
+		{
+			statistics->record().bytes_written_ += std::ssize(header) + new_content.size();
+		}
+	}
+	else if (new_content.changed())
+	{
+		write_in_place(path, new_content, file_content.is_mapped(), context);
+		
+		if (strict_mode)
+		{
+			strict_mode->mark_origin(path.origin_index());
+		}
+	}
+	
+	timer.reset();
+	
+	// A changed file has a new state, its new content is only known to the
+	// cache after it is handled again
+	if (file_state and content_hash and not (parameters.in_place_ and new_content.changed()))
+	{
+		content_cache->insert_path(path, *file_state, *content_hash);
+	}
+	
+	if (statistics)
+	{
+		if (not parameters.in_place_ and new_content.changed())
+		{
+			++statistics->record().files_changed_;
+		}
+		
+		statistics->add_file_time(std::chrono::steady_clock::now() - start, std::ssize(original_content), path);
+	}
+}
+catch (std::exception& ex)
+{
+	auto message = (path.native().empty() ? "" : path.native() + ": ") + ex.what();
+	throw std::runtime_error(message);
+}
+
+////////////////////////////////////////////////////////////////////////////////
+
+inline Parameter_dict parse_arguments(std::span<const char*> args, const String_view_set& no_argument_flags)
+{
+	auto result = Parameter_dict();
+	
+	if (args.empty())
+	{
+		return result;
+	}
+	
+	auto unflagged_parameters = result.try_emplace("").first;
+	auto last_flag = unflagged_parameters;
+	
+	for (std::string_view arg : args)
+	{
+		if (arg == "-h" or arg == "--help")
+		{
+			return Parameter_dict();
+		}
+		else if (auto separator = arg.find('='); arg.starts_with("--") and separator != std::string_view::npos)
+		{
+			// A long flag with an attached value: `--flag=value`
+			result[arg.substr(0, separator)].emplace_back(arg.substr(separator + 1));
+			last_flag = unflagged_parameters;
+		}
+		else if (arg.size() >= 2 and arg[0] == '-' and (std::isalnum(static_cast<unsigned char>(arg[1])) or (arg[1] == '-')))
+		{
+			last_flag = result.try_emplace(arg).first;
+			
+			if (no_argument_flags.contains(arg))
+			{
+				last_flag = unflagged_parameters;
+			}
+		}
+		else
+		{
+			last_flag->second.emplace_back(arg);
+			last_flag = unflagged_parameters;
+		}
+	}
+	
+	return result;
+}
+
+inline Parameters interpret_args(const Parameter_dict& parameters)
+{
+	auto result = Parameters();
+	
+	if (auto it = parameters.find("-n"); it != parameters.end())
+	{
+		result.names_ = Name_set(it->second);
+	}
+	
+	auto no_patterns = std::vector<std::string_view>();
+	const auto& patterns = parameters.contains("-p") ? parameters.find("-p")->second : no_patterns;
+	const auto& module_patterns = parameters.contains("-m") ? parameters.find("-m")->second : no_patterns;
+	result.patterns_ = Regex_set(patterns);
+	result.module_patterns_ = Regex_set(module_patterns);
+	result.filter_ = make_literal_filter(patterns, result.names_.names());
+	result.module_filter_ = make_literal_filter(module_patterns, {});
+	
+	if (parameters.contains("-a"))
+	{
+		result.also_remove_annotations_ = true;
+	}
+	
+	if (parameters.contains("-i") or parameters.contains("--in-place"))
+	{
+		result.in_place_ = true;
+		
+		if (parameters.contains("-s") or parameters.contains("--strict"))
 		{
-			return pos;
+			result.strict_mode_ = true;
 		}
-		++pos;
 	}
 	
-	return -1;
+	return result;
 }
 
+////////////////////////////////////////////////////////////////////////////////
+
 /*!
- * Iterates over @p content to remove all import statements provided
- * as @p patterns and @p names. Patterns match the string representation
- * following the `import [static]` string. @p names match only the simple
- * class names.
+ * Splits @p line into words separated by whitespace. A word may contain
+ * whitespace inside a pair of single or double quotes, which are removed.
  * 
- * @return The resulting string with import statements removed and a map of
- * removed simple class names to the fully qualified name as present in the
- * import statement.
+ * @throws std::invalid_argument If a quote is not terminated.
  */
-inline std::tuple<std::string, String_map> remove_imports(
-	std::string_view content, std::span<const Named_regex> patterns, const String_view_set& names)
+inline std::vector<std::string> split_words(std::string_view line)
 {
-	auto result = std::tuple<std::string, String_map>();
-	auto& [new_content, removed_classes] = result;
-	new_content.reserve(content.size());
-	auto position = std::ptrdiff_t(0);
+	auto result = std::vector<std::string>();
+	auto position = std::size_t(0);
 	
-	while (position < std::ssize(content))
+	while (true)
 	{
-		auto next_position = find_token(content, "import", position, true);
-		auto copy_end = std::ssize(content);
+		while (position != line.size() and std::isspace(static_cast<unsigned char>(line[position])))
+		{
+			++position;
+		}
 		
-		if (next_position < std::ssize(content))
+		if (position == line.size())
 		{
-			auto import_name = std::string();
-			auto [symbol, end_pos] = next_symbol(content, next_position + 6);
-			
-			const auto empty_set = String_view_set();
-			const auto* names_passed = &names;
-			
-			bool is_static = false;
-			
-			if (symbol == "static")
-			{
-				is_static = true;
-				names_passed = &empty_set;
-				std::tie(symbol, end_pos) = next_symbol(content, end_pos);
-			}
-			
-			while (symbol != ";")
+			return result;
+		}
+		
+		auto& word = result.emplace_back();
+		
+		while (position != line.size() and not std::isspace(static_cast<unsigned char>(line[position])))
+		{
+			if (line[position] == '\'' or line[position] == '"')
 			{
-				if (symbol.empty())
-				{
-					new_content.clear();
-					new_content.append(content);
-					removed_classes.clear();
-					return result;
-				}
+				auto end = line.find(line[position], position + 1);
 				
-				import_name += symbol;
-				std::tie(symbol, end_pos) = next_symbol(content, end_pos);
-			}
-			
-			if (auto skip_space = find_newline(content, end_pos); skip_space != -1)
-			{
-				end_pos = skip_space + 1;
-			}
-			
-			copy_end = end_pos;
-			
-			bool matches = name_matches(import_name, patterns, *names_passed, {});
-			
-			if (is_static)
-			{
-				if (auto pos = import_name.rfind('.'); pos != import_name.npos)
+				if (end == std::string_view::npos)
 				{
-					auto import_nonstatic_name = std::string_view(import_name.c_str(), pos);
-					matches = matches or name_matches(import_nonstatic_name, patterns, names, {});
+					throw std::invalid_argument("unterminated quote");
 				}
+				
+				word += line.substr(position + 1, end - position - 1);
+				position = end + 1;
 			}
-			
-			if (matches)
+			else
 			{
-				copy_end = next_position;
-				
-				auto simple_import_name = std::string();
-				
-				if (auto pos = import_name.rfind('.'); pos != import_name.npos)
-				{
-					simple_import_name = import_name.substr(pos + 1);
-				}
-				
-				// Add only non-star and non-static imports
-				if (not import_name.ends_with("*") and not is_static)
-				{
-					removed_classes.try_emplace(std::move(simple_import_name), std::move(import_name));
-				}
+				word += line[position++];
 			}
-			
-			next_position = end_pos;
 		}
-		
-		new_content += content.substr(position, copy_end - position);
-		position = next_position;
 	}
-	
-	return result;
 }
 
-/*!
- * Iterates over @p content to remove all annotations provided as @p patterns
- * and @p names. Patterns match the string representation of the annotations as
- * present in the source code. @p names match only the simple class names.
- * 
- * @return The resulting string with annotations removed.
- */
-inline std::string remove_annotations(std::string_view content, std::span<const Named_regex> patterns,
-	const String_view_set& names, const String_map& imported_names)
+//! @return The absolute lexically normal form of @p path without a trailing separator.
+inline std::filesystem::path normal_path(const std::filesystem::path& path)
 {
-	auto position = std::ptrdiff_t(0);
-	auto result = std::string();
-	result.reserve(content.size());
+	auto result = std::filesystem::absolute(path).lexically_normal();
 	
-	while (position < std::ssize(content))
+	if (not result.has_filename() and result.has_relative_path())
 	{
-		auto [annotation, annotation_name] = next_annotation(content, position);
-		auto next_position = std::ssize(content);
-		auto copy_end = std::ssize(content);
-		
-		if (annotation.begin() != content.end())
-		{
-			copy_end = annotation.end() - content.begin();
-			next_position = copy_end;
-			
-			if (annotation_name != "interface" and name_matches(annotation_name, patterns, names, imported_names))
-			{
-				copy_end = annotation.begin() - content.begin();
-				
-				auto skip_space = next_position;
-				
-				while (skip_space != std::ssize(content) and std::isspace(static_cast<unsigned char>(content[skip_space])))
-				{
-					++skip_space;
-				}
-				
-				if (skip_space != std::ssize(content))
-				{
-					next_position = skip_space;
-				}
-			}
-		}
-		
-		result += content.substr(position, copy_end - position);
-		position = next_position;
+		result = result.parent_path();
 	}
 	
 	return result;
 }
 
-inline std::string remove_jpms_requires(std::string_view content, std::span<const Named_regex> module_patterns)
+//! @return True if @p path is @p root or is under it, both in their normal_path() form.
+inline bool path_contains(const std::filesystem::path& root, const std::filesystem::path& path)
 {
-	auto new_content = std::string(content);
-	new_content.reserve(content.size());
-	
-	auto pos = std::ptrdiff_t(0);
-	pos = find_token(content, "module");
-	pos = find_token(content, "{", pos);
-	
-	if (pos != std::ssize(content))
+	return std::mismatch(root.begin(), root.end(), path.begin(), path.end()).first == root.end();
+}
+
+/*!
+ * An in-place invocation read from a line of a jobs file. The roots of all jobs
+ * are traversed together and each file is handled by all jobs whose roots
+ * contain it, in the order of the jobs.
+ * 
+ * Each job has its own strict mode and hit counts, indexed by its own
+ * matchers. The hit counts are added to the global statistics at the end.
+ */
+struct Job
+{
+	/*!
+	 * @param line The arguments of the invocation as on the command line.
+	 * 
+	 * @throws std::invalid_argument If @p line is not a valid in-place invocation.
+	 */
+	Job(std::string_view line, std::ptrdiff_t line_number)
+		:
+		line_number_(line_number)
 	{
-		++pos;
-		new_content.clear();
-		new_content.append(content, 0, pos);
-		while (pos != std::ssize(content))
+		auto fail = [&](std::string_view reason) -> void
+		{
+			throw std::invalid_argument("jobs file line " + std::to_string(line_number) + ": " + std::string(reason));
+		};
+		
+		try
 		{
-			auto symbol = std::string_view();
-			auto end_pos = std::ptrdiff_t(0);
-			auto old_pos = pos;
-			std::tie(symbol, end_pos) = next_symbol(content, pos);
+			arguments_ = split_words(line);
 			
-			if (symbol.empty())
-			{
-				break;
-			}
+			auto pointers = std::vector<const char*>();
 			
-			if (symbol == "requires")
+			for (const auto& argument : arguments_)
 			{
-				pos = end_pos;
+				pointers.push_back(argument.c_str());
 			}
-			else
+			
+			auto parameter_dict = parse_arguments(pointers, {"-a", "-i", "--in-place", "-s", "--strict"});
+			
+			for (const auto& [flag, values] : parameter_dict)
 			{
-				pos = find_token(content, ";", pos);
-				if (pos != std::ssize(content))
+				constexpr auto supported_flags = std::array<std::string_view, 8>
+				{
+					"-n", "-p", "-m", "-a", "-i", "--in-place", "-s", "--strict",
+				};
+				
+				if (not flag.empty() and std::ranges::find(supported_flags, flag) == supported_flags.end())
 				{
-					++pos;
+					fail("unsupported flag " + std::string(flag));
 				}
-				new_content.append(content, old_pos, pos - old_pos);
-				continue;
 			}
 			
-			std::tie(symbol, end_pos) = next_symbol(content, pos);
-			if (symbol == "transitive")
+			parameters_ = interpret_args(parameter_dict);
+			
+			if (not parameters_.in_place_)
 			{
-				pos = end_pos;
+				fail("only in-place jobs with -i are supported");
 			}
-			else if (symbol == "static")
+			
+			if (parameters_.names_.empty() and parameters_.patterns_.empty() and parameters_.module_patterns_.empty())
 			{
-				pos = end_pos;
-				std::tie(symbol, end_pos) = next_symbol(content, pos);
-				if (symbol == "transitive")
-				{
-					pos = end_pos;
-				}
+				fail("no matcher specified");
 			}
 			
-			auto module_name = std::string();
+			roots_ = parameter_dict.find("")->second;
 			
-			std::tie(symbol, end_pos) = next_symbol(content, pos);
-			while (symbol != ";")
+			if (roots_.empty())
 			{
-				if (symbol.empty())
-				{
-					new_content.clear();
-					new_content.append(content);
-					return new_content;
-				}
-				
-				module_name += symbol;
-				std::tie(symbol, end_pos) = next_symbol(content, end_pos);
+				fail("no input files");
 			}
 			
-			pos = end_pos;
-			
-			bool matched = false;
-			for (const auto& pattern : module_patterns)
+			for (auto root : roots_)
 			{
-				if (std::regex_search(module_name.begin(), module_name.end(), pattern))
-				{
-					if (strict_mode)
-					{
-						strict_mode->module_patterns_matched_.lock().get().at(pattern) = true;
-					}
-					
-					matched = true;
-					break;
-				}
+				normal_roots_.push_back(normal_path(root));
 			}
 			
-			if (matched)
+			if (parameters_.strict_mode_)
 			{
-				if (auto skip_space = find_newline(content, pos); skip_space != -1)
-				{
-					pos = skip_space;
-				}
+				strict_mode_.emplace(roots_, parameters_);
 			}
-			else
+		}
+		catch (std::invalid_argument& ex)
+		{
+			if (std::string_view(ex.what()).starts_with("jobs file line "))
 			{
-				new_content.append(content, old_pos, pos - old_pos);
+				throw;
 			}
+			
+			fail(ex.what());
 		}
 	}
 	
-	return new_content;
-}
-
-////////////////////////////////////////////////////////////////////////////////
-
-inline std::string handle_content(const Path_origin_entry& path, std::string_view content, const Parameters& parameters)
-{
-	if (path.filename() == "module-info.java")
-	{
-		return remove_jpms_requires(content, parameters.module_patterns_);
-	}
-	else
+	Job(const Job&) = delete;
+	Job& operator=(const Job&) = delete;
+	
+	//! @return The index of the root containing @p path in its normal_path() form or `-1`.
+	[[nodiscard]] std::ptrdiff_t origin_of(const std::filesystem::path& path) const
 	{
-		auto [new_content, removed_classes] = remove_imports(content, parameters.patterns_, parameters.names_);
-		
-		if (parameters.also_remove_annotations_)
+		for (std::ptrdiff_t index = 0; index != std::ssize(normal_roots_); ++index)
 		{
-			auto content_size = new_content.size();
-			new_content = remove_annotations(new_content, parameters.patterns_, parameters.names_, removed_classes);
-			
-			if (strict_mode and new_content.size() < content_size)
+			if (path_contains(normal_roots_[index], path))
 			{
-				strict_mode->any_annotation_removed_.store(true, std::memory_order_release);
+				return index;
 			}
 		}
 		
-		return new_content;
+		return -1;
 	}
-}
-
-inline std::string handle_file(const Path_origin_entry& path, const Parameters& parameters)
-try
-{
-	auto original_content = std::string();
 	
-	if (path.empty())
-	{
-		original_content = std::string(std::istreambuf_iterator<char>(std::cin), {});
-	}
-	else
+	//! @return The failures of the strict mode of this job, in the form of the messages of the strict mode.
+	[[nodiscard]] std::vector<std::string> strict_mode_failures() const
 	{
-		auto ifs = std::ifstream(path);
+		auto result = std::vector<std::string>();
 		
-		if (ifs.fail())
+		if (not strict_mode_)
 		{
-			throw std::ios_base::failure("Could not open file for reading");
+			return result;
 		}
 		
-		ifs.exceptions(std::ios_base::badbit | std::ios_base::failbit);
-		original_content = std::string(std::istreambuf_iterator<char>(ifs), {});
-	}
-	
-	auto content = handle_content(path, original_content, parameters);
-	
-	if (not parameters.in_place_)
-	{
-		auto osyncstream = std::osyncstream(std::cout);
-		
-		if (not path.empty())
+		for (auto origin : strict_mode_->unchanged_origins())
 		{
-			osyncstream << path.native() << ":\n";
+			result.push_back("no changes were made in " + std::string(origin));
 		}
 		
-		osyncstream << content;
-	}
-	else if (content.size() < original_content.size())
-	{
-		auto ofs = std::ofstream(path);
+		for (auto name : strict_mode_->unmatched_names())
+		{
+			result.push_back("simple name " + std::string(name) + " did not match anything");
+		}
 		
-		if (ofs.fail())
+		for (auto pattern : strict_mode_->unmatched_patterns())
 		{
-			throw std::ios_base::failure("Could not open file for writing");
+			result.push_back("pattern " + std::string(pattern) + " did not match anything");
 		}
 		
-		ofs.exceptions(std::ios_base::badbit | std::ios_base::failbit);
-		ofs << content;
-		std::osyncstream(std::clog) << "Removing symbols from file " << path.native() << "\n";
+		for (auto pattern : strict_mode_->unmatched_module_patterns())
+		{
+			result.push_back("module pattern " + std::string(pattern) + " did not match anything");
+		}
 		
-		if (strict_mode)
+		if (parameters_.also_remove_annotations_ and not strict_mode_->any_annotation_removed())
 		{
-			strict_mode->files_truncated_.lock().get().at(path.origin()) = true;
+			result.push_back("'-a' was specified but no annotation was removed");
 		}
+		
+		return result;
 	}
 	
-	return content;
-}
-catch (std::exception& ex)
+	std::ptrdiff_t line_number_;
+	std::vector<std::string> arguments_;
+	Parameters parameters_;
+	
+	//! The file paths as written in the arguments
+	std::vector<std::string_view> roots_;
+	std::vector<std::filesystem::path> normal_roots_;
+	
+	//! Present if the job has `-s`
+	std::optional<Strict_mode> strict_mode_;
+	
+	//! Present if statistics are collected
+	std::optional<Statistics> statistics_;
+};
+
+/*!
+ * Reads the jobs of a jobs file with @p content, one job per line. Empty lines
+ * and lines starting with `#` are ignored.
+ * 
+ * @throws std::invalid_argument If any line is not a valid job.
+ */
+inline std::vector<std::unique_ptr<Job>> read_jobs(std::string_view content)
 {
-	auto message = (path.native().empty() ? "" : path.native() + ": ") + ex.what();
-	throw std::runtime_error(message);
+	auto result = std::vector<std::unique_ptr<Job>>();
+	auto line_number = std::ptrdiff_t(0);
+	
+	for (auto position = std::size_t(0); position < content.size();)
+	{
+		auto end = std::min(content.find('\n', position), content.size());
+		auto line = content.substr(position, end - position);
+		position = end + 1;
+		++line_number;
+		
+		if (auto first = line.find_first_not_of(" \t\r"); first != std::string_view::npos and line[first] != '#')
+		{
+			result.push_back(std::make_unique<Job>(line, line_number));
+		}
+	}
+	
+	return result;
 }
 
-////////////////////////////////////////////////////////////////////////////////
-
-inline Parameter_dict parse_arguments(std::span<const char*> args, const String_view_set& no_argument_flags)
+/*!
+ * @return The arguments of a single invocation with all matchers and flags of
+ * @p jobs and their roots, without those contained in other roots. The values
+ * point into @p jobs.
+ */
+inline Parameter_dict jobs_parameter_dict(std::span<const std::unique_ptr<Job>> jobs)
 {
 	auto result = Parameter_dict();
+	auto& roots = result[""];
+	auto normal_roots = std::vector<std::filesystem::path>();
 	
-	if (args.empty())
+	auto add_unique = [&](std::string_view flag, std::string_view value) -> void
 	{
-		return result;
-	}
-	
-	auto unflagged_parameters = result.try_emplace("").first;
-	auto last_flag = unflagged_parameters;
+		if (auto& values = result[flag]; std::ranges::find(values, value) == values.end())
+		{
+			values.push_back(value);
+		}
+	};
 	
-	for (std::string_view arg : args)
+	for (const auto& job : jobs)
 	{
-		if (arg == "-h" or arg == "--help")
+		const auto& parameters = job->parameters_;
+		
+		for (auto name : parameters.names_)
 		{
-			return Parameter_dict();
+			add_unique("-n", name);
 		}
-		else if (arg.size() >= 2 and arg[0] == '-' and (std::isalnum(static_cast<unsigned char>(arg[1])) or (arg[1] == '-')))
+		
+		for (const auto& pattern : parameters.patterns_.patterns())
 		{
-			last_flag = result.try_emplace(arg).first;
+			add_unique("-p", pattern);
+		}
+		
+		for (const auto& pattern : parameters.module_patterns_.patterns())
+		{
+			add_unique("-m", pattern);
+		}
+		
+		result.try_emplace("-i");
+		
+		if (parameters.also_remove_annotations_)
+		{
+			result.try_emplace("-a");
+		}
+		
+		if (parameters.strict_mode_)
+		{
+			result.try_emplace("-s");
+		}
+		
+		for (std::ptrdiff_t index = 0; index != std::ssize(job->roots_); ++index)
+		{
+			const auto& normal_root = job->normal_roots_[index];
 			
-			if (no_argument_flags.contains(arg))
+			if (std::ranges::any_of(normal_roots, [&](const auto& root) -> bool {return path_contains(root, normal_root);}))
 			{
-				last_flag = unflagged_parameters;
+				continue;
 			}
-		}
-		else
-		{
-			last_flag->second.emplace_back(arg);
-			last_flag = unflagged_parameters;
+			
+			for (std::ptrdiff_t other = std::ssize(normal_roots) - 1; other >= 0; --other)
+			{
+				if (path_contains(normal_root, normal_roots[other]))
+				{
+					normal_roots.erase(normal_roots.begin() + other);
+					roots.erase(roots.begin() + other);
+				}
+			}
+			
+			normal_roots.push_back(normal_root);
+			roots.push_back(job->roots_[index]);
 		}
 	}
 	
 	return result;
 }
 
-inline Parameters interpret_args(const Parameter_dict& parameters)
+/*!
+ * Handles the file at @p path with each of @p jobs which contains it, the
+ * later jobs see the content left by the earlier ones. The file is read and
+ * written at most once.
+ */
+inline void handle_file_jobs(const Path_origin_entry& path, std::span<const std::unique_ptr<Job>> jobs, const Context& context)
+try
 {
-	auto result = Parameters();
+	thread_local auto buffer = std::string();
+	thread_local auto copies = std::array<std::string, 2>();
+	auto span = Trace_span(context.tracer_, "file", path.native());
+	auto* const statistics = context.statistics_;
+	const auto start = statistics ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
 	
-	if (auto it = parameters.find("-p"); it != parameters.end())
+	const auto file_content = [&]() -> File_content
 	{
-		for (const auto& pattern : it->second)
-		{
-			result.patterns_.emplace_back(pattern, std::regex_constants::extended);
-		}
-	}
+		auto timer = Stage_timer(context, Stage::reading);
+		return File_content(path, buffer);
+	}();
+	const auto original_content = file_content.view();
 	
-	if (auto it = parameters.find("-m"); it != parameters.end())
+	if (statistics)
 	{
-		for (const auto& pattern : it->second)
-		{
-			result.module_patterns_.emplace_back(pattern, std::regex_constants::extended);
-		}
+		auto& record = statistics->record();
+		++record.files_read_;
+		record.bytes_read_ += std::ssize(original_content);
 	}
 	
-	if (auto it = parameters.find("-n"); it != parameters.end())
+	const auto normal = normal_path(path);
+	auto new_content = Edited_content(original_content);
+	auto content = original_content;
+	auto copy_index = std::size_t(0);
+	
+	for (const auto& job : jobs)
 	{
-		for (const auto& name : it->second)
+		auto origin = job->origin_of(normal);
+		
+		if (origin == -1)
+		{
+			continue;
+		}
+		
+		const auto& parameters = job->parameters_;
+		const auto& filter = path.filename() == "module-info.java" ? parameters.module_filter_ : parameters.filter_;
+		auto job_context = context;
+		job_context.strict_mode_ = job->strict_mode_ ? &*job->strict_mode_ : nullptr;
+		job_context.hits_ = job->statistics_ ? &*job->statistics_ : nullptr;
+		job_context.match_cache_ = nullptr;
+		auto job_content = Edited_content(content);
+		
+		if (not filter or filter->matches(content))
+		{
+			job_content = handle_content(path, content, parameters, job_context);
+		}
+		
+		if (job->strict_mode_ and job_content.changed())
+		{
+			job->strict_mode_->mark_origin(origin);
+		}
+		
+		if (job_content.changed())
 		{
-			result.names_.insert(name);
+			new_content = new_content.then(job_content);
+			auto& copy = copies[copy_index ^= 1];
+			copy = job_content.str();
+			content = copy;
 		}
 	}
 	
-	if (parameters.contains("-a"))
+	if (new_content.changed())
 	{
-		result.also_remove_annotations_ = true;
+		auto timer = Stage_timer(context, Stage::writing);
+		write_in_place(path, new_content, file_content.is_mapped(), context);
 	}
 	
-	if (parameters.contains("-i") or parameters.contains("--in-place"))
+	if (statistics)
 	{
-		result.in_place_ = true;
-		
-		if (parameters.contains("-s") or parameters.contains("--strict"))
-		{
-			result.strict_mode_ = true;
-		}
+		statistics->add_file_time(std::chrono::steady_clock::now() - start, std::ssize(original_content), path);
 	}
-	
-	return result;
+}
+catch (std::exception& ex)
+{
+	throw std::runtime_error(path.native() + ": " + ex.what());
 }
 } // namespace java_symbols
@@ -1,21 +1,676 @@
+#include <csignal>
+
 #include <thread>
 #include <utility>
+#include <chrono>
+#include <iomanip>
+#include <sstream>
+#include <string_view>
 #include <atomic>
+#include <functional>
+#include <limits>
+#include <memory>
+#include <string>
+#include <syncstream>
+#include <system_error>
+#include <tuple>
+
+#include <fcntl.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <unistd.h>
 
 #include "java_symbols.hpp"
+#include "ordered_output.hpp"
+#include "server.hpp"
+#include "thread_pool.hpp"
+#include "work_scheduler.hpp"
+#include "zip_archive.hpp"
 
 using namespace java_symbols;
 
-int main(int argc, const char** argv)
+//! The flags which do not take a value
+static const auto no_argument_flags = String_view_set {"-a", "-i", "--in-place", "-s", "--strict", "--stats"};
+
+//! Compiled matchers of the previous requests, only used by a server
+static auto parameters_cache = std::optional<Parameters_cache>();
+
+//! The state of the current run, each is present if its feature is enabled
+static auto strict_mode = std::optional<Strict_mode>();
+static auto statistics = std::optional<Statistics>();
+static auto match_cache = std::optional<Match_cache>();
+static auto content_cache = std::optional<Content_cache>();
+static auto ordered_output = std::optional<Ordered_output>();
+static auto tracer = std::optional<Tracer>();
+
+//! @return The Context of the current run.
+static Context run_context() noexcept
 {
-	auto args = std::span<const char*>(argv + 1, argc - 1);
+	auto result = Context();
+	result.strict_mode_ = strict_mode ? &*strict_mode : nullptr;
+	result.statistics_ = statistics ? &*statistics : nullptr;
+	result.hits_ = result.statistics_;
+	result.match_cache_ = match_cache ? &*match_cache : nullptr;
+	result.content_cache_ = content_cache ? &*content_cache : nullptr;
+	result.ordered_output_ = ordered_output ? &*ordered_output : nullptr;
+	result.tracer_ = tracer ? &*tracer : nullptr;
+	
+	return result;
+}
+
+struct Input_archive;
+
+struct Input_task
+{
+	Path_origin_entry path_;
+	bool is_directory_ = false;
+	
+	//! The slot of the output of the task in the ordered output mode
+	Ordered_output::Slot* output_slot_ = nullptr;
+	
+	//! Whether the task is a zip archive whose entries are to be listed
+	bool is_archive_ = false;
+	
+	//! The archive containing the entry of the task, if it is one
+	std::shared_ptr<Input_archive> archive_ = nullptr;
+	std::ptrdiff_t entry_index_ = -1;
+};
+
+/*!
+ * A zip archive given on the command line whose Java entries are handled as
+ * separate tasks. In the in-place mode, the archive is replaced by the task
+ * which finishes the last entry.
+ */
+struct Input_archive
+{
+	explicit Input_archive(const Path_origin_entry& path)
+		:
+		path_(path),
+		content_(path, buffer_),
+		archive_(content_.view()),
+		replaced_(archive_.entries().size())
+	{
+	}
+	
+	Path_origin_entry path_;
+	std::string buffer_;
+	File_content content_;
+	Zip_archive archive_;
+	
+	//! The new data of the changed entries, each written by its own task
+	std::vector<std::optional<Zip_archive::Data>> replaced_;
+	
+	std::atomic<std::ptrdiff_t> remaining_ = 0;
+	std::atomic<bool> failed_ = false;
+};
+
+//! @return True if the file at @p path is handled as a zip archive.
+static bool is_archive_path(std::string_view path) noexcept
+{
+	return path.ends_with(".jar") or path.ends_with(".zip");
+}
+
+//! The priority of a chunk of input tasks, heavier chunks are handled first
+struct Input_weight
+{
+	explicit Input_weight(std::uintmax_t size = 0, std::vector<std::uint32_t> position = {}) noexcept
+		:
+		size_(size),
+		position_(std::move(position))
+	{
+	}
+	
+	std::uintmax_t size_;
+	
+	//! The indices of the slots leading to the first task in the ordered output
+	//! mode, earlier positions are heavier
+	std::vector<std::uint32_t> position_;
+	
+	bool operator<(const Input_weight& other) const noexcept
+	{
+		if (size_ != other.size_)
+		{
+			return size_ < other.size_;
+		}
+		
+		return other.position_ < position_;
+	}
+};
+
+using Input_scheduler = Work_scheduler<Input_task, Input_weight>;
+
+//! Files smaller than this are handled together in chunks of about this size
+static constexpr std::uintmax_t chunk_size = 256 * 1024;
+
+//! Directories are listed before any file is handled to discover work early
+static constexpr std::uintmax_t directory_weight = std::numeric_limits<std::uintmax_t>::max();
+
+/*!
+ * Deals @p chunks, which are in the output order, to the heaps of the workers
+ * starting with @p worker. Consecutive chunks are then handled by different
+ * workers at about the same time and each heap still yields its chunks in the
+ * output order, so the ordered output does not have to hold much.
+ */
+static void push_dealt(Input_scheduler& scheduler, std::ptrdiff_t worker, std::vector<Input_scheduler::Chunk>&& chunks)
+{
+	auto dealt = std::vector<std::vector<Input_scheduler::Chunk>>(std::min(std::ssize(chunks), scheduler.worker_count()));
+	
+	for (std::ptrdiff_t index = 0; index != std::ssize(chunks); ++index)
+	{
+		dealt[index % std::ssize(dealt)].push_back(std::move(chunks[index]));
+	}
+	
+	for (std::ptrdiff_t index = 0; index != std::ssize(dealt); ++index)
+	{
+		scheduler.push((worker + index) % scheduler.worker_count(), std::move(dealt[index]));
+	}
+}
+
+/*!
+ * Pushes the @p entries of @p parent, whose chunk has @p weight, to the heap of
+ * @p worker. Each entry is a task with its size.
+ * 
+ * Files are pushed in chunks weighted by their size, small files are grouped
+ * together. In the ordered output mode, the entries get the slots of the
+ * expanded slot of @p parent in their order instead. Files are then grouped
+ * only with their neighbours and the chunks are dealt by push_dealt() so that
+ * they are handled in about the output order.
+ */
+static void push_tasks(const Input_task& parent, const Input_weight& weight,
+	std::vector<std::tuple<std::uintmax_t, Input_task>>&& entries, Input_scheduler& scheduler, std::ptrdiff_t worker)
+{
+	auto chunks = std::vector<Input_scheduler::Chunk>();
+	
+	if (not parent.output_slot_)
+	{
+		std::ranges::sort(entries, std::greater(), [](const auto& entry) noexcept -> std::uintmax_t {return std::get<0>(entry);});
+		
+		auto small_files = Input_scheduler::Chunk();
+		
+		for (auto& [size, task] : entries)
+		{
+			if (size >= chunk_size)
+			{
+				chunks.emplace_back(Input_weight(size)).tasks_.push_back(std::move(task));
+				continue;
+			}
+			
+			small_files.weight_.size_ += size;
+			small_files.tasks_.push_back(std::move(task));
+			
+			if (small_files.weight_.size_ >= chunk_size)
+			{
+				chunks.push_back(std::move(small_files));
+				small_files = Input_scheduler::Chunk();
+			}
+		}
+		
+		if (not small_files.tasks_.empty())
+		{
+			chunks.push_back(std::move(small_files));
+		}
+		
+		scheduler.push(worker, std::move(chunks));
+		return;
+	}
+	
+	auto slots = ordered_output->expand(*parent.output_slot_, std::ssize(entries));
+	auto files = Input_scheduler::Chunk();
+	
+	for (std::ptrdiff_t index = 0; index != std::ssize(entries); ++index)
+	{
+		auto& [size, task] = entries[index];
+		task.output_slot_ = &slots[index];
+		
+		auto position = weight.position_;
+		position.push_back(static_cast<std::uint32_t>(index));
+		
+		if (not files.tasks_.empty() and (task.is_directory_ or files.weight_.size_ + size > chunk_size))
+		{
+			files.weight_.size_ = 0;
+			chunks.push_back(std::move(files));
+			files = Input_scheduler::Chunk();
+		}
+		
+		if (task.is_directory_)
+		{
+			chunks.emplace_back(Input_weight(directory_weight, std::move(position))).tasks_.push_back(std::move(task));
+			continue;
+		}
+		
+		if (files.tasks_.empty())
+		{
+			files.weight_.position_ = std::move(position);
+		}
+		
+		files.weight_.size_ += size;
+		files.tasks_.push_back(std::move(task));
+	}
+	
+	if (not files.tasks_.empty())
+	{
+		files.weight_.size_ = 0;
+		chunks.push_back(std::move(files));
+	}
+	
+	push_dealt(scheduler, worker, std::move(chunks));
+}
+
+/*!
+ * Pushes the subdirectories of @p directory and the Java files in it, whose
+ * chunk has @p weight, to the heap of @p worker. Symlinks are not followed.
+ * In the ordered output mode, the entries are sorted by name.
+ */
+static void list_directory(const Input_task& directory, const Input_weight& weight, Input_scheduler& scheduler, std::ptrdiff_t worker)
+{
+	auto timer = Stage_timer(run_context(), Stage::traversal, directory.path_.native());
+	auto entries = std::vector<std::tuple<std::uintmax_t, Input_task>>();
+	
+	for (const auto& dir_entry : std::filesystem::directory_iterator(directory.path_))
+	{
+		if (dir_entry.is_symlink())
+		{
+			continue;
+		}
+		
+		auto path = Path_origin_entry(dir_entry.path(), directory.path_.origin(), directory.path_.origin_index());
+		
+		if (dir_entry.is_directory())
+		{
+			entries.emplace_back(directory_weight, Input_task(std::move(path), true));
+		}
+		else if (dir_entry.is_regular_file() and dir_entry.path().native().ends_with(".java"))
+		{
+			auto error = std::error_code();
+			auto size = dir_entry.file_size(error);
+			entries.emplace_back(error ? 0 : size, Input_task(std::move(path), false));
+		}
+	}
+	
+	if (statistics)
+	{
+		statistics->record().files_discovered_ += std::ranges::count(entries, false, [](const auto& entry) noexcept -> bool
+		{
+			return std::get<1>(entry).is_directory_;
+		});
+	}
+	
+	if (directory.output_slot_)
+	{
+		std::ranges::sort(entries, {}, [](const auto& entry) noexcept -> const std::string& {return std::get<1>(entry).path_.native();});
+	}
+	
+	push_tasks(directory, weight, std::move(entries), scheduler, worker);
+}
+
+/*!
+ * Reads the central directory of the zip archive of @p task and pushes its
+ * Java entries like list_directory.
+ */
+static void list_archive(const Input_task& task, const Input_weight& weight, Input_scheduler& scheduler, std::ptrdiff_t worker)
+{
+	auto timer = Stage_timer(run_context(), Stage::traversal, task.path_.native());
+	auto archive = std::shared_ptr<Input_archive>();
+	
+	try
+	{
+		archive = std::make_shared<Input_archive>(task.path_);
+	}
+	catch (std::exception& ex)
+	{
+		throw std::runtime_error(task.path_.native() + ": " + ex.what());
+	}
+	
+	auto entries = std::vector<std::tuple<std::uintmax_t, Input_task>>();
+	
+	for (std::ptrdiff_t index = 0; index != std::ssize(archive->archive_.entries()); ++index)
+	{
+		const auto& entry = archive->archive_.entries()[index];
+		
+		if (entry.name_.ends_with(".java") and entry.is_readable())
+		{
+			auto path = Path_origin_entry(task.path_.native() + "!/" + std::string(entry.name_), task.path_.origin(), task.path_.origin_index());
+			auto& entry_task = std::get<1>(entries.emplace_back(entry.size_, Input_task(std::move(path), false)));
+			entry_task.archive_ = archive;
+			entry_task.entry_index_ = index;
+		}
+	}
+	
+	if (statistics)
+	{
+		statistics->record().files_discovered_ += std::ssize(entries);
+	}
+	
+	archive->remaining_.store(std::ssize(entries), std::memory_order_relaxed);
+	push_tasks(task, weight, std::move(entries), scheduler, worker);
+}
+
+/*!
+ * Replaces the zip archive @p archive by a new archive in which the changed
+ * entries are compressed again and the others are copied.
+ */
+static void write_archive(Input_archive& archive)
+{
+	auto replaced = std::vector<const Zip_archive::Data*>();
+	
+	for (const auto& data : archive.replaced_)
+	{
+		replaced.push_back(data ? &*data : nullptr);
+	}
+	
+	if (std::ranges::count(replaced, nullptr) == std::ssize(replaced))
+	{
+		return;
+	}
+	
+	auto timer = Stage_timer(run_context(), Stage::writing);
+	const auto& path = archive.path_;
+	auto temporary_path = path.native() + ".tmp" + std::to_string(::getpid());
+	struct ::stat status;
+	auto mode = ::stat(path.c_str(), &status) == 0 ? status.st_mode & 07777 : 0644;
+	int fd = ::open(temporary_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, mode);
+	
+	if (fd == -1)
+	{
+		throw std::system_error(errno, std::generic_category(), path.native() + ": Could not open file for writing");
+	}
+	
+	auto written = std::ptrdiff_t(0);
+	
+	try
+	{
+		written = archive.archive_.write(fd, replaced);
+		
+		if (::close(std::exchange(fd, -1)) == -1 or ::rename(temporary_path.c_str(), path.c_str()) == -1)
+		{
+			throw std::system_error(errno, std::generic_category(), "Could not replace archive");
+		}
+	}
+	catch (std::exception& ex)
+	{
+		if (fd != -1)
+		{
+			::close(fd);
+		}
+		
+		auto ignored = std::error_code();
+		std::filesystem::remove(temporary_path, ignored);
+		throw std::runtime_error(path.native() + ": " + ex.what());
+	}
+	
+	{
+		auto log = std::osyncstream(std::clog);
+		
+		for (std::ptrdiff_t index = 0; index != std::ssize(replaced); ++index)
+		{
+			if (replaced[index])
+			{
+				log << "Removing symbols from file " << path.native() << "!/" << archive.archive_.entries()[index].name_ << "\n";
+			}
+		}
+	}
+	
+	if (strict_mode)
+	{
+		strict_mode->mark_origin(path.origin_index());
+	}
+	
+	if (statistics)
+	{
+		statistics->record().bytes_written_ += written;
+	}
+}
+
+/*!
+ * Handles the Java entry of a zip archive of @p task like handle_file. In the
+ * in-place mode, a changed entry is compressed by this thread and the archive
+ * is written after its last entry is handled, unless handling any entry failed.
+ */
+static void handle_archive_entry(const Input_task& task, const Parameters& parameters)
+{
+	auto& archive = *task.archive_;
+	
+	try
+	{
+		thread_local auto buffer = std::string();
+		auto span = Trace_span(run_context().tracer_, "file", task.path_.native());
+		const auto start = statistics ? std::chrono::steady_clock::now() : std::chrono::steady_clock::time_point();
+		const auto& entry = archive.archive_.entries()[task.entry_index_];
+		
+		const auto original_content = [&]() -> std::string_view
+		{
+			auto timer = Stage_timer(run_context(), Stage::reading);
+			return Zip_archive::read(entry, buffer);
+		}();
+		
+		if (statistics)
+		{
+			auto& record = statistics->record();
+			++record.files_read_;
+			record.bytes_read_ += std::ssize(original_content);
+		}
+		
+		const auto& filter = task.path_.filename() == "module-info.java" ? parameters.module_filter_ : parameters.filter_;
+		auto new_content = Edited_content(original_content);
+		
+		if (not filter or filter->matches(original_content))
+		{
+			new_content = handle_content(task.path_, original_content, parameters, run_context());
+		}
+		else if (statistics)
+		{
+			++statistics->record().files_prefiltered_;
+		}
+		
+		auto timer = std::optional<Stage_timer>(std::in_place, run_context(), Stage::writing);
+		
+		if (not parameters.in_place_)
+		{
+			auto header = task.path_.native() + ":\n";
+			ordered_output->write(*task.output_slot_, header, new_content);
+			
+			if (statistics)
+			{
+				statistics->record().bytes_written_ += std::ssize(header) + new_content.size();
+			}
+		}
+		else if (new_content.changed())
+		{
+			archive.replaced_[task.entry_index_] = Zip_archive::compress(new_content.spans(), entry.method_);
+		}
+		
+		timer.reset();
+		
+		if (statistics)
+		{
+			if (new_content.changed())
+			{
+				++statistics->record().files_changed_;
+			}
+			
+			statistics->add_file_time(std::chrono::steady_clock::now() - start, std::ssize(original_content), task.path_);
+		}
+	}
+	catch (std::exception& ex)
+	{
+		archive.failed_.store(true, std::memory_order_relaxed);
+		archive.remaining_.fetch_sub(1, std::memory_order_acq_rel);
+		throw std::runtime_error(task.path_.native() + ": " + ex.what());
+	}
+	
+	if (archive.remaining_.fetch_sub(1, std::memory_order_acq_rel) == 1 and parameters.in_place_
+		and not archive.failed_.load(std::memory_order_relaxed))
+	{
+		write_archive(archive);
+	}
+}
+
+static double seconds(std::chrono::nanoseconds duration) noexcept
+{
+	return std::chrono::duration<double>(duration).count();
+}
+
+//! @return @p value as a quoted JSON string.
+static std::string json_string(std::string_view value)
+{
+	return Tracer::quoted(value);
+}
+
+static void print_statistics_text(std::ostream& os)
+{
+	const auto total = statistics->merged();
+	
+	os << "jurand: stats: files discovered: " << total.files_discovered_
+		<< ", read: " << total.files_read_
+		<< ", changed: " << total.files_changed_ << "\n";
+	os << "jurand: stats: files skipped by the literal prefilter: " << total.files_prefiltered_ << "\n";
+	os << "jurand: stats: files found in the cache: " << total.files_cached_ << "\n";
+	os << "jurand: stats: bytes read: " << total.bytes_read_ << ", written: " << total.bytes_written_ << "\n";
+	os << "jurand: stats: thread time in";
+	
+	for (std::size_t i = 0; i != stage_names.size(); ++i)
+	{
+		os << (i == 0 ? " " : ", ") << stage_names[i] << ": " << seconds(total.stage_times_[i]) << " s";
+	}
+	
+	os << "\n";
+	
+	auto lookups = total.match_cache_front_hits_ + total.match_cache_shared_hits_ + total.match_cache_misses_;
+	
+	os << "jurand: stats: pattern match cache lookups: " << lookups
+		<< ", thread cache hits: " << total.match_cache_front_hits_
+		<< ", shared cache hits: " << total.match_cache_shared_hits_
+		<< ", misses: " << total.match_cache_misses_ << "\n";
+	
+	for (auto [kind, matchers, hits] : {
+		std::tuple("simple name", &statistics->names_, &total.name_hits_),
+		std::tuple("pattern", &statistics->patterns_, &total.pattern_hits_),
+		std::tuple("module pattern", &statistics->module_patterns_, &total.module_pattern_hits_),
+	})
+	{
+		for (std::size_t i = 0; i != matchers->size(); ++i)
+		{
+			os << "jurand: stats: " << kind << " " << (*matchers)[i] << " matched " << (*hits)[i] << " times\n";
+		}
+	}
+	
+	for (const auto& worker : statistics->workers())
+	{
+		os << "jurand: stats: thread " << worker.worker_
+			<< " busy: " << seconds(worker.busy_time_) << " s"
+			<< ", idle: " << seconds(worker.idle_time_) << " s\n";
+	}
+	
+	for (const auto& file : total.slowest_files_)
+	{
+		os << "jurand: stats: slow file: " << file.path_ << " (" << file.size_ << " bytes): " << seconds(file.time_) << " s\n";
+	}
+}
+
+static void print_statistics_json(std::ostream& os)
+{
+	const auto total = statistics->merged();
 	
-	auto parameter_dict = parse_arguments(args, {"-a", "-i", "--in-place", "-s", "--strict"});
+	os << "{\n";
+	os << "\t\"files\": {\"discovered\": " << total.files_discovered_
+		<< ", \"read\": " << total.files_read_
+		<< ", \"changed\": " << total.files_changed_
+		<< ", \"prefiltered\": " << total.files_prefiltered_
+		<< ", \"cached\": " << total.files_cached_ << "},\n";
+	os << "\t\"bytes\": {\"read\": " << total.bytes_read_ << ", \"written\": " << total.bytes_written_ << "},\n";
+	os << "\t\"stage_seconds\": {";
 	
+	for (std::size_t i = 0; i != stage_names.size(); ++i)
+	{
+		os << (i == 0 ? "" : ", ") << json_string(stage_names[i]) << ": " << seconds(total.stage_times_[i]);
+	}
+	
+	os << "},\n";
+	os << "\t\"match_cache\": {\"front_hits\": " << total.match_cache_front_hits_
+		<< ", \"shared_hits\": " << total.match_cache_shared_hits_
+		<< ", \"misses\": " << total.match_cache_misses_ << "},\n";
+	os << "\t\"matchers\": {";
+	
+	bool first_kind = true;
+	
+	for (auto [kind, matchers, hits] : {
+		std::tuple("names", &statistics->names_, &total.name_hits_),
+		std::tuple("patterns", &statistics->patterns_, &total.pattern_hits_),
+		std::tuple("module_patterns", &statistics->module_patterns_, &total.module_pattern_hits_),
+	})
+	{
+		os << (std::exchange(first_kind, false) ? "" : ", ") << json_string(kind) << ": {";
+		
+		for (std::size_t i = 0; i != matchers->size(); ++i)
+		{
+			os << (i == 0 ? "" : ", ") << json_string((*matchers)[i]) << ": " << (*hits)[i];
+		}
+		
+		os << "}";
+	}
+	
+	os << "},\n";
+	os << "\t\"threads\": [";
+	
+	auto workers = statistics->workers();
+	
+	for (const auto& worker : workers)
+	{
+		os << (&worker == &workers.front() ? "" : ", ")
+			<< "{\"worker\": " << worker.worker_
+			<< ", \"busy_seconds\": " << seconds(worker.busy_time_)
+			<< ", \"idle_seconds\": " << seconds(worker.idle_time_) << "}";
+	}
+	
+	os << "],\n";
+	os << "\t\"slowest_files\": [";
+	
+	for (const auto& file : total.slowest_files_)
+	{
+		os << (&file == &total.slowest_files_.front() ? "" : ", ")
+			<< "{\"path\": " << json_string(file.path_)
+			<< ", \"bytes\": " << file.size_
+			<< ", \"seconds\": " << seconds(file.time_) << "}";
+	}
+	
+	os << "]\n";
+	os << "}\n";
+}
+
+static void print_statistics(bool json)
+{
+	if (statistics)
+	{
+		auto stream = std::ostringstream();
+		stream << std::fixed << std::setprecision(6);
+		
+		if (json)
+		{
+			print_statistics_json(stream);
+		}
+		else
+		{
+			print_statistics_text(stream);
+		}
+		
+		std::clog << stream.view();
+	}
+}
+
+/*!
+ * Runs one invocation with the arguments in @p parameter_dict, whose worker
+ * threads are those of @p thread_pool.
+ * 
+ * @return The exit code of the invocation.
+ */
+static int run(Parameter_dict& parameter_dict, Thread_pool& thread_pool)
+{
 	if (parameter_dict.empty())
 	{
 		std::cout << 1 + (R"""(
 Usage: jurand [optional flags] <matcher>... [file path]...
+    File paths ending with .jar or .zip are handled as zip archives
+    
     Matcher:
         -n <name>
                 simple (not fully-qualified) class name
@@ -31,6 +686,24 @@ Usage: jurand [optional flags] <matcher>... [file path]...
         -s, --strict
                 (wih -i only) fail if any of the specified options was redundant
                 and no changes associated with the option were made
+        --stats, --stats=json
+                print statistics about the run to the standard error output,
+                optionally as JSON
+        --cache-dir=<directory>
+                remember the results of handling files in <directory> and
+                reuse them for files with the same content in later runs
+        --jobs-file=<file>
+                handle several in-place invocations at once, each line of
+                <file> contains the arguments of one invocation; the files
+                are traversed once and handled by the invocations in order
+        --trace=<file>
+                write a trace of the work of each thread to <file> in the
+                Trace Event Format viewable in Perfetto or chrome://tracing
+        --serve=<socket>
+                keep running and handle the invocations of clients which
+                connect to the Unix socket <socket>, every invocation
+                forwards its arguments to the server at the socket in
+                the environment variable JURAND_SERVER if it is set
 
         -h, --help
                 print help message
@@ -38,7 +711,86 @@ Usage: jurand [optional flags] <matcher>... [file path]...
 		return 0;
 	}
 	
-	const auto parameters = interpret_args(parameter_dict);
+	auto jobs = std::vector<std::unique_ptr<Job>>();
+	auto jobs_dict = Parameter_dict();
+	
+	if (auto it = parameter_dict.find("--jobs-file"); it != parameter_dict.end())
+	{
+		for (const auto& [flag, values] : parameter_dict)
+		{
+			if (flag != "--jobs-file" and flag != "--stats" and flag != "--trace" and not (flag.empty() and values.empty()))
+			{
+				std::cout << "jurand: --jobs-file can only be combined with --stats and --trace" << "\n";
+				return 1;
+			}
+		}
+		
+		if (it->second.empty() or it->second.back().empty())
+		{
+			std::cout << "jurand: no jobs file specified" << "\n";
+			return 1;
+		}
+		
+		try
+		{
+			auto buffer = std::string();
+			jobs = read_jobs(File_content(std::filesystem::path(it->second.back()), buffer).view());
+		}
+		catch (std::system_error& ex)
+		{
+			std::cout << "jurand: " << it->second.back() << ": " << ex.what() << "\n";
+			return 1;
+		}
+		catch (std::invalid_argument& ex)
+		{
+			std::cout << "jurand: " << ex.what() << "\n";
+			return 1;
+		}
+		
+		if (jobs.empty())
+		{
+			std::cout << "jurand: no jobs in " << it->second.back() << "\n";
+			return 1;
+		}
+		
+		for (const auto& job : jobs)
+		{
+			for (auto root : job->roots_)
+			{
+				if (not std::filesystem::exists(root))
+				{
+					std::cout << "jurand: file does not exist: " << root << "\n";
+					return 2;
+				}
+			}
+		}
+		
+		jobs_dict = jobs_parameter_dict(jobs);
+	}
+	
+	// With a jobs file, the parameters of all jobs are used for bookkeeping
+	auto& arguments = jobs.empty() ? parameter_dict : jobs_dict;
+	auto parsed_parameters = std::optional<Parameters>();
+	const Parameters* cached_parameters = nullptr;
+	
+	try
+	{
+		if (parameters_cache)
+		{
+			cached_parameters = &parameters_cache->find(arguments);
+		}
+		else
+		{
+			parsed_parameters.emplace(interpret_args(arguments));
+		}
+	}
+	catch (std::invalid_argument& ex)
+	{
+		std::cout << "jurand: " << ex.what() << "\n";
+		return 1;
+	}
+	
+	const auto& parameters = cached_parameters ? *cached_parameters : *parsed_parameters;
 	
 	if (parameters.names_.empty() and parameters.patterns_.empty() and parameters.module_patterns_.empty())
 	{
@@ -46,7 +798,69 @@ Usage: jurand [optional flags] <matcher>... [file path]...
 		return 1;
 	}
 	
-	const auto fileroots = std::span<std::string_view>(parameter_dict.find("")->second);
+	bool json_statistics = false;
+	
+	if (auto it = parameter_dict.find("--stats"); it != parameter_dict.end())
+	{
+		for (auto format : it->second)
+		{
+			if (format != "json")
+			{
+				std::cout << "jurand: unknown statistics format: " << format << "\n";
+				return 1;
+			}
+			
+			json_statistics = true;
+		}
+		
+		statistics.emplace(parameters);
+		
+		for (const auto& job : jobs)
+		{
+			job->statistics_.emplace(job->parameters_, 0);
+		}
+	}
+	
+	auto trace_path = std::filesystem::path();
+	
+	if (auto it = parameter_dict.find("--trace"); it != parameter_dict.end())
+	{
+		if (it->second.empty() or it->second.back().empty())
+		{
+			std::cout << "jurand: no trace file specified" << "\n";
+			return 1;
+		}
+		
+		trace_path = it->second.back();
+		tracer.emplace();
+		tracer->name_thread("main");
+	}
+	
+	if (auto it = parameter_dict.find("--cache-dir"); it != parameter_dict.end())
+	{
+		if (it->second.empty() or it->second.back().empty())
+		{
+			std::cout << "jurand: no cache directory specified" << "\n";
+			return 1;
+		}
+		
+		auto cache_directory = std::filesystem::path(it->second.back());
+		
+		if (auto error = std::error_code(); not std::filesystem::create_directories(cache_directory, error) and error)
+		{
+			std::cout << "jurand: could not create cache directory " << cache_directory.native() << ": " << error.message() << "\n";
+			return 1;
+		}
+		
+		content_cache.emplace(cache_directory, parameters_fingerprint(parameters));
+	}
+	
+	if (not parameters.patterns_.empty() and jobs.empty())
+	{
+		match_cache.emplace(parameters.patterns_);
+	}
+	
+	const auto fileroots = std::span<std::string_view>(arguments.find("")->second);
 	
 	if (fileroots.empty())
 	{
@@ -56,17 +870,31 @@ Usage: jurand [optional flags] <matcher>... [file path]...
 			return 1;
 		}
 		
-		handle_file({}, parameters);
+		handle_file({}, parameters, run_context());
+		print_statistics(json_statistics);
+		
+		if (tracer)
+		{
+			try
+			{
+				tracer->write(trace_path);
+			}
+			catch (std::exception& ex)
+			{
+				std::cout << "jurand: " << ex.what() << "\n";
+				return 2;
+			}
+		}
 		
 		return 0;
 	}
 	
-	auto files_count = std::atomic<std::ptrdiff_t>(0);
-	auto files = std::vector<Path_origin_entry>();
-	files.reserve(32);
+	auto roots = std::vector<Input_scheduler::Chunk>();
+	bool any_directory = false;
 	
-	for (auto fileroot : fileroots)
+	for (std::ptrdiff_t fileroot_index = 0; fileroot_index != std::ssize(fileroots); ++fileroot_index)
 	{
+		auto fileroot = fileroots[fileroot_index];
 		auto to_handle = std::filesystem::path(fileroot);
 		
 		if (not std::filesystem::exists(to_handle))
@@ -75,92 +903,215 @@ Usage: jurand [optional flags] <matcher>... [file path]...
 			return 2;
 		}
 		
-		if (std::filesystem::is_regular_file(to_handle) and not std::filesystem::is_symlink(to_handle))
+		if (jobs.empty() and is_archive_path(fileroot) and std::filesystem::is_regular_file(to_handle)
+			and not std::filesystem::is_symlink(to_handle))
+		{
+			auto& task = roots.emplace_back(Input_weight(directory_weight)).tasks_.emplace_back(
+				Path_origin_entry(std::move(to_handle), fileroot, fileroot_index), false);
+			task.is_archive_ = true;
+			any_directory = true;
+		}
+		else if (std::filesystem::is_regular_file(to_handle) and not std::filesystem::is_symlink(to_handle))
 		{
-			files.emplace_back(std::move(to_handle), fileroot);
+			auto size = std::filesystem::file_size(to_handle);
+			roots.emplace_back(Input_weight(size)).tasks_.emplace_back(Path_origin_entry(std::move(to_handle), fileroot, fileroot_index), false);
 		}
 		else if (std::filesystem::is_directory(to_handle))
 		{
-			for (const auto& dir_entry : std::filesystem::recursive_directory_iterator(to_handle))
-			{
-				to_handle = dir_entry;
-				
-				if (std::filesystem::is_regular_file(to_handle)
-					and not std::filesystem::is_symlink(to_handle)
-					and to_handle.native().ends_with(".java"))
-				{
-					files.emplace_back(std::move(to_handle), fileroot);
-				}
-			}
+			roots.emplace_back(Input_weight(directory_weight)).tasks_.emplace_back(Path_origin_entry(std::move(to_handle), fileroot, fileroot_index), true);
+			any_directory = true;
 		}
 	}
 	
-	if (files.empty())
+	if (parameters.strict_mode_)
 	{
-		std::cout << "jurand: no valid input files" << "\n";
-		return 1;
+		strict_mode.emplace(fileroots, parameters);
 	}
 	
-	if (parameters.strict_mode_)
+	if (statistics)
 	{
-		strict_mode.emplace();
-		
-		for (auto fileroot : fileroots)
-		{
-			strict_mode->files_truncated_.lock().get().try_emplace(fileroot);
-		}
-		
-		for (const auto& pattern : parameters.patterns_)
+		statistics->record().files_discovered_ += std::ranges::count_if(roots, [](const auto& root) noexcept -> bool
 		{
-			strict_mode->patterns_matched_.lock().get().try_emplace(pattern);
-		}
-		
-		for (const auto& pattern : parameters.module_patterns_)
-		{
-			strict_mode->module_patterns_matched_.lock().get().try_emplace(pattern);
-		}
+			return not root.tasks_.front().is_directory_ and not root.tasks_.front().is_archive_;
+		});
+	}
+	
+	auto thread_count = std::max<std::size_t>(1, std::thread::hardware_concurrency());
+	
+	if (not any_directory)
+	{
+		thread_count = std::min(thread_count, std::size(fileroots));
+	}
+	
+	if (not parameters.in_place_)
+	{
+		ordered_output.emplace(thread_count);
+		auto slots = ordered_output->expand(ordered_output->root(), std::ssize(roots));
 		
-		for (const auto& name : parameters.names_)
+		for (std::ptrdiff_t index = 0; index != std::ssize(roots); ++index)
 		{
-			strict_mode->names_matched_.lock().get().try_emplace(name);
+			roots[index].weight_.position_.push_back(static_cast<std::uint32_t>(index));
+			roots[index].tasks_.front().output_slot_ = &slots[index];
+			
+			if (not roots[index].tasks_.front().is_directory_ and not roots[index].tasks_.front().is_archive_)
+			{
+				roots[index].weight_.size_ = 0;
+			}
 		}
 	}
 	
-	auto threads = std::vector<std::thread>(std::min(std::size(files), std::max<std::size_t>(1, std::thread::hardware_concurrency())));
+	auto scheduler = Input_scheduler(thread_count);
+	push_dealt(scheduler, 0, std::move(roots));
 	
+	auto files_count = std::atomic<std::ptrdiff_t>(0);
 	auto errors = Mutex<std::vector<std::string>>();
 	
-	for (auto& thread : threads)
+	thread_pool.run(static_cast<std::ptrdiff_t>(thread_count), [&](std::ptrdiff_t worker) noexcept -> void
 	{
-		thread = std::thread([&]() noexcept -> void
+		const auto context = run_context();
+		auto* record = statistics ? &statistics->record() : nullptr;
+		
+		if (record)
 		{
-			while (true)
+			record->worker_ = worker;
+		}
+		
+		if (tracer)
+		{
+			tracer->name_thread("worker " + std::to_string(worker));
+		}
+		
+		auto idle_start = std::chrono::steady_clock::now();
+		
+		while (auto chunk = scheduler.pop(worker))
+		{
+			auto busy_start = std::chrono::steady_clock::now();
+			
+			// Large files are only split among the part helpers on the cores of idle workers
+			auto busy = Helper_pool::Busy(part_helpers());
+			
+			if (tracer)
+			{
+				tracer->add("idle", idle_start, busy_start);
+			}
+			
+			for (const auto& task : chunk->tasks_)
 			{
-				auto index = files_count.fetch_add(1, std::memory_order_acq_rel);
-				
-				if (index >= std::ssize(files))
-				{
-					break;
-				}
-				
 				try
 				{
-					handle_file(files[index], parameters);
+					if (task.is_directory_)
+					{
+						list_directory(task, chunk->weight_, scheduler, worker);
+					}
+					else if (task.is_archive_)
+					{
+						// The archive is an input file, even if it is malformed
+						files_count.fetch_add(1, std::memory_order_relaxed);
+						list_archive(task, chunk->weight_, scheduler, worker);
+					}
+					else if (task.archive_)
+					{
+						handle_archive_entry(task, parameters);
+					}
+					else
+					{
+						files_count.fetch_add(1, std::memory_order_relaxed);
+						
+						if (jobs.empty())
+						{
+							handle_file(task.path_, parameters, context, task.output_slot_);
+						}
+						else
+						{
+							handle_file_jobs(task.path_, jobs, context);
+						}
+					}
 				}
 				catch (std::exception& ex)
 				{
 					errors.lock().get().emplace_back(ex.what());
+					
+					// The slot is completed only if handling succeeded
+					if (task.output_slot_ and (task.is_directory_ or task.is_archive_))
+					{
+						ordered_output->expand(*task.output_slot_, 0);
+					}
+					else if (task.output_slot_)
+					{
+						ordered_output->skip(*task.output_slot_);
+					}
 				}
 			}
-		});
+			
+			scheduler.done();
+			auto busy_end = std::chrono::steady_clock::now();
+			
+			if (record)
+			{
+				record->idle_time_ += busy_start - idle_start;
+				record->busy_time_ += busy_end - busy_start;
+			}
+			
+			idle_start = busy_end;
+		}
+		
+		if (record)
+		{
+			record->idle_time_ += std::chrono::steady_clock::now() - idle_start;
+		}
+	});
+	
+	if (ordered_output)
+	{
+		try
+		{
+			ordered_output->flush();
+		}
+		catch (std::exception& ex)
+		{
+			errors.lock().get().emplace_back(ex.what());
+		}
 	}
 	
-	for (auto& thread : threads)
+	if (files_count.load(std::memory_order_acquire) == 0)
 	{
-		thread.join();
+		std::cout << "jurand: no valid input files" << "\n";
+		return 1;
+	}
+	
+	if (content_cache)
+	{
+		try
+		{
+			content_cache->save();
+		}
+		catch (std::exception& ex)
+		{
+			errors.lock().get().emplace_back(ex.what());
+		}
+	}
+	
+	for (const auto& job : jobs)
+	{
+		if (job->statistics_)
+		{
+			statistics->add_hits(*job->statistics_);
+		}
 	}
 	
-	threads.clear();
+	print_statistics(json_statistics);
+	
+	if (tracer)
+	{
+		try
+		{
+			tracer->write(trace_path);
+		}
+		catch (std::exception& ex)
+		{
+			errors.lock().get().emplace_back(ex.what());
+		}
+	}
 	
 	int exit_code = 0;
 	
@@ -174,45 +1125,44 @@ Usage: jurand [optional flags] <matcher>... [file path]...
 			std::cout << "* " << error << "\n";
 		}
 	}
-	else if (strict_mode)
+	else if (strict_mode and not jobs.empty())
 	{
-		for (const auto& file_entry : strict_mode->files_truncated_.lock().get())
+		for (const auto& job : jobs)
 		{
-			if (not file_entry.second)
+			for (const auto& failure : job->strict_mode_failures())
 			{
-				std::cout << "jurand: strict mode: no changes were made in " << file_entry.first << "\n";
+				std::cout << "jurand: jobs file line " << job->line_number_ << ": strict mode: " << failure << "\n";
 				exit_code = 3;
 			}
 		}
+	}
+	else if (strict_mode)
+	{
+		for (auto fileroot : strict_mode->unchanged_origins())
+		{
+			std::cout << "jurand: strict mode: no changes were made in " << fileroot << "\n";
+			exit_code = 3;
+		}
 		
-		for (const auto& name_entry : strict_mode->names_matched_.lock().get())
+		for (auto name : strict_mode->unmatched_names())
 		{
-			if (not name_entry.second)
-			{
-				std::cout << "jurand: strict mode: simple name " << name_entry.first << " did not match anything" << "\n";
-				exit_code = 3;
-			}
+			std::cout << "jurand: strict mode: simple name " << name << " did not match anything" << "\n";
+			exit_code = 3;
 		}
 		
-		for (const auto& pattern_entry : strict_mode->patterns_matched_.lock().get())
+		for (auto pattern : strict_mode->unmatched_patterns())
 		{
-			if (not pattern_entry.second)
-			{
-				std::cout << "jurand: strict mode: pattern " << pattern_entry.first << " did not match anything" << "\n";
-				exit_code = 3;
-			}
+			std::cout << "jurand: strict mode: pattern " << pattern << " did not match anything" << "\n";
+			exit_code = 3;
 		}
 		
-		for (const auto& pattern_entry : strict_mode->module_patterns_matched_.lock().get())
+		for (auto pattern : strict_mode->unmatched_module_patterns())
 		{
-			if (not pattern_entry.second)
-			{
-				std::cout << "jurand: strict mode: module pattern " << pattern_entry.first << " did not match anything" << "\n";
-				exit_code = 3;
-			}
+			std::cout << "jurand: strict mode: module pattern " << pattern << " did not match anything" << "\n";
+			exit_code = 3;
 		}
 		
-		if (parameters.also_remove_annotations_ and not strict_mode->any_annotation_removed_.load(std::memory_order_acquire))
+		if (parameters.also_remove_annotations_ and not strict_mode->any_annotation_removed())
 		{
 			std::cout << "jurand: strict mode: '-a' was specified but no annotation was removed" << "\n";
 			exit_code = 3;
@@ -221,3 +1171,219 @@ Usage: jurand [optional flags] <matcher>... [file path]...
 	
 	return exit_code;
 }
+
+//! Set by a signal to stop a server
+static volatile std::sig_atomic_t stop_requested = 0;
+
+/*!
+ * Handles the request received from @p connection with the standard streams
+ * of the client in place of the standard streams of this process, which are
+ * kept in @p saved_fds.
+ * 
+ * @return The exit code or `std::nullopt` if no valid request was received.
+ */
+static std::optional<int> handle_request(int connection, const std::array<int, 3>& saved_fds, int directory, Thread_pool& thread_pool)
+{
+	auto request = Server_request();
+	
+	if (not request.receive(connection))
+	{
+		return std::nullopt;
+	}
+	
+	for (int fd = 0; fd != 3; ++fd)
+	{
+		::dup2(request.fds_[fd], fd);
+	}
+	
+	// A previous client may have closed its pipes, which failed the streams
+	std::cout.clear();
+	std::clog.clear();
+	
+	int exit_code = 2;
+	
+	try
+	{
+		if (::chdir(request.directory_.c_str()) == -1)
+		{
+			throw std::system_error(errno, std::generic_category(), "Could not change directory to " + request.directory_);
+		}
+		
+		auto args = std::vector<const char*>();
+		
+		for (const auto& argument : request.arguments_)
+		{
+			args.push_back(argument.c_str());
+		}
+		
+		auto parameter_dict = parse_arguments(args, no_argument_flags);
+		exit_code = run(parameter_dict, thread_pool);
+	}
+	catch (std::exception& ex)
+	{
+		std::cout << "jurand: " << ex.what() << "\n";
+	}
+	
+	strict_mode.reset();
+	ordered_output.reset();
+	content_cache.reset();
+	match_cache.reset();
+	statistics.reset();
+	tracer.reset();
+	
+	std::cout.flush();
+	std::clog.flush();
+	
+	for (int fd = 0; fd != 3; ++fd)
+	{
+		::dup2(saved_fds[fd], fd);
+	}
+	
+	std::cout.clear();
+	std::clog.clear();
+	::fchdir(directory);
+	
+	return exit_code;
+}
+
+/*!
+ * Handles the requests of clients connecting to @p socket_path one at a time
+ * until the process receives SIGINT or SIGTERM. The worker threads and the
+ * compiled matchers are kept between the requests. A client which does not
+ * send its request within Server_request::default_timeout is disconnected.
+ */
+static int serve(const std::filesystem::path& socket_path)
+{
+	int listener = -1;
+	
+	try
+	{
+		listener = listen_socket(socket_path);
+	}
+	catch (std::system_error& ex)
+	{
+		std::cout << "jurand: " << ex.what() << "\n";
+		return 2;
+	}
+	
+	// The requests are interrupted rather than restarted to stop waiting
+	struct ::sigaction action = {};
+	action.sa_handler = [](int) noexcept -> void {stop_requested = 1;};
+	::sigaction(SIGINT, &action, nullptr);
+	::sigaction(SIGTERM, &action, nullptr);
+	std::signal(SIGPIPE, SIG_IGN);
+	
+	auto saved_fds = std::array<int, 3>();
+	
+	for (int fd = 0; fd != 3; ++fd)
+	{
+		saved_fds[fd] = ::fcntl(fd, F_DUPFD_CLOEXEC, 3);
+	}
+	
+	int directory = ::open(".", O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+	auto absolute_socket_path = std::filesystem::absolute(socket_path);
+	auto thread_pool = Thread_pool();
+	parameters_cache.emplace();
+	
+	while (not stop_requested)
+	{
+		int connection = ::accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+		
+		if (connection == -1)
+		{
+			continue;
+		}
+		
+		auto credentials = ::ucred();
+		auto length = ::socklen_t(sizeof(credentials));
+		
+		if (::getsockopt(connection, SOL_SOCKET, SO_PEERCRED, &credentials, &length) == 0 and credentials.uid == ::getuid())
+		{
+			if (auto exit_code = handle_request(connection, saved_fds, directory, thread_pool))
+			{
+				try
+				{
+					Server_request::send_exit_code(connection, *exit_code);
+				}
+				catch (std::system_error&)
+				{
+					// The client is gone
+				}
+			}
+		}
+		
+		::close(connection);
+	}
+	
+	::close(listener);
+	::unlink(absolute_socket_path.c_str());
+	
+	return 0;
+}
+
+/*!
+ * Forwards the invocation with @p args to the server at @p socket_path.
+ * 
+ * @return The exit code of the invocation or `std::nullopt` if no server
+ * listens at the socket.
+ */
+static std::optional<int> forward(const std::filesystem::path& socket_path, std::span<const char*> args)
+{
+	int connection = connect_socket(socket_path);
+	
+	if (connection == -1)
+	{
+		return std::nullopt;
+	}
+	
+	auto exit_code = std::optional<int>();
+	
+	try
+	{
+		Server_request::send(connection, args);
+		exit_code = Server_request::receive_exit_code(connection);
+	}
+	catch (std::system_error&)
+	{
+	}
+	
+	::close(connection);
+	
+	if (not exit_code)
+	{
+		std::cout << "jurand: the server at " << socket_path.native() << " did not handle the request" << "\n";
+		return 2;
+	}
+	
+	return exit_code;
+}
+
+int main(int argc, const char** argv)
+{
+	auto args = std::span<const char*>(argv + 1, argc - 1);
+	
+	auto parameter_dict = parse_arguments(args, no_argument_flags);
+	
+	if (auto it = parameter_dict.find("--serve"); it != parameter_dict.end())
+	{
+		if (it->second.size() != 1 or it->second.back().empty() or std::ssize(parameter_dict) != 2 or not parameter_dict.find("")->second.empty())
+		{
+			std::cout << "jurand: --serve requires a socket path and no other arguments" << "\n";
+			return 1;
+		}
+		
+		return serve(it->second.back());
+	}
+	
+	if (const char* socket_path = std::getenv("JURAND_SERVER"); socket_path and *socket_path and not parameter_dict.empty())
+	{
+		if (auto exit_code = forward(socket_path, args))
+		{
+			return *exit_code;
+		}
+	}
+	
+	auto thread_pool = Thread_pool();
+	
+	return run(parameter_dict, thread_pool);
+}
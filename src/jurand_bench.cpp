@@ -0,0 +1,562 @@
+#include <cerrno>
+#include <cstdint>
+
+#include <array>
+#include <atomic>
+#include <chrono>
+#include <exception>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <iostream>
+#include <limits>
+#include <map>
+#include <optional>
+#include <random>
+#include <regex>
+#include <span>
+#include <sstream>
+#include <string>
+#include <system_error>
+#include <thread>
+#include <vector>
+
+#include <fcntl.h>
+#include <sys/resource.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include "java_symbols.hpp"
+
+using namespace java_symbols;
+
+//! Kept for all the runs as in a run of jurand handling all the files
+static auto match_cache = std::optional<Match_cache>();
+
+/*!
+ * Parameters of the generated corpus, the same parameters always produce the
+ * same files.
+ */
+struct Corpus_parameters
+{
+	std::ptrdiff_t files_ = 2000;
+	std::ptrdiff_t file_size_ = 8 * 1024;
+	std::ptrdiff_t imports_ = 20;
+	
+	//! The probability that a member is annotated
+	double annotation_density_ = 0.3;
+	
+	//! The fraction of filler lines which are comments, the rest are string
+	//! literals
+	double comment_ratio_ = 0.3;
+	
+	std::uint64_t seed_ = 1;
+	std::filesystem::path directory_ = "target/bench_corpus";
+};
+
+/*!
+ * Generates Java sources which contain imports and annotations to be removed
+ * by the benchmark arguments as well as ones to be kept, with comments and
+ * string literals containing misleading tokens.
+ */
+struct Corpus_generator
+{
+	explicit Corpus_generator(const Corpus_parameters& parameters)
+		:
+		parameters_(parameters),
+		random_(parameters.seed_)
+	{
+	}
+	
+	//! The arguments of jurand which remove the generated symbols
+	inline static const auto arguments = std::array<const char*, 5>
+	{
+		"-a", "-n", "Removed", "-p", "org[.]bench[.]removed[.].*",
+	};
+	
+	std::string file(std::ptrdiff_t index)
+	{
+		auto result = std::string();
+		result.reserve(parameters_.file_size_ + 256);
+		
+		if (chance(parameters_.comment_ratio_))
+		{
+			result += "/*\n * Licensed under the terms of the benchmark license.\n * See the NOTICE file.\n */\n\n";
+		}
+		
+		result += "package org.bench.p" + std::to_string(index / files_per_directory) + ";\n\n";
+		
+		for (std::ptrdiff_t i = 0; i != parameters_.imports_; ++i)
+		{
+			if (i % 2 == 0)
+			{
+				result += "import org.bench.removed.R" + std::to_string(next(16)) + ";\n";
+			}
+			else if (i % 3 == 0)
+			{
+				result += "import static java.util.Objects.requireNonNull" + std::to_string(i) + ";\n";
+			}
+			else
+			{
+				result += "import java.util.List" + std::to_string(i) + ";\n";
+			}
+		}
+		
+		result += "\n";
+		
+		if (chance(parameters_.annotation_density_))
+		{
+			result += "@Removed\n";
+		}
+		
+		result += "public class C" + std::to_string(index) + " implements java.io.Serializable\n{\n";
+		
+		for (std::ptrdiff_t member = 0; std::ssize(result) < parameters_.file_size_; ++member)
+		{
+			annotate();
+			result += annotations_;
+			result += "\tpublic String m" + std::to_string(member) + "(@R" + std::to_string(next(16)) + " int a, int b)\n\t{\n";
+			
+			for (auto lines = 1 + next(6); lines != 0; --lines)
+			{
+				if (chance(parameters_.comment_ratio_))
+				{
+					result += next(2) == 0
+						? "\t\t// @Removed import org.bench.removed.R1; (\n"
+						: "\t\t/* @R2(\"x\") ) */ b += a;\n";
+				}
+				else
+				{
+					result += next(2) == 0
+						? "\t\tString s = \"@Removed(\\\")\\\" import x;\" + '\\'';\n"
+						: "\t\tb = java.util.Objects.hash(a, b, \"/* // @R3 */\");\n";
+				}
+			}
+			
+			result += "\t\treturn String.valueOf(a + b);\n\t}\n\t\n";
+		}
+		
+		result += "}\n";
+		
+		return result;
+	}
+	
+	/*!
+	 * Writes the corpus into its directory unless it already contains a corpus
+	 * with the same parameters.
+	 * 
+	 * @return The paths of the files and their total size.
+	 */
+	std::tuple<std::vector<Path_origin_entry>, std::uintmax_t> write()
+	{
+		auto paths = std::vector<Path_origin_entry>();
+		auto total_size = std::uintmax_t(0);
+		auto stamp_path = parameters_.directory_ / "corpus.stamp";
+		auto stamp = std::ostringstream();
+		stamp << parameters_.files_ << " " << parameters_.file_size_ << " " << parameters_.imports_ << " "
+			<< parameters_.annotation_density_ << " " << parameters_.comment_ratio_ << " " << parameters_.seed_ << "\n";
+		
+		auto existing = std::string();
+		std::getline(std::ifstream(stamp_path), existing);
+		bool reuse = existing + "\n" == stamp.str();
+		
+		if (not reuse)
+		{
+			std::filesystem::remove_all(parameters_.directory_);
+		}
+		
+		for (std::ptrdiff_t index = 0; index != parameters_.files_; ++index)
+		{
+			auto directory = parameters_.directory_ / ("p" + std::to_string(index / files_per_directory));
+			auto path = directory / ("C" + std::to_string(index) + ".java");
+			
+			if (not reuse)
+			{
+				std::filesystem::create_directories(directory);
+				std::ofstream(path) << file(index);
+			}
+			
+			total_size += std::filesystem::file_size(path);
+			paths.emplace_back(path, parameters_.directory_.native());
+		}
+		
+		if (not reuse)
+		{
+			std::ofstream(stamp_path) << stamp.str();
+		}
+		
+		return std::tuple(std::move(paths), total_size);
+	}
+	
+private:
+	static constexpr std::ptrdiff_t files_per_directory = 100;
+	
+	//! Uses the raw output of the engine which is the same on all platforms
+	std::ptrdiff_t next(std::ptrdiff_t bound)
+	{
+		return static_cast<std::ptrdiff_t>(random_() % static_cast<std::uint64_t>(bound));
+	}
+	
+	bool chance(double probability)
+	{
+		return next(1000) < static_cast<std::ptrdiff_t>(probability * 1000);
+	}
+	
+	void annotate()
+	{
+		annotations_.clear();
+		
+		if (not chance(parameters_.annotation_density_))
+		{
+			return;
+		}
+		
+		switch (next(4))
+		{
+		case 0:
+			annotations_ = "\t@Override\n";
+			break;
+		case 1:
+			annotations_ = "\t@Removed\n";
+			break;
+		case 2:
+			annotations_ = "\t@R" + std::to_string(next(16)) + "(value = \"(\", names = {\"a\", \"b\"})\n";
+			break;
+		default:
+			annotations_ = "\t@org.bench.removed.R" + std::to_string(next(16)) + " @SuppressWarnings(\"all\")\n";
+		}
+	}
+	
+	const Corpus_parameters& parameters_;
+	std::mt19937_64 random_;
+	std::string annotations_;
+};
+
+struct Run_result
+{
+	std::ptrdiff_t threads_ = 0;
+	double seconds_ = 0;
+	
+	//! The peak resident set size of the child process which measured the runs
+	long peak_rss_kib_ = 0;
+};
+
+/*!
+ * Handles all @p paths with @p thread_count threads the same way as jurand
+ * writing to the standard output.
+ * 
+ * @return The elapsed time in seconds.
+ * @throws The first exception thrown by handling a file, once all the threads
+ * have finished.
+ */
+static double run(std::span<const Path_origin_entry> paths, const Parameters& parameters, std::ptrdiff_t thread_count)
+{
+	auto next_index = std::atomic<std::ptrdiff_t>(0);
+	auto threads = std::vector<std::thread>();
+	auto exceptions = std::vector<std::exception_ptr>(thread_count);
+	auto context = Context();
+	context.match_cache_ = &*match_cache;
+	auto start = std::chrono::steady_clock::now();
+	
+	for (std::ptrdiff_t i = 0; i != thread_count; ++i)
+	{
+		threads.emplace_back([&, i]() -> void
+		{
+			try
+			{
+				for (auto index = next_index++; index < std::ssize(paths); index = next_index++)
+				{
+					handle_file(paths[index], parameters, context);
+				}
+			}
+			catch (...)
+			{
+				// The other threads stop taking files
+				next_index = std::ssize(paths);
+				exceptions[i] = std::current_exception();
+			}
+		});
+	}
+	
+	for (auto& thread : threads)
+	{
+		thread.join();
+	}
+	
+	for (const auto& exception : exceptions)
+	{
+		if (exception)
+		{
+			std::rethrow_exception(exception);
+		}
+	}
+	
+	return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+/*!
+ * Measures the fastest of @p repetitions runs with @p thread_count threads in
+ * a child process, so that the peak resident set size is of these runs alone
+ * and not the high-water mark of all the runs before.
+ * 
+ * @return The result or nothing if the child failed, which it reported.
+ */
+static std::optional<Run_result> measure(std::span<const Path_origin_entry> paths, const Parameters& parameters,
+	std::ptrdiff_t thread_count, int repetitions)
+{
+	int fds[2];
+	
+	if (::pipe2(fds, O_CLOEXEC) == -1)
+	{
+		throw std::system_error(errno, std::generic_category(), "Could not create a pipe");
+	}
+	
+	auto pid = ::fork();
+	
+	if (pid == -1)
+	{
+		auto error = errno;
+		::close(fds[0]);
+		::close(fds[1]);
+		throw std::system_error(error, std::generic_category(), "Could not start a measurement");
+	}
+	
+	if (pid == 0)
+	{
+		::close(fds[0]);
+		int status = 1;
+		
+		try
+		{
+			auto seconds = std::numeric_limits<double>::infinity();
+			
+			// One unmeasured run to fill the page cache and the match cache
+			run(paths, parameters, thread_count);
+			
+			for (int i = 0; i != repetitions; ++i)
+			{
+				seconds = std::min(seconds, run(paths, parameters, thread_count));
+			}
+			
+			if (::write(fds[1], &seconds, sizeof(seconds)) == sizeof(seconds))
+			{
+				status = 0;
+			}
+		}
+		catch (std::exception& ex)
+		{
+			std::cerr << "jurand_bench: " << ex.what() << "\n";
+		}
+		
+		::_exit(status);
+	}
+	
+	::close(fds[1]);
+	auto result = Run_result(thread_count);
+	bool received = ::read(fds[0], &result.seconds_, sizeof(result.seconds_)) == sizeof(result.seconds_);
+	::close(fds[0]);
+	
+	int status = 0;
+	auto usage = ::rusage();
+	
+	if (::wait4(pid, &status, 0, &usage) == -1 or not received or not WIFEXITED(status) or WEXITSTATUS(status) != 0)
+	{
+		return std::nullopt;
+	}
+	
+	result.peak_rss_kib_ = usage.ru_maxrss;
+	
+	return result;
+}
+
+/*!
+ * Reads the megabytes per second of each thread count from a JSON file
+ * written by a previous run.
+ */
+static std::map<std::ptrdiff_t, double> read_baseline(const std::filesystem::path& path)
+{
+	auto result = std::map<std::ptrdiff_t, double>();
+	auto stream = std::ifstream(path);
+	auto content = std::string(std::istreambuf_iterator<char>(stream), {});
+	static const auto run_regex = std::regex(R"re("threads": ([0-9]+),[^}]*"megabytes_per_second": ([0-9.]+))re");
+	
+	for (auto it = std::sregex_iterator(content.begin(), content.end(), run_regex); it != std::sregex_iterator(); ++it)
+	{
+		result[std::stoll((*it)[1])] = std::stod((*it)[2]);
+	}
+	
+	return result;
+}
+
+int main(int argc, const char** argv)
+{
+	auto corpus = Corpus_parameters();
+	auto thread_counts = std::vector<std::ptrdiff_t>();
+	auto repetitions = 3;
+	auto baseline_path = std::filesystem::path();
+	
+	for (int i = 1; i < argc; ++i)
+	{
+		auto arg = std::string_view(argv[i]);
+		
+		if (arg == "-h" or arg == "--help" or i + 1 == argc)
+		{
+			std::cout << 1 + (R"""(
+Usage: jurand_bench [option value]...
+    Corpus options:
+        --files <count>                 default 2000
+        --file-size <bytes>             default 8192
+        --imports <count>               default 20
+        --annotation-density <0..1>     default 0.3
+        --comment-ratio <0..1>          default 0.3
+        --seed <number>                 default 1
+        --directory <path>              default target/bench_corpus
+
+    Run options:
+        --threads <count,...>           default 1 and powers of 2 up to the number of CPUs
+        --repetitions <count>           default 3, the fastest run is reported
+        --baseline <JSON file>          report the throughput relative to a previous result
+)""");
+			return arg == "-h" or arg == "--help" ? 0 : 1;
+		}
+		
+		auto value = std::string(argv[++i]);
+		
+		if (arg == "--files")
+		{
+			corpus.files_ = std::stoll(value);
+		}
+		else if (arg == "--file-size")
+		{
+			corpus.file_size_ = std::stoll(value);
+		}
+		else if (arg == "--imports")
+		{
+			corpus.imports_ = std::stoll(value);
+		}
+		else if (arg == "--annotation-density")
+		{
+			corpus.annotation_density_ = std::stod(value);
+		}
+		else if (arg == "--comment-ratio")
+		{
+			corpus.comment_ratio_ = std::stod(value);
+		}
+		else if (arg == "--seed")
+		{
+			corpus.seed_ = std::stoull(value);
+		}
+		else if (arg == "--directory")
+		{
+			corpus.directory_ = value;
+		}
+		else if (arg == "--threads")
+		{
+			auto stream = std::istringstream(value);
+			
+			for (auto count = std::string(); std::getline(stream, count, ',');)
+			{
+				thread_counts.push_back(std::stoll(count));
+			}
+		}
+		else if (arg == "--repetitions")
+		{
+			repetitions = std::stoi(value);
+		}
+		else if (arg == "--baseline")
+		{
+			baseline_path = value;
+		}
+		else
+		{
+			std::cerr << "jurand_bench: unknown option " << arg << "\n";
+			return 1;
+		}
+	}
+	
+	if (thread_counts.empty())
+	{
+		auto hardware_threads = std::max<std::ptrdiff_t>(1, std::thread::hardware_concurrency());
+		
+		for (std::ptrdiff_t count = 1; count < hardware_threads; count *= 2)
+		{
+			thread_counts.push_back(count);
+		}
+		
+		thread_counts.push_back(hardware_threads);
+	}
+	
+	auto [paths, total_size] = Corpus_generator(corpus).write();
+	
+	auto args = std::span<const char*>(const_cast<const char**>(Corpus_generator::arguments.data()), Corpus_generator::arguments.size());
+	const auto parameters = interpret_args(parse_arguments(args, {"-a"}));
+	match_cache.emplace(parameters.patterns_);
+	
+	// The results are written to the null device, the standard output is kept
+	// for the report
+	int report_fd = ::dup(STDOUT_FILENO);
+	int null_fd = ::open("/dev/null", O_WRONLY | O_CLOEXEC);
+	::dup2(null_fd, STDOUT_FILENO);
+	::close(null_fd);
+	
+	auto results = std::vector<Run_result>();
+	
+	try
+	{
+		for (auto thread_count : thread_counts)
+		{
+			auto result = measure(paths, parameters, thread_count, repetitions);
+			
+			if (not result)
+			{
+				return 1;
+			}
+			
+			results.push_back(*result);
+		}
+	}
+	catch (std::exception& ex)
+	{
+		std::cerr << "jurand_bench: " << ex.what() << "\n";
+		return 1;
+	}
+	
+	::dup2(report_fd, STDOUT_FILENO);
+	::close(report_fd);
+	
+	auto baseline = baseline_path.empty() ? std::map<std::ptrdiff_t, double>() : read_baseline(baseline_path);
+	auto megabytes = double(total_size) / (1024 * 1024);
+	auto& os = std::cout;
+	os << std::fixed << std::setprecision(3);
+	
+	os << "{\n";
+	os << "\t\"corpus\": {\"files\": " << corpus.files_ << ", \"bytes\": " << total_size
+		<< ", \"file_size\": " << corpus.file_size_ << ", \"imports\": " << corpus.imports_
+		<< ", \"annotation_density\": " << corpus.annotation_density_ << ", \"comment_ratio\": " << corpus.comment_ratio_
+		<< ", \"seed\": " << corpus.seed_ << "},\n";
+	os << "\t\"runs\": [\n";
+	
+	for (const auto& result : results)
+	{
+		auto throughput = megabytes / result.seconds_;
+		
+		os << "\t\t{\"threads\": " << result.threads_
+			<< ", \"seconds\": " << result.seconds_
+			<< ", \"files_per_second\": " << double(corpus.files_) / result.seconds_
+			<< ", \"megabytes_per_second\": " << throughput
+			<< ", \"speedup\": " << results.front().seconds_ / result.seconds_
+			<< ", \"peak_rss_kib\": " << result.peak_rss_kib_;
+		
+		if (auto it = baseline.find(result.threads_); it != baseline.end())
+		{
+			os << ", \"relative_to_baseline\": " << throughput / it->second;
+		}
+		
+		os << "}" << (&result == &results.back() ? "" : ",") << "\n";
+	}
+	
+	os << "\t]\n";
+	os << "}\n";
+	
+	return 0;
+}
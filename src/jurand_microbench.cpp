@@ -0,0 +1,296 @@
+#include <cstdlib>
+
+#include <atomic>
+#include <chrono>
+#include <functional>
+#include <iomanip>
+#include <iostream>
+#include <new>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "java_symbols.hpp"
+
+using namespace java_symbols;
+
+//! The number of calls of the global allocation functions, which are not
+//! inlined so that their pairs are not reported as mismatched
+static auto allocation_count = std::atomic<std::ptrdiff_t>(0);
+
+[[gnu::noinline]] void* operator new(std::size_t size)
+{
+	allocation_count.fetch_add(1, std::memory_order_relaxed);
+	
+	if (auto* result = std::malloc(size == 0 ? 1 : size))
+	{
+		return result;
+	}
+	
+	throw std::bad_alloc();
+}
+
+[[gnu::noinline]] void operator delete(void* pointer) noexcept
+{
+	std::free(pointer);
+}
+
+[[gnu::noinline]] void operator delete(void* pointer, std::size_t) noexcept
+{
+	std::free(pointer);
+}
+
+//! Prevents the compiler from removing the computation of @p value
+template<typename Type>
+static void keep(const Type& value) noexcept
+{
+	asm volatile("" : : "r"(&value) : "memory");
+}
+
+/*!
+ * Calls @p function repeatedly for at least a fixed time and prints the time
+ * per call, per byte of the @p input and the number of allocations per call.
+ */
+static void measure(std::string_view name, std::string_view input_name, std::string_view input, const std::function<void(std::string_view)>& function)
+{
+	constexpr auto minimum_time = std::chrono::milliseconds(200);
+	
+	// Warm up caches and lazily initialized state
+	function(input);
+	
+	auto calls = std::ptrdiff_t(0);
+	auto allocations = allocation_count.load(std::memory_order_relaxed);
+	auto start = std::chrono::steady_clock::now();
+	auto elapsed = std::chrono::steady_clock::duration();
+	
+	while (elapsed < minimum_time)
+	{
+		for (int i = 0; i != 16; ++i)
+		{
+			function(input);
+		}
+		
+		calls += 16;
+		elapsed = std::chrono::steady_clock::now() - start;
+	}
+	
+	allocations = allocation_count.load(std::memory_order_relaxed) - allocations;
+	auto nanoseconds = std::chrono::duration<double, std::nano>(elapsed).count() / double(calls);
+	
+	std::cout << std::left << std::setw(28) << name << std::setw(22) << input_name
+		<< std::right << std::setw(10) << input.size()
+		<< std::fixed << std::setprecision(1) << std::setw(14) << nanoseconds
+		<< std::setprecision(3) << std::setw(10) << nanoseconds / double(std::max<std::size_t>(input.size(), 1))
+		<< std::setprecision(2) << std::setw(12) << double(allocations) / double(calls) << "\n";
+}
+
+//! @return A Java source of about @p size bytes in the usual style.
+static std::string representative_source(std::ptrdiff_t size)
+{
+	auto result = std::string(
+		"/*\n * Licensed to the Apache Software Foundation (ASF) under one\n */\n"
+		"package org.example.project;\n\n"
+		"import java.util.List;\nimport java.util.Map;\nimport static java.util.Objects.requireNonNull;\n"
+		"import org.junit.Test;\nimport org.junit.Before;\nimport javax.annotation.Nullable;\n\n"
+		"@Deprecated\n"
+		"public class Example implements java.io.Serializable\n{\n");
+	
+	for (int member = 0; std::ssize(result) < size; ++member)
+	{
+		auto index = std::to_string(member);
+		result += member % 3 == 0 ? "\t@Test\n" : member % 3 == 1 ? "\t@SuppressWarnings({\"unchecked\", \"rawtypes\"})\n" : "";
+		result += "\tpublic String method" + index + "(@Nullable List<String> list, int count)\n\t{\n";
+		result += "\t\t// Returns the element " + index + " (or a default value)\n";
+		result += "\t\tString value = \"value with @ and ( in a string \\\" literal\";\n";
+		result += "\t\treturn list.size() > count ? list.get(count) : value + '\\'' + Map.of();\n\t}\n\t\n";
+	}
+	
+	result += "}\n";
+	
+	return result;
+}
+
+static std::string repeat(std::string_view part, std::ptrdiff_t size)
+{
+	auto result = std::string();
+	
+	while (std::ssize(result) < size)
+	{
+		result += part;
+	}
+	
+	return result;
+}
+
+int main()
+{
+	constexpr auto size = std::ptrdiff_t(64 * 1024);
+	
+	const auto source = representative_source(size);
+	const auto comments = repeat(" \t/* a block comment with * and / */\n// a line comment /* \n", size);
+	const auto parentheses = repeat("((\"(\" + ')' /* ) */ + f(x)) * (y))\n", size) + ")";
+	const auto annotations = repeat("@a.b.C(value = {@D(\"(\"), @E}) @F\n", size);
+	const auto module = "module org.example.module\n{\n" + repeat("\trequires static transitive org.example.dependency;\n\trequires java.base;\n", size) + "}\n";
+	
+	auto patterns = std::vector<std::string_view>();
+	patterns.emplace_back("org[.]junit[.].*");
+	patterns.emplace_back("javax[.]annotation[.]Nullable");
+	patterns.emplace_back("a[.]b[.].*");
+	const auto pattern_set = Regex_set(patterns);
+	
+	auto module_patterns = std::vector<std::string_view>();
+	module_patterns.emplace_back("org[.]example[.]dependency");
+	const auto module_pattern_set = Regex_set(module_patterns);
+	
+	const auto names = Name_set {"Test", "Deprecated", "F"};
+	const auto imported_names = Imported_names {"org.junit.Before", "javax.annotation.Nullable"};
+	const auto qualified_names = repeat("java.lang.String\norg.junit.Test\nNullable\njava.util.concurrent.ConcurrentHashMap\n", 4096);
+	
+	std::cout << std::left << std::setw(28) << "function" << std::setw(22) << "input"
+		<< std::right << std::setw(10) << "bytes" << std::setw(14) << "ns/call"
+		<< std::setw(10) << "ns/byte" << std::setw(12) << "allocs/call" << "\n";
+	
+	auto scan_ignore_whitespace_comments = [](std::string_view input) -> void
+	{
+		for (auto position = std::ptrdiff_t(0); position < std::ssize(input); ++position)
+		{
+			position = ignore_whitespace_comments(input, position);
+			keep(position);
+		}
+	};
+	
+	measure("ignore_whitespace_comments", "representative", source, scan_ignore_whitespace_comments);
+	measure("ignore_whitespace_comments", "comments", comments, scan_ignore_whitespace_comments);
+	
+	auto scan_next_symbol = [](std::string_view input) -> void
+	{
+		for (auto position = std::ptrdiff_t(0); position < std::ssize(input);)
+		{
+			auto [symbol, end] = next_symbol(input, position);
+			keep(symbol);
+			position = std::max(position + 1, end);
+		}
+	};
+	
+	measure("next_symbol", "representative", source, scan_next_symbol);
+	measure("next_symbol", "annotations", annotations, scan_next_symbol);
+	
+	auto scan_find_token = [](std::string_view input) -> void
+	{
+		for (auto position = std::ptrdiff_t(0); position < std::ssize(input); ++position)
+		{
+			position = find_token(input, "@", position);
+			keep(position);
+		}
+	};
+	
+	measure("find_token(\"@\")", "representative", source, scan_find_token);
+	measure("find_token(\"@\")", "comments", comments, scan_find_token);
+	measure("find_token(\")\", stack)", "parentheses", parentheses, [](std::string_view input) -> void
+	{
+		keep(find_token(input, ")", 0, false, 0));
+	});
+	
+	auto scan_next_annotation = [](std::string_view input) -> void
+	{
+		for (auto position = std::ptrdiff_t(0); position < std::ssize(input);)
+		{
+			auto [annotation, name] = next_annotation(input, position);
+			keep(name);
+			position = std::max(position + 1, annotation.end() - input.begin());
+		}
+	};
+	
+	measure("next_annotation", "representative", source, scan_next_annotation);
+	measure("next_annotation", "annotations", annotations, scan_next_annotation);
+	
+	measure("name_matches", "qualified names", qualified_names, [&](std::string_view input) -> void
+	{
+		for (auto position = std::size_t(0); position < input.size();)
+		{
+			auto end = input.find('\n', position);
+			keep(name_matches(input.substr(position, end - position), pattern_set, names, imported_names));
+			position = end + 1;
+		}
+	});
+	
+	auto many_names_storage = std::vector<std::string>();
+	
+	for (int index = 0; index != 4096; ++index)
+	{
+		many_names_storage.push_back("Name" + std::to_string(index));
+	}
+	
+	const auto many_names = Name_set(std::vector<std::string_view>(many_names_storage.begin(), many_names_storage.end()));
+	
+	measure("name_matches", "4096 names", qualified_names, [&](std::string_view input) -> void
+	{
+		for (auto position = std::size_t(0); position < input.size();)
+		{
+			auto end = input.find('\n', position);
+			keep(name_matches(input.substr(position, end - position), pattern_set, many_names, imported_names));
+			position = end + 1;
+		}
+	});
+	
+	auto many_patterns = std::string();
+	
+	for (int index = 0; index != 40; ++index)
+	{
+		auto number = std::to_string(index);
+		many_patterns += "org[.]example" + number + "[.](api|impl)[.].*Test" + number + "\n";
+	}
+	
+	// The DFA states are built by the searches, so construction is measured
+	// both alone and followed by searches of representative names
+	auto construct_regex_set = [](std::string_view input) -> Regex_set
+	{
+		auto input_patterns = std::vector<std::string_view>();
+		
+		for (auto position = std::size_t(0); position < input.size();)
+		{
+			auto end = input.find('\n', position);
+			input_patterns.push_back(input.substr(position, end - position));
+			position = end + 1;
+		}
+		
+		return Regex_set(input_patterns);
+	};
+	
+	measure("Regex_set", "40 patterns", many_patterns, [&](std::string_view input) -> void
+	{
+		keep(construct_regex_set(input));
+	});
+	measure("Regex_set + search", "40 patterns", many_patterns, [&](std::string_view input) -> void
+	{
+		auto regex_set = construct_regex_set(input);
+		
+		for (auto position = std::size_t(0); position < qualified_names.size();)
+		{
+			auto end = qualified_names.find('\n', position);
+			keep(regex_set.search(std::string_view(qualified_names).substr(position, end - position)));
+			position = end + 1;
+		}
+	});
+	
+	measure("remove_imports", "representative", source, [&](std::string_view input) -> void
+	{
+		keep(remove_imports(input, pattern_set, names));
+	});
+	
+	measure("remove_annotations", "representative", source, [&](std::string_view input) -> void
+	{
+		keep(remove_annotations(input, pattern_set, names, imported_names));
+	});
+	measure("remove_annotations", "annotations", annotations, [&](std::string_view input) -> void
+	{
+		keep(remove_annotations(input, pattern_set, names, imported_names));
+	});
+	
+	measure("remove_jpms_requires", "module-info", module, [&](std::string_view input) -> void
+	{
+		keep(remove_jpms_requires(input, module_pattern_set));
+	});
+	
+	return 0;
+}
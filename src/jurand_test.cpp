@@ -1,7 +1,16 @@
+#include <fstream>
 #include <iostream>
+#include <regex>
 #include <sstream>
+#include <thread>
 
 #include "java_symbols.hpp"
+#include "libjurand.hpp"
+#include "ordered_output.hpp"
+#include "server.hpp"
+#include "thread_pool.hpp"
+#include "work_scheduler.hpp"
+#include "zip_archive.hpp"
 
 using namespace java_symbols;
 
@@ -11,6 +20,19 @@ static std::ostream& operator<<(std::ostream& os, const std::tuple<T1, T2>& t)
 	return os << "(" << std::get<0>(t) << ", " << std::get<1>(t) << ")";
 }
 
+template<typename T>
+static std::ostream& operator<<(std::ostream& os, const std::vector<T>& v)
+{
+	os << "[";
+	
+	for (const auto& value : v)
+	{
+		os << (&value == v.data() ? "" : ", ") << value;
+	}
+	
+	return os << "]";
+}
+
 static void assert_eq(const auto& expected, const auto& actual)
 {
 	if (expected != actual)
@@ -21,6 +43,50 @@ static void assert_eq(const auto& expected, const auto& actual)
 	}
 }
 
+static std::string joined_tokens(std::string_view content)
+{
+	auto result = std::string();
+	
+	for (const auto& token : tokenize(content))
+	{
+		if (not result.empty())
+		{
+			result += '|';
+		}
+		
+		result += token.text(content);
+	}
+	
+	return result;
+}
+
+template<std::uint8_t Mask, bool Negated>
+static void test_char_scan(std::string_view content)
+{
+	for (auto position = std::ptrdiff_t(0); position <= std::ssize(content); ++position)
+	{
+		auto expected = char_scan::find_scalar<Mask, Negated>(content.data(), position, std::ssize(content));
+		
+#ifdef JURAND_CHAR_SCAN_X86
+		assert_eq(expected, char_scan::find_sse2<Mask, Negated>(content.data(), position, std::ssize(content)));
+		
+		if (__builtin_cpu_supports("avx2"))
+		{
+			assert_eq(expected, char_scan::find_avx2<Mask, Negated>(content.data(), position, std::ssize(content)));
+		}
+#endif
+		
+		if constexpr (Negated)
+		{
+			assert_eq(expected, char_scan::find_not<Mask>(content, position));
+		}
+		else
+		{
+			assert_eq(expected, char_scan::find_any<Mask>(content, position));
+		}
+	}
+}
+
 int main()
 {
 	std::cout << "Running tests..." << "\n";
@@ -37,6 +103,52 @@ int main()
 	assert_eq(5, ignore_whitespace_comments("/**/ a", 0));
 	assert_eq(4, ignore_whitespace_comments("//a\n", 0));
 	
+	for (int c = 0; c != 256; ++c)
+	{
+		assert_eq(bool(std::isspace(c)), char_scan::is_a(char(c), char_scan::whitespace));
+		assert_eq(c == '_' or not (std::ispunct(c) or std::isspace(c)), char_scan::is_a(char(c), char_scan::identifier));
+	}
+	
+	{
+		auto content = std::string();
+		
+		for (int c = 0; c != 256; ++c)
+		{
+			content += char(c);
+			content += "  \t\n\"abc_def\\'@(/)\r\v\f";
+			content += std::string(c % 40, 'x');
+			content += std::string(c % 35, ' ');
+		}
+		
+		test_char_scan<char_scan::whitespace, true>(content);
+		test_char_scan<char_scan::identifier, true>(content);
+		test_char_scan<char_scan::quote | char_scan::backslash, false>(content);
+		test_char_scan<char_scan::slash | char_scan::at_sign | char_scan::parenthesis | char_scan::newline, false>(content);
+		test_char_scan<char_scan::identifier | char_scan::whitespace, false>(content);
+		
+		for (auto bytes : {"", "\"", "x@", "\0\xff\n(", "abcdefgh"})
+		{
+			auto set = char_scan::Byte_set(bytes);
+			
+			for (auto position = std::ptrdiff_t(0); position <= std::ssize(content); ++position)
+			{
+				auto expected = std::min(content.find_first_of(set.bytes(), position), content.size());
+				assert_eq(std::ptrdiff_t(expected), char_scan::find_any_of_scalar(set, content.data(), position, std::ssize(content)));
+				
+#ifdef JURAND_CHAR_SCAN_X86
+				assert_eq(std::ptrdiff_t(expected), char_scan::find_any_of_sse2(set, content.data(), position, std::ssize(content)));
+				
+				if (__builtin_cpu_supports("avx2"))
+				{
+					assert_eq(std::ptrdiff_t(expected), char_scan::find_any_of_avx2(set, content.data(), position, std::ssize(content)));
+				}
+#endif
+				
+				assert_eq(std::ptrdiff_t(expected), char_scan::find_any_of(set, content, position));
+			}
+		}
+	}
+	
 	assert_eq("", std::get<0>(next_symbol("")));
 	assert_eq("", std::get<0>(next_symbol(" ")));
 	assert_eq("(", std::get<0>(next_symbol("(foo")));
@@ -56,6 +168,9 @@ int main()
 	assert_eq(8, find_token("'\\uFFFE'@", "@"));
 	assert_eq(4, find_token("\"//\"@", "@"));
 	assert_eq(4, find_token("\"/*\"@", "@"));
+	assert_eq(51, find_token(R"("a string with @ and ' and \" longer than a vector"@)", "@"));
+	assert_eq(46, find_token(R"("a string ending with an escaped backslash \\"@)", "@"));
+	assert_eq(38, find_token("\"\"\"\n\ta text block with @ and \\\"\"\" \n\"\"\"@", "@"));
 	
 	assert_eq(2, find_token("())", ")"));
 	assert_eq(1, find_token("()", ")", 1));
@@ -94,6 +209,204 @@ int main()
 	assert_eq(0, find_token("import/", "import", 0, true));
 	assert_eq(0, find_token("import+", "import", 0, true));
 	
+	assert_eq("", joined_tokens(" /* a */ // b\n"));
+	assert_eq("import|a|.|b|;", joined_tokens("import a . /**/b;"));
+	assert_eq("@|A|(|\")\"|)", joined_tokens("@A(\")\")"));
+	assert_eq(R"(x|'\''|y)", joined_tokens(R"(x'\''y)"));
+	assert_eq(R"("\\"|@)", joined_tokens(R"("\\"@)"));
+	assert_eq(R"("\"")", joined_tokens(R"("\"")"));
+	assert_eq("\"a", joined_tokens("\"a"));
+	assert_eq("č|;", joined_tokens("č;"));
+	
+	assert_eq("annotations", required_literal("org[.]jspecify[.]annotations").value_or("-"));
+	assert_eq("Nullable", required_literal("^Nullable$").value_or("-"));
+	assert_eq("ab", required_literal("abc?d*").value_or("-"));
+	assert_eq("abc", required_literal("x+abc+").value_or("-"));
+	assert_eq("java", required_literal("java(x|y)[.]").value_or("-"));
+	assert_eq("-", required_literal("a|b").value_or("-"));
+	assert_eq("-", required_literal("x*").value_or("-"));
+	assert_eq("-", required_literal("[ab]").value_or("-"));
+	assert_eq("c", required_literal("a{2}[^b][[:alpha:]]c").value_or("-"));
+	
+	{
+		auto literals = std::vector<std::string>{"he", "she", "his", "hers"};
+		auto filter = Literal_filter(literals);
+		assert_eq(true, filter.matches("ushers"));
+		assert_eq(true, filter.matches("xxhis"));
+		assert_eq(false, filter.matches("hxsxhi"));
+		assert_eq(false, filter.matches(""));
+		assert_eq(false, Literal_filter().matches("a"));
+		
+		literals = {"Nullable"};
+		assert_eq(true, Literal_filter(literals).matches("import a.Nullable;"));
+		assert_eq(false, Literal_filter(literals).matches("import a.Nullabl;"));
+		
+		literals = {""};
+		assert_eq(true, Literal_filter(literals).matches(""));
+		
+		// Too many first bytes to skip to
+		literals = {"a1", "b2", "c3", "d4", "e5", "f6", "g7", "h8", "i9"};
+		assert_eq(true, Literal_filter(literals).matches("xxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxxi9"));
+		assert_eq(false, Literal_filter(literals).matches("a2b3c4d5e6f7g8h9i1xxxxxxxxxxxxxxxxxxxxx"));
+		
+		literals = {"Nullable", "NonNull", "jspecify", "@Deprecated"};
+		auto long_content = std::string(1000, 'x') + "Nul" + std::string(100, 'y') + "NonNul";
+		assert_eq(false, Literal_filter(literals).matches(long_content));
+		assert_eq(true, Literal_filter(literals).matches(long_content + "l"));
+		assert_eq(true, Literal_filter(literals).matches(std::string(77, ' ') + "@@Deprecated"));
+	}
+	
+	{
+		auto patterns = std::vector<std::string_view>{"a[.]A", "^Nullable$", "(ab|c)+d", "x{2,3}y", "[^[:alnum:]]", "^$", "a.c", "[]a]"};
+		auto regex_set = Regex_set(patterns);
+		
+		for (std::string_view text : {"", "a.A", "ab.A", "Nullable", "Nullable.", "abcabd", "cd", "ad", "xy", "xxy", "xxxxy",
+			"a_b", "Ab1", "abc", "a\nc", "]"})
+		{
+			auto matched = Bitset(regex_set.size());
+			assert_eq(regex_set.search(text), regex_set.search(text, matched));
+			
+			for (std::ptrdiff_t i = 0; i != std::ssize(patterns); ++i)
+			{
+				auto expected = std::regex_search(text.begin(), text.end(), std::regex(patterns[i].begin(), patterns[i].end(), std::regex_constants::extended));
+				assert_eq(expected, matched.test(i));
+			}
+		}
+		
+		assert_eq(false, Regex_set().search("a"));
+		assert_eq(true, Regex_set({"(a|b)*c{100}"}).search(std::string(100, 'c')));
+		assert_eq(false, Regex_set({"(a|b)*c{100}"}).search(std::string(99, 'c')));
+		assert_eq(true, Regex_set({"(a|b)*a(a|b){12}$"}).search("xba" + std::string(12, 'b')));
+		assert_eq(false, Regex_set({"(a|b)*a(a|b){12}$"}).search("xba" + std::string(13, 'b')));
+		assert_eq(true, Regex_set({"$^"}).search(""));
+		assert_eq(true, Regex_set({"^a\\.b\\(\\)\\\\$"}).search("a.b()\\"));
+		assert_eq(false, Regex_set({"^a\\.b"}).search("axb"));
+		
+		// More DFA states than the limit are reached, concurrently and by copies
+		auto large = Regex_set({"(a|b)*a(a|b){12}$", "b{14}$"});
+		auto random = std::string();
+		
+		for (std::uint32_t value = 1; random.size() != 40000; value = value * 1103515245 + 12345)
+		{
+			random += (value >> 16) % 2 ? 'a' : 'b';
+		}
+		
+		random += 'a';
+		
+		auto check = [&](const Regex_set& regex_set) -> void
+		{
+			for (int i = 0; i != 3; ++i)
+			{
+				auto matched = Bitset(2);
+				assert_eq(true, regex_set.search(random + "a" + std::string(12, 'b'), matched));
+				assert_eq(true, matched.test(0));
+				assert_eq(false, regex_set.search(random + std::string(13, 'b')));
+				matched = Bitset(2);
+				assert_eq(true, regex_set.search(random + std::string(14, 'b'), matched));
+				assert_eq(false, matched.test(0));
+				assert_eq(true, matched.test(1));
+			}
+		};
+		
+		auto threads = std::vector<std::thread>();
+		
+		for (int i = 0; i != 4; ++i)
+		{
+			threads.emplace_back([&]() -> void {check(large);});
+		}
+		
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		
+		check(Regex_set(large));
+		
+		// Construction does not depend on the number of DFA states of the patterns
+		auto many_patterns_storage = std::vector<std::string>();
+		
+		for (int index = 0; index != 500; ++index)
+		{
+			auto number = std::to_string(index);
+			many_patterns_storage.push_back("org[.]example" + number + "[.](api|impl)[.].*Test" + number);
+		}
+		
+		auto start = std::chrono::steady_clock::now();
+		auto many_patterns = Regex_set(std::vector<std::string_view>(many_patterns_storage.begin(), many_patterns_storage.end()));
+		assert_eq(true, std::chrono::steady_clock::now() - start < std::chrono::seconds(1));
+		auto matched = Bitset(many_patterns.size());
+		assert_eq(true, many_patterns.search("org.example123.impl.FooTest123", matched));
+		assert_eq(123, matched.find_first());
+		assert_eq(false, many_patterns.search("org.example123.impl.FooTest124"));
+		
+		auto cache = Match_cache(regex_set);
+		assert_eq(0, cache.find_first("a.A"));
+		assert_eq(0, cache.find_first("a.A"));
+		assert_eq(4, cache.find_first("a-"));
+		assert_eq(-1, cache.find_first("A"));
+		assert_eq(-1, cache.find_first("A"));
+	}
+	
+	{
+		auto parameters = Parameters();
+		parameters.names_ = {"A", "B", "C"};
+		parameters.patterns_ = Regex_set({"p", "q", "p"});
+		auto origins = std::vector<std::string_view>{"y", "x", "y"};
+		auto strict = Strict_mode(origins, parameters);
+		
+		strict.mark_name(1);
+		strict.mark_pattern(0);
+		strict.mark_origin(0);
+		std::thread([&]() noexcept -> void {strict.mark_name(2);}).join();
+		
+		assert_eq(std::vector<std::string_view>{"x"}, strict.unchanged_origins());
+		assert_eq(std::vector<std::string_view>{"A"}, strict.unmatched_names());
+		assert_eq(std::vector<std::string_view>{"q"}, strict.unmatched_patterns());
+		assert_eq(false, strict.any_annotation_removed());
+		
+		// A thread alternating between strict modes keeps its record and capture in each
+		auto other = Strict_mode({}, parameters);
+		auto matches = strict.new_record();
+		strict.begin_capture(matches);
+		
+		for (int i = 0; i != 1000; ++i)
+		{
+			other.mark_name(0);
+			strict.mark_name(2);
+		}
+		
+		strict.end_capture();
+		assert_eq(true, matches.names_.test(2));
+		assert_eq(false, matches.names_.test(0));
+		assert_eq(std::vector<std::string_view>{"B", "C"}, other.unmatched_names());
+		
+		// A strict mode reusing the slot of a destroyed one does not see its record
+		for (int i = 0; i != 3; ++i)
+		{
+			auto job = Strict_mode({}, parameters);
+			assert_eq(std::vector<std::string_view>{"A", "B", "C"}, job.unmatched_names());
+			job.mark_name(i);
+			strict.mark_name(0);
+			assert_eq(std::ssize(parameters.names_) - 1, std::ssize(job.unmatched_names()));
+		}
+		
+		for (std::string_view pattern : {"(a", "a)", "*a", "a{2,1}", "[a", "[[:foo:]]", "a\\", "a[.]\\d", "\\w", "\\s"})
+		{
+			bool thrown = false;
+			
+			try
+			{
+				auto invalid = Regex_set({pattern});
+			}
+			catch (std::invalid_argument&)
+			{
+				thrown = true;
+			}
+			
+			assert_eq(true, thrown);
+		}
+	}
+	
 	assert_eq(next_annotation_t("@A", "A"), next_annotation("@A"));
 	assert_eq(next_annotation_t("@A", "A"), next_annotation("@A\n"));
 	assert_eq(next_annotation_t("@A()", "A"), next_annotation("@A()"));
@@ -117,6 +430,64 @@ int main()
 	
 	assert_eq(next_annotation_t("@A(value = /* ) */ \")\")", "A"), next_annotation("@A(value = /* ) */ \")\")//)"));
 	
+	{
+		// Names are copied only if they contain whitespace or comments
+		assert_eq(false, std::get<1>(next_annotation("@a.b.C")).is_normalized());
+		assert_eq(true, std::get<1>(next_annotation("@a/**/.B")).is_normalized());
+		
+		auto content = std::string_view("import a . b/**/.C;");
+		auto tokens = tokenize(content);
+		auto name = std::get<0>(*concatenate_until_semicolon(content, tokens, 1));
+		assert_eq(std::string_view("a.b.C"), name.view());
+		assert_eq(true, name.is_normalized());
+		
+		auto imported_names = Imported_names {"a.b.C", "d.C", "e.D", "F"};
+		assert_eq(std::string_view("a.b.C"), *imported_names.find("C"));
+		assert_eq(std::string_view("e.D"), *imported_names.find("D"));
+		assert_eq(std::string_view("F"), *imported_names.find(""));
+		assert_eq(false, imported_names.find("E").has_value());
+		
+		// Names in the source are views of it, normalized names are copied
+		auto source = std::string_view("import x.Y;\nimport z . W;\n");
+		auto source_tokens = tokenize(source);
+		imported_names = Imported_names(source);
+		imported_names.add(std::get<0>(*concatenate_until_semicolon(source, source_tokens, 1)));
+		imported_names.add(std::get<0>(*concatenate_until_semicolon(source, source_tokens, 6)));
+		imported_names.add(Qualified_name(source.substr(7, 3)));
+		assert_eq(source.data() + 7, imported_names.find("Y")->data());
+		assert_eq(std::string_view("z.W"), *imported_names.find("W"));
+	}
+	
+	{
+		// Indices follow the sorted order, duplicates are dropped
+		auto names = Name_set {"Test", "A", "", "Test", "Deprecated"};
+		assert_eq(std::ptrdiff_t(4), names.size());
+		assert_eq(std::ptrdiff_t(0), names.find(""));
+		assert_eq(std::ptrdiff_t(1), names.find("A"));
+		assert_eq(std::ptrdiff_t(3), names.find("Test"));
+		assert_eq(std::ptrdiff_t(-1), names.find("Tset"));
+		assert_eq(std::ptrdiff_t(-1), names.find("B"));
+		assert_eq(std::ptrdiff_t(-1), names.find("Tests"));
+		assert_eq(false, Name_set().contains(""));
+		
+		auto storage = std::vector<std::string>();
+		
+		for (int index = 0; index != 3000; ++index)
+		{
+			storage.push_back("Name" + std::to_string(index * 7));
+		}
+		
+		auto views = std::vector<std::string_view>(storage.begin(), storage.end());
+		names = Name_set(views);
+		std::ranges::sort(views);
+		
+		for (std::ptrdiff_t index = 0; index != std::ssize(views); ++index)
+		{
+			assert_eq(index, names.find(views[index]));
+			assert_eq(false, names.contains(std::string(views[index]) + "1"));
+		}
+	}
+	
 	{
 		constexpr std::string_view original_content = R"(
 import java.lang.Runnable;
@@ -125,7 +496,7 @@ import static java.util.*;
 import static java.lang.String.valueOf;
 import com.google.common.util.concurrent.Service;)";
 		
-		auto args = std::vector<Named_regex>();
+		auto args = std::vector<std::string_view>();
 		
 		args.emplace_back("Runnable");
 
@@ -133,7 +504,7 @@ import com.google.common.util.concurrent.Service;)";
 import java.util.List;
 import static java.util.*;
 import static java.lang.String.valueOf;
-import com.google.common.util.concurrent.Service;)", std::get<0>(remove_imports(original_content, args, {})));
+import com.google.common.util.concurrent.Service;)", std::get<0>(remove_imports(original_content, Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("[*]");
@@ -142,106 +513,131 @@ import com.google.common.util.concurrent.Service;)", std::get<0>(remove_imports(
 import java.lang.Runnable;
 import java.util.List;
 import static java.lang.String.valueOf;
-import com.google.common.util.concurrent.Service;)", std::get<0>(remove_imports(original_content, args, {})));
+import com.google.common.util.concurrent.Service;)", std::get<0>(remove_imports(original_content, Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("java[.]util");
 		assert_eq(R"(
 import java.lang.Runnable;
 import static java.lang.String.valueOf;
-import com.google.common.util.concurrent.Service;)", std::get<0>(remove_imports(original_content, args, {})));
+import com.google.common.util.concurrent.Service;)", std::get<0>(remove_imports(original_content, Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("util");
 		assert_eq(R"(
 import java.lang.Runnable;
 import static java.lang.String.valueOf;
-)", std::get<0>(remove_imports(original_content, args, {})));
+)", std::get<0>(remove_imports(original_content, Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("java");
 		assert_eq(R"(
-import com.google.common.util.concurrent.Service;)", std::get<0>(remove_imports(original_content, args, {})));
+import com.google.common.util.concurrent.Service;)", std::get<0>(remove_imports(original_content, Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("static");
-		assert_eq(original_content, std::get<0>(remove_imports(original_content, args, {})));
+		assert_eq(original_content, std::get<0>(remove_imports(original_content, Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("A");
-		assert_eq("", std::get<0>(remove_imports("import A ;", args, {})));
+		assert_eq("", std::get<0>(remove_imports("import A ;", Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("A");
-		assert_eq(" ", std::get<0>(remove_imports("import A ; ", args, {})));
+		assert_eq(" ", std::get<0>(remove_imports("import A ; ", Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("A");
-		assert_eq("", std::get<0>(remove_imports("import/**/A;", args, {})));
+		assert_eq("", std::get<0>(remove_imports("import/**/A;", Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("A");
-		assert_eq("/**/", std::get<0>(remove_imports("import/**/A/**/;/**/", args, {})));
+		assert_eq("/**/", std::get<0>(remove_imports("import/**/A/**/;/**/", Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("A");
-		assert_eq("", std::get<0>(remove_imports("import//\nA;", args, {})));
+		assert_eq("", std::get<0>(remove_imports("import//\nA;", Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("A[.]C");
-		assert_eq("", std::get<0>(remove_imports("import A./*B;*/C;", args, {})));
+		assert_eq("", std::get<0>(remove_imports("import A./*B;*/C;", Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("A");
-		assert_eq("", std::get<0>(remove_imports("import static A;", args, {})));
+		assert_eq("", std::get<0>(remove_imports("import static A;", Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("A");
-		assert_eq("", std::get<0>(remove_imports("import static a . b /**/ . A;", args, {})));
+		assert_eq("", std::get<0>(remove_imports("import static a . b /**/ . A;", Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("static");
-		assert_eq("", std::get<0>(remove_imports("import xstatic .A;", args, {})));
+		assert_eq("", std::get<0>(remove_imports("import xstatic .A;", Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("static");
-		assert_eq("", std::get<0>(remove_imports("import staticx.A;", args, {})));
+		assert_eq("", std::get<0>(remove_imports("import staticx.A;", Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("A");
-		assert_eq("", std::get<0>(remove_imports("import static/**/A;", args, {})));
+		assert_eq("", std::get<0>(remove_imports("import static/**/A;", Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("A");
-		assert_eq("", std::get<0>(remove_imports("import/**/static/**/A;", args, {})));
+		assert_eq("", std::get<0>(remove_imports("import/**/static/**/A;", Regex_set(args), {})));
 		args.clear();
 		
 		args.emplace_back("A");
-		assert_eq("import/* A */B;", std::get<0>(remove_imports("import/* A */B;", args, {})));
+		assert_eq("import/* A */B;", std::get<0>(remove_imports("import/* A */B;", Regex_set(args), {})));
 		args.clear();
+		
+		args.emplace_back("A");
+		assert_eq("class B {}\nimport A;", std::get<0>(remove_imports("import A;\nclass B {}\nimport A;", Regex_set(args), {}, true)));
+		assert_eq("package a.record;\n", std::get<0>(remove_imports("package a.record;\nimport A;\n", Regex_set(args), {}, true)));
+		assert_eq("@B(C.class)\n", std::get<0>(remove_imports("@B(C.class)\nimport A;\n", Regex_set(args), {}, true)));
+		assert_eq("@B(record = 1)\n", std::get<0>(remove_imports("@B(record = 1)\nimport A;\n", Regex_set(args), {}, true)));
+		assert_eq("import record.Foo;\nimport static a.record.X;\nrecord B() {}\nimport A;",
+			std::get<0>(remove_imports("import record.Foo;\nimport A;\nimport static a.record.X;\nrecord B() {}\nimport A;", Regex_set(args), {}, true)));
+		args.clear();
+	}
+	
+	{
+		auto content = std::string_view("import record.Foo;\n@A(record = 1)\npublic record R() {}");
+		auto tokens = tokenize(content);
+		auto declarations = std::vector<std::string_view>();
+		
+		for (std::ptrdiff_t index = 0; index != std::ssize(tokens); ++index)
+		{
+			if (is_type_declaration(content, tokens, index))
+			{
+				declarations.push_back(content.substr(tokens[index].offset_));
+			}
+		}
+		
+		assert_eq(std::vector<std::string_view>{"record R() {}"}, declarations);
 	}
 	
 	{
-		auto patterns = std::vector<Named_regex>();
+		auto patterns = std::vector<std::string_view>();
 		
 		patterns.emplace_back("Nullable");
-		assert_eq("new Object[initialCapacity];", remove_annotations("new @Nullable Object[initialCapacity];", patterns, {}, {}));
+		assert_eq("new Object[initialCapacity];", remove_annotations("new @Nullable Object[initialCapacity];", Regex_set(patterns), {}, {}));
 		patterns.clear();
 		
 		patterns.emplace_back("A");
-		assert_eq("//)", remove_annotations("@A(value = /* ) */ \")\")//)", patterns, {}, {}));
+		assert_eq("//)", remove_annotations("@A(value = /* ) */ \")\")//)", Regex_set(patterns), {}, {}));
 		patterns.clear();
 		
 		patterns.emplace_back("A");
 		assert_eq("\nclass C {}", remove_annotations(R"(
 @A
-class C {})", patterns, {}, {}));
+class C {})", Regex_set(patterns), {}, {}));
 		patterns.clear();
 	
 		patterns.emplace_back("A");
 		assert_eq("\n	class C {}", remove_annotations(R"(
 	@A
-	class C {})", patterns, {}, {}));
+	class C {})", Regex_set(patterns), {}, {}));
 		patterns.clear();
 		
 		constexpr std::string_view original_content = R"(
@@ -254,56 +650,953 @@ class C {})", patterns, {}, {}));
 		assert_eq(R"(
 @SuppressFBWarnings(value = {"EI_EXPOSE_REP", "EI_EXPOSE_REP2"})
 @org.junit.Test
-@org.junit.jupiter.api.Test)", remove_annotations(original_content, patterns, {}, {}));
+@org.junit.jupiter.api.Test)", remove_annotations(original_content, Regex_set(patterns), {}, {}));
 		patterns.clear();
 		
 		patterns.emplace_back("Suppress");
 		assert_eq(R"(
 @org.junit.Test
-@org.junit.jupiter.api.Test)", remove_annotations(original_content, patterns, {}, {}));
+@org.junit.jupiter.api.Test)", remove_annotations(original_content, Regex_set(patterns), {}, {}));
 		patterns.clear();
 		
 		patterns.emplace_back("org[.]junit[.]Test");
 		assert_eq(R"(
 @SuppressWarnings
 @SuppressFBWarnings(value = {"EI_EXPOSE_REP", "EI_EXPOSE_REP2"})
-@org.junit.jupiter.api.Test)", remove_annotations(original_content, patterns, {}, {}));
+@org.junit.jupiter.api.Test)", remove_annotations(original_content, Regex_set(patterns), {}, {}));
 		patterns.clear();
 		
 		patterns.emplace_back("Test");
 		assert_eq(R"(
 @SuppressWarnings
 @SuppressFBWarnings(value = {"EI_EXPOSE_REP", "EI_EXPOSE_REP2"})
-)", remove_annotations(original_content, patterns, {}, {}));
+)", remove_annotations(original_content, Regex_set(patterns), {}, {}));
 		patterns.clear();
 		
 		patterns.emplace_back("@SuppressWarnings");
-		assert_eq(original_content, remove_annotations(original_content, patterns, {}, {}));
+		assert_eq(original_content, remove_annotations(original_content, Regex_set(patterns), {}, {}));
 		patterns.clear();
 		
 		patterns.emplace_back("EI_EXPOSE_REP");
-		assert_eq(original_content, remove_annotations(original_content, patterns, {}, {}));
+		assert_eq(original_content, remove_annotations(original_content, Regex_set(patterns), {}, {}));
 		patterns.clear();
 		
 		patterns.emplace_back("A");
-		assert_eq("@a/*A*/.B", remove_annotations("@a/*A*/.B", patterns, {}, {}));
+		assert_eq("@a/*A*/.B", remove_annotations("@a/*A*/.B", Regex_set(patterns), {}, {}));
 		patterns.clear();
 		
 		patterns.emplace_back("B");
-		assert_eq("", remove_annotations("@a/*A*/.B", patterns, {}, {}));
+		assert_eq("", remove_annotations("@a/*A*/.B", Regex_set(patterns), {}, {}));
 		patterns.clear();
 		
 		patterns.emplace_back("A");
-		assert_eq("", remove_annotations("@ A", patterns, {}, {}));
+		assert_eq("", remove_annotations("@ A", Regex_set(patterns), {}, {}));
 		patterns.clear();
 		
 		patterns.emplace_back("A");
-		assert_eq("", remove_annotations("@//\nA", patterns, {}, {}));
+		assert_eq("", remove_annotations("@//\nA", Regex_set(patterns), {}, {}));
 		patterns.clear();
 		
 		patterns.emplace_back("B");
-		assert_eq("@A/*(B)*/", remove_annotations("@A/*(B)*/", patterns, {}, {}));
+		assert_eq("@A/*(B)*/", remove_annotations("@A/*(B)*/", Regex_set(patterns), {}, {}));
+		patterns.clear();
+	}
+	
+	{
+		using remove_imports_annotations_t = std::tuple<std::string, bool>;
+		
+		auto patterns = std::vector<std::string_view>();
+		
+		patterns.emplace_back("a[.]A");
+		assert_eq(remove_imports_annotations_t("package p;\nclass C {}", true),
+			remove_imports_annotations("@A\npackage p;\nimport a.A;\nclass C {}", Regex_set(patterns), {}));
+		assert_eq(remove_imports_annotations_t("class C {}", true),
+			remove_imports_annotations("@A\nimport a.A;\nclass C {}", Regex_set(patterns), {}));
+		assert_eq(remove_imports_annotations_t("class C {}", false),
+			remove_imports_annotations("import a.A;\nclass C {}", Regex_set(patterns), {}));
+		assert_eq(remove_imports_annotations_t("@interface A {}", false),
+			remove_imports_annotations("@interface A {}", Regex_set(patterns), {}));
 		patterns.clear();
+		
+		assert_eq(remove_imports_annotations_t("class C {\n\tvoid f(Object o) {}\n}", true),
+			remove_imports_annotations("import a.A;\n@A\nclass C {\n\tvoid f(@A Object o) {}\n}", Regex_set(patterns), {"A"}));
+	}
+	
+	{
+		using split_points_t = std::vector<std::ptrdiff_t>;
+		
+		assert_eq(split_points_t {2, 4}, find_split_points("{\n}\n;\n", 1));
+		assert_eq(split_points_t {4}, find_split_points("{\n}\n;\n", 3));
+		assert_eq(split_points_t {}, find_split_points("a\n(\n;\n)", 1));
+		assert_eq(split_points_t {}, find_split_points("\"\n;\n\"", 1));
+		assert_eq(split_points_t {}, find_split_points("/*;\n;\n*/", 1));
+		assert_eq(split_points_t {}, find_split_points("// ;\n@A\n", 1));
+		assert_eq(split_points_t {6}, find_split_points("';'\n;\nx", 1));
+		assert_eq(split_points_t {}, find_split_points(");\n;\n", 1));
+	}
+	
+	{
+		auto patterns = std::vector<std::string_view>();
+		patterns.emplace_back("a[.]A");
+		auto names = Name_set {"B"};
+		
+		auto contents = std::vector<std::string>();
+		contents.emplace_back("package p;\nimport a.A;\n@A\nclass C {\n@A\nint x;\n@B(\"(\")\nvoid f() {\n}\n@A @B\nint y;\n}\n");
+		contents.emplace_back("import a.A;\nclass C {\nint x = \"{\\\"\n@A\";\n/* ;\n@A */\n@A\nint y;\n}\n");
+		contents.emplace_back("class C {\n@A\nint x;\nimport a.A;\n@A\nint y;\n}\n");
+		contents.emplace_back("class C {\n@A\nint x;\n@B(\nint y;\n@B\nint z;\n}\n");
+		contents.emplace_back("@A\nclass C {\n@B\n;\n'\\''\n@B\n}\n");
+		contents.emplace_back("class C {\n}\n");
+		contents.emplace_back("");
+		
+		for (const auto& content : contents)
+		{
+			for (std::ptrdiff_t part_count = 1; part_count <= std::ssize(content); ++part_count)
+			{
+				assert_eq(std::get<0>(remove_imports_annotations(content, Regex_set(patterns), names)).str(),
+					std::get<0>(remove_imports_annotations_parallel(content, Regex_set(patterns), names, part_count)).str());
+				assert_eq(std::get<1>(remove_imports_annotations(content, Regex_set(patterns), names)),
+					std::get<1>(remove_imports_annotations_parallel(content, Regex_set(patterns), names, part_count)));
+			}
+		}
+	}
+	
+	{
+		// The matches of all parts are captured by the calling thread
+		auto origins = std::vector<std::string_view> {"a"};
+		auto parameters = interpret_args({{"-n", {"B"}}, {"-p", {"a[.]A", "z"}}});
+		auto strict_mode = Strict_mode(origins, parameters);
+		auto context = Context();
+		context.strict_mode_ = &strict_mode;
+		auto matches = strict_mode.new_record();
+		strict_mode.begin_capture(matches);
+		auto [content, annotation_removed] = remove_imports_annotations_parallel("import a.A;\nclass C {\n@A\nint x;\n}\n;\n;\n;\n@B\nint y;\n", Regex_set(std::vector<std::string_view> {"a[.]A", "z"}), {"B"}, 4, context);
+		strict_mode.end_capture();
+		
+		assert_eq(true, matches.names_.test(0));
+		assert_eq(true, matches.patterns_.test(0));
+		assert_eq(false, matches.patterns_.test(1));
+		assert_eq("class C {\nint x;\n}\n;\n;\n;\nint y;\n", content.str());
+		assert_eq(true, annotation_removed);
+	}
+	
+	{
+		// The parts which fall back or whose annotations are not removed do not mark or count matches
+		auto parameters = interpret_args({{"-n", {"B"}}, {"-p", {"a[.]A", "z"}}});
+		
+		auto contents = std::vector<std::string>();
+		contents.emplace_back("import a.A;\nimport b.B;\n;\n;\n;\nclass C {\n@A\nint x;\n}\n");
+		contents.emplace_back("class C {\n@A\nint x;\n}\n;\n;\nimport a.A;\n@B\nint y;\n");
+		contents.emplace_back("class C {\n@a.A\nint x;\n@\n;\n;\n@B\nint y;\n@z\nint w;\n}\n");
+		
+		for (const auto& content : contents)
+		{
+			for (std::ptrdiff_t part_count = 1; part_count <= std::ssize(content); ++part_count)
+			{
+				auto serial_strict = Strict_mode({}, parameters);
+				auto serial_statistics = Statistics(parameters);
+				auto parallel_strict = Strict_mode({}, parameters);
+				auto parallel_statistics = Statistics(parameters);
+				
+				auto serial_context = Context();
+				serial_context.strict_mode_ = &serial_strict;
+				serial_context.hits_ = &serial_statistics;
+				auto parallel_context = Context();
+				parallel_context.strict_mode_ = &parallel_strict;
+				parallel_context.hits_ = &parallel_statistics;
+				
+				remove_imports_annotations(content, parameters.patterns_, parameters.names_, serial_context);
+				remove_imports_annotations_parallel(content, parameters.patterns_, parameters.names_, part_count, parallel_context);
+				
+				assert_eq(serial_strict.unmatched_names(), parallel_strict.unmatched_names());
+				assert_eq(serial_strict.unmatched_patterns(), parallel_strict.unmatched_patterns());
+				assert_eq(serial_statistics.merged().name_hits_, parallel_statistics.merged().name_hits_);
+				assert_eq(serial_statistics.merged().pattern_hits_, parallel_statistics.merged().pattern_hits_);
+			}
+		}
+	}
+	
+	{
+		auto path = std::filesystem::temp_directory_path() / "jurand_test_file_content.java";
+		auto buffer = std::string();
+		
+		for (auto size : {std::ptrdiff_t(0), std::ptrdiff_t(10), std::ptrdiff_t(5000), File_content::mapping_threshold})
+		{
+			auto expected = std::string(size, 'x');
+			std::ofstream(path) << expected;
+			auto file_content = File_content(path, buffer);
+			assert_eq(expected, file_content.view());
+			assert_eq(size >= File_content::mapping_threshold, file_content.is_mapped());
+		}
+		
+		std::filesystem::remove(path);
+	}
+	
+	{
+		constexpr std::string_view original = "import a.A;\nimport b.B;\nclass C {}\n";
+		
+		auto unchanged = Edited_content(original);
+		assert_eq(false, unchanged.changed());
+		assert_eq(std::ssize(original), unchanged.first_removed());
+		assert_eq(original, unchanged);
+		
+		auto edited = Edited_content(original);
+		edited.keep(0, 12);
+		edited.keep(12, 12);
+		edited.keep(24, std::ssize(original));
+		assert_eq(true, edited.changed());
+		assert_eq(std::ptrdiff_t(2), std::ssize(edited.spans()));
+		assert_eq(std::ptrdiff_t(12), edited.first_removed());
+		assert_eq("import a.A;\nclass C {}\n", edited.str());
+		
+		auto path = std::filesystem::temp_directory_path() / "jurand_test_edited_content.java";
+		
+		for (bool is_mapped : {false, true})
+		{
+			std::ofstream(path) << original;
+			int fd = ::open(path.c_str(), O_WRONLY);
+			edited.write_in_place(fd, is_mapped);
+			::close(fd);
+			auto ifs = std::ifstream(path);
+			assert_eq("import a.A;\nclass C {}\n", std::string(std::istreambuf_iterator<char>(ifs), {}));
+		}
+		
+		std::filesystem::remove(path);
+	}
+	
+	{
+		// Every task n > 0 pushes the tasks 2n and 2n + 1 up to a limit
+		using Scheduler = Work_scheduler<int>;
+		constexpr int limit = 2000;
+		auto scheduler = Scheduler(4);
+		auto handled = std::vector<std::atomic<int>>(limit);
+		
+		scheduler.push(0, {Scheduler::Chunk(1, {1})});
+		auto threads = std::vector<std::thread>();
+		
+		for (std::ptrdiff_t worker = 0; worker != scheduler.worker_count(); ++worker)
+		{
+			threads.emplace_back([&, worker]() noexcept -> void
+			{
+				while (auto chunk = scheduler.pop(worker))
+				{
+					auto chunks = std::vector<Scheduler::Chunk>();
+					
+					for (auto task : chunk->tasks_)
+					{
+						handled[task].fetch_add(1);
+						
+						for (auto next : {2 * task, 2 * task + 1})
+						{
+							if (next < limit)
+							{
+								chunks.emplace_back(next, std::vector<int>{next});
+							}
+						}
+					}
+					
+					scheduler.push(worker, std::move(chunks));
+					scheduler.done();
+				}
+			});
+		}
+		
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		
+		for (int task = 1; task != limit; ++task)
+		{
+			assert_eq(1, handled[task].load());
+		}
+	}
+	
+	{
+		auto parameters = interpret_args({{"-n", {"B", "A"}}, {"-p", {"x"}}});
+		auto statistics = Statistics(parameters, 2);
+		
+		auto thread = std::thread([&]() -> void
+		{
+			statistics.record().worker_ = 0;
+			statistics.count_name(1);
+			statistics.add_file_time(std::chrono::milliseconds(3), 30, "c");
+			statistics.add_file_time(std::chrono::milliseconds(1), 10, "a");
+		});
+		thread.join();
+		
+		statistics.count_name(1);
+		++statistics.record().files_read_;
+		statistics.add_file_time(std::chrono::milliseconds(2), 20, "b");
+		statistics.add_file_time(std::chrono::milliseconds(4), 40, "d");
+		
+		auto merged = statistics.merged();
+		assert_eq(std::vector<std::ptrdiff_t> {0, 2}, merged.name_hits_);
+		assert_eq(std::vector<std::ptrdiff_t> {0}, merged.pattern_hits_);
+		assert_eq(1, merged.files_read_);
+		assert_eq(2, std::ssize(merged.slowest_files_));
+		assert_eq("d", merged.slowest_files_[0].path_);
+		assert_eq("c", merged.slowest_files_[1].path_);
+		assert_eq(1, std::ssize(statistics.workers()));
+		
+		// The hits of a job are added under the indices of the global matchers
+		auto job_parameters = interpret_args({{"-n", {"B"}}, {"-p", {"x", "x"}}});
+		auto job_statistics = Statistics(job_parameters, 0);
+		job_statistics.count_name(0);
+		job_statistics.count_pattern(1);
+		statistics.add_hits(job_statistics);
+		merged = statistics.merged();
+		assert_eq(std::vector<std::ptrdiff_t> {0, 3}, merged.name_hits_);
+		assert_eq(std::vector<std::ptrdiff_t> {1}, merged.pattern_hits_);
+	}
+	
+	{
+		auto directory = std::filesystem::temp_directory_path() / "jurand_test_cache";
+		std::filesystem::remove_all(directory);
+		std::filesystem::create_directories(directory);
+		
+		assert_eq(false, Content_cache::hash("abc") == Content_cache::hash("abd"));
+		assert_eq(false, Content_cache::hash("") == Content_cache::hash(std::string_view("\0", 1)));
+		assert_eq(false, Content_cache::hash(std::string(40, 'x')) == Content_cache::hash(std::string(40, 'x') + 'y'));
+		assert_eq(false, Content_cache::hash("abc") == Content_cache::hash("abc", 1));
+		assert_eq(true, Content_cache::hash("abc", 1) == Content_cache::hash("abc", 1));
+		
+		constexpr std::string_view original = "import a.A;\nclass C {}\n";
+		auto entry = Content_cache::Entry();
+		entry.size_ = std::ssize(original);
+		entry.changed_ = true;
+		entry.kept_ = Content_cache::kept_ranges(std::get<0>(remove_imports(original, Regex_set(std::vector<std::string_view> {"a[.]A"}), {})));
+		entry.matches_known_ = true;
+		entry.names_ = Bitset(2);
+		entry.names_.set(1);
+		entry.patterns_ = Bitset(1);
+		entry.hits_known_ = true;
+		entry.name_hits_ = {0, 3};
+		entry.pattern_hits_ = {12};
+		
+		auto old_state = Content_cache::File_state(1, std::ssize(original), 2);
+		auto new_state = Content_cache::File_state(std::numeric_limits<std::int64_t>::max(), std::ssize(original), 3);
+		
+		{
+			auto cache = Content_cache(directory, 1);
+			cache.insert(Content_cache::hash(original), entry);
+			cache.insert(7, Content_cache::Entry());
+			cache.insert_path("a b", old_state, Content_cache::hash(original));
+			cache.insert_path("c", new_state, 7);
+			cache.save();
+		}
+		
+		{
+			auto cache = Content_cache(directory, 1);
+			assert_eq(true, cache.find_path("a b", old_state) == Content_cache::hash(original));
+			assert_eq(false, cache.find_path("a b", new_state).has_value());
+			assert_eq(false, cache.find_path("c", new_state).has_value());
+			assert_eq(false, cache.find(7, 0, true).has_value());
+			assert_eq(true, cache.find(7, 0, false).has_value());
+			assert_eq(false, cache.find(7, 0, false, true).has_value());
+			assert_eq(false, cache.find(7, 1, false).has_value());
+			assert_eq(false, cache.find(Content_cache::hash(original), std::ssize(original) + 1, true, true).has_value());
+			
+			auto found = cache.find(Content_cache::hash(original), std::ssize(original), true, true);
+			assert_eq(true, found.has_value());
+			assert_eq(true, found->kept_ == entry.kept_);
+			assert_eq(true, found->names_ == entry.names_);
+			assert_eq(true, found->patterns_ == entry.patterns_);
+			assert_eq(true, found->name_hits_ == entry.name_hits_);
+			assert_eq(true, found->pattern_hits_ == entry.pattern_hits_);
+			assert_eq(true, found->module_pattern_hits_.empty());
+			assert_eq("class C {}\n", Content_cache::apply(*found, original)->str());
+			assert_eq(false, Content_cache::apply(*found, original.substr(1)).has_value());
+			
+			// The kept ranges must be separated by removed ranges and leave something removed
+			auto malformed = *found;
+			
+			for (auto kept : std::vector<std::vector<std::pair<std::ptrdiff_t, std::ptrdiff_t>>> {
+				{{0, 5}, {5, 10}},
+				{{0, 5}, {7, 7}},
+				{{3, 5}, {4, 10}},
+				{{0, std::ssize(original)}},
+				{{12, std::ssize(original) + 1}},
+			})
+			{
+				malformed.kept_ = kept;
+				assert_eq(false, Content_cache::apply(malformed, original).has_value());
+			}
+			
+			malformed.kept_ = {{0, 5}, {7, 10}};
+			assert_eq("impora.A", Content_cache::apply(malformed, original)->str());
+		}
+		
+		assert_eq(false, Content_cache(directory, 2).find(7, 0, false).has_value());
+		
+		std::ofstream(directory / "0000000000000001") << Content_cache::format << "\nc 7 0000 0 b b b h h h\nx\n";
+		assert_eq(false, Content_cache(directory, 1).find(7, 0, false).has_value());
+		
+		std::ofstream(directory / "0000000000000001") << Content_cache::format << "\nc 7 0001 0 b b b h1,,2 h h\n";
+		assert_eq(false, Content_cache(directory, 1).find(7, 0, false).has_value());
+		
+		std::ofstream(directory / "0000000000000001") << Content_cache::format << "\nc 7 0001 -1 b b b h1,2 h h\n";
+		assert_eq(false, Content_cache(directory, 1).find(7, -1, false).has_value());
+		
+		std::ofstream(directory / "0000000000000001") << Content_cache::format << "\nc 7 0001 0 b b b h1,2 h h\n";
+		assert_eq(true, Content_cache(directory, 1).find(7, 0, false, true)->name_hits_ == std::vector<std::ptrdiff_t> {1, 2});
+		
+		std::filesystem::remove_all(directory);
+	}
+	
+	{
+		const char* args[] = {"--stats=json", "--trace=a=b", "--trace", "c", "--stats", "d"};
+		auto parameter_dict = parse_arguments(args, {"--stats"});
+		assert_eq(std::vector<std::string_view> {"json"}, parameter_dict["--stats"]);
+		assert_eq(std::vector<std::string_view> {"a=b", "c"}, parameter_dict["--trace"]);
+		assert_eq(std::vector<std::string_view> {"d"}, parameter_dict[""]);
+	}
+	
+	{
+		auto path = std::filesystem::temp_directory_path() / "jurand_test_trace.json";
+		auto trace = Tracer();
+		auto start = std::chrono::steady_clock::now();
+		
+		auto thread = std::thread([&]() -> void
+		{
+			trace.name_thread("worker \"0\"");
+			trace.add("file", start, start + std::chrono::microseconds(5), "a\\b");
+			trace.add_async("traversal", start, start + std::chrono::microseconds(2));
+		});
+		thread.join();
+		
+		trace.add("idle", start, start + std::chrono::microseconds(1));
+		trace.write(path);
+		
+		auto stream = std::ostringstream();
+		stream << std::ifstream(path).rdbuf();
+		auto text = stream.str();
+		
+		assert_eq(true, text.starts_with("{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n"));
+		assert_eq(true, text.ends_with("\n]}\n"));
+		assert_eq(true, text.find("\"args\": {\"name\": \"worker \\\"0\\\"\"}") != std::string::npos);
+		assert_eq(true, text.find("\"args\": {\"name\": \"thread 1\"}") != std::string::npos);
+		assert_eq(true, std::regex_search(text, std::regex("\"ph\": \"X\", \"name\": \"file\", \"pid\": 1, \"tid\": 0, \"ts\": [0-9.]+, \"dur\": 5[.]000, \"args\": \\{\"path\": \"a\\\\\\\\b\"\\}")));
+		assert_eq(true, text.find("\"ph\": \"b\", \"cat\": \"traversal\"") != std::string::npos);
+		assert_eq(true, text.find("\"ph\": \"e\", \"cat\": \"traversal\"") != std::string::npos);
+		assert_eq(true, std::regex_search(text, std::regex("\"name\": \"idle\", \"pid\": 1, \"tid\": 1,")));
+		
+		std::filesystem::remove(path);
+		
+		bool thrown = false;
+		
+		try
+		{
+			trace.write(path / "nonexistent");
+		}
+		catch (std::system_error&)
+		{
+			thrown = true;
+		}
+		
+		assert_eq(true, thrown);
+	}
+	
+	{
+		constexpr std::string_view original = "abcdefghij";
+		
+		auto first = Edited_content(original);
+		first.keep(0, 2);
+		first.keep(4, 8);
+		first.keep(9, 10);
+		auto copy = first.str();
+		assert_eq("abefghj", copy);
+		
+		auto second = Edited_content(copy);
+		second.keep(1, 3);
+		second.keep(5, 7);
+		auto composed = first.then(second);
+		assert_eq(true, composed.changed());
+		assert_eq("behj", composed.str());
+		assert_eq(std::ptrdiff_t(0), composed.first_removed());
+		
+		assert_eq("abefghj", first.then(Edited_content(copy)).str());
+		
+		auto everything = Edited_content(copy);
+		everything.keep(0, 0);
+		assert_eq(true, first.then(everything).changed());
+		assert_eq("", first.then(everything).str());
+	}
+	
+	{
+		assert_eq(std::vector<std::string> {}, split_words(" \t"));
+		assert_eq(std::vector<std::string> {"-n", "A", "a b", "c'd", "e\"f"}, split_words(" -n\tA 'a b' \"c'd\" e'\"'f "));
+		
+		bool thrown = false;
+		
+		try
+		{
+			split_words("-p 'a");
+		}
+		catch (std::invalid_argument&)
+		{
+			thrown = true;
+		}
+		
+		assert_eq(true, thrown);
+		
+		assert_eq(true, path_contains(normal_path("a/b/"), normal_path("a/./b/c.java")));
+		assert_eq(false, path_contains(normal_path("a/b"), normal_path("a/bc")));
+		
+		auto jobs = read_jobs("# comment\n\n-i -n A a/b\n  \n-i -s -p 'b[.].*' -n A a b/c.java\n");
+		assert_eq(std::ptrdiff_t(2), std::ssize(jobs));
+		assert_eq(std::ptrdiff_t(3), jobs[0]->line_number_);
+		assert_eq(std::ptrdiff_t(5), jobs[1]->line_number_);
+		assert_eq(std::ptrdiff_t(1), jobs[1]->origin_of(normal_path("b/c.java")));
+		assert_eq(std::ptrdiff_t(-1), jobs[0]->origin_of(normal_path("b/c.java")));
+		
+		auto parameter_dict = jobs_parameter_dict(jobs);
+		assert_eq(std::vector<std::string_view> {"A"}, parameter_dict["-n"]);
+		assert_eq(std::vector<std::string_view> {"b[.].*"}, parameter_dict["-p"]);
+		assert_eq(std::vector<std::string_view> {"a", "b/c.java"}, parameter_dict[""]);
+		assert_eq(true, parameter_dict.contains("-s"));
+		assert_eq(false, parameter_dict.contains("-a"));
+		
+		for (std::string_view line : {"-n A a", "-i a", "-i -n A", "-i -n A --trace t a", "-i -p ( a"})
+		{
+			auto message = std::string();
+			
+			try
+			{
+				read_jobs(std::string("\n") + std::string(line));
+			}
+			catch (std::invalid_argument& ex)
+			{
+				message = ex.what();
+			}
+			
+			assert_eq(true, message.starts_with("jobs file line 2: "));
+		}
+	}
+	
+	{
+		auto pool = Thread_pool();
+		auto calls = std::vector<std::atomic<int>>(4);
+		
+		for (std::ptrdiff_t count : {2, 4, 1, 3})
+		{
+			pool.run(count, [&](std::ptrdiff_t index) -> void
+			{
+				++calls[index];
+			});
+		}
+		
+		assert_eq(std::ptrdiff_t(4), pool.size());
+		assert_eq(4, calls[0].load());
+		assert_eq(3, calls[1].load());
+		assert_eq(2, calls[2].load());
+		assert_eq(1, calls[3].load());
+	}
+	
+	{
+		auto helpers = Helper_pool(3);
+		auto calls = std::vector<std::atomic<int>>(200);
+		
+		assert_eq(std::ptrdiff_t(3), helpers.available());
+		
+		auto other = std::thread([&]() -> void
+		{
+			helpers.run(100, [&](std::ptrdiff_t index) -> void {++calls[index + 100];});
+		});
+		
+		helpers.run(100, [&](std::ptrdiff_t index) -> void {++calls[index];});
+		other.join();
+		assert_eq(true, std::ranges::all_of(calls, [](const auto& count) noexcept -> bool {return count == 1;}));
+		
+		{
+			// Parts are handled by the caller alone while all the cores are busy
+			auto busy = std::vector<std::unique_ptr<Helper_pool::Busy>>();
+			
+			for (int i = 0; i != 4; ++i)
+			{
+				busy.push_back(std::make_unique<Helper_pool::Busy>(helpers));
+			}
+			
+			assert_eq(std::ptrdiff_t(0), helpers.available());
+			auto caller = std::this_thread::get_id();
+			auto on_caller = true;
+			
+			helpers.run(50, [&](std::ptrdiff_t) -> void {on_caller = on_caller and std::this_thread::get_id() == caller;});
+			assert_eq(true, on_caller);
+		}
+		
+		auto message = std::string();
+		
+		try
+		{
+			helpers.run(10, [&](std::ptrdiff_t index) -> void
+			{
+				if (index == 7)
+				{
+					throw std::runtime_error("part 7");
+				}
+			});
+		}
+		catch (std::runtime_error& ex)
+		{
+			message = ex.what();
+		}
+		
+		assert_eq(std::string("part 7"), message);
+	}
+	
+	{
+		auto cache = Parameters_cache();
+		const Parameters* first = nullptr;
+		
+		{
+			auto pattern = std::string("a[.]b");
+			const char* args[] = {"-p", pattern.c_str(), "-n", "C", "-a", "x.java"};
+			first = &cache.find(parse_arguments(args, {"-a"}));
+			pattern = "overwritten";
+		}
+		
+		const char* args[] = {"-n", "C", "y.java", "-p", "a[.]b", "-a", "--stats"};
+		const auto& second = cache.find(parse_arguments(args, {"-a", "--stats"}));
+		assert_eq(true, first == &second);
+		assert_eq(std::string_view("a[.]b"), second.patterns_.pattern(0));
+		assert_eq(true, second.names_.contains("C"));
+		assert_eq(true, second.also_remove_annotations_);
+		
+		const char* other_args[] = {"-n", "C", "-p", "a[.]b"};
+		assert_eq(false, first == &cache.find(parse_arguments(other_args, {"-a"})));
+	}
+	
+	{
+		int sockets[2];
+		::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets);
+		const char* args[] = {"-n", "", "a b"};
+		Server_request::send(sockets[0], args);
+		Server_request::send_exit_code(sockets[1], 3);
+		
+		auto request = Server_request();
+		assert_eq(true, request.receive(sockets[1]));
+		assert_eq(std::filesystem::current_path().native(), request.directory_);
+		assert_eq(std::vector<std::string> {"-n", "", "a b"}, request.arguments_);
+		assert_eq(true, std::ranges::none_of(request.fds_, [](int fd) noexcept -> bool {return fd <= STDERR_FILENO;}));
+		assert_eq(3, Server_request::receive_exit_code(sockets[0]).value_or(-1));
+		
+		::close(sockets[0]);
+		assert_eq(false, Server_request().receive(sockets[1]));
+		::close(sockets[1]);
+		
+		// A peer which connects but does not send its request is given up on
+		::socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, sockets);
+		auto start = std::chrono::steady_clock::now();
+		assert_eq(false, Server_request().receive(sockets[1], std::chrono::milliseconds(100)));
+		assert_eq(true, std::chrono::steady_clock::now() - start >= std::chrono::milliseconds(100));
+		::close(sockets[0]);
+		::close(sockets[1]);
+	}
+	
+	{
+		auto options = Session::Options();
+		options.names_ = {"A"};
+		options.patterns_ = {"b[.]C"};
+		options.also_remove_annotations_ = true;
+		auto session = Session(std::move(options));
+		auto content = std::string_view("import a.A;\nimport b.C;\nimport d.E;\n@A @interface F {}\n@C(1) @d.E class G {}\n");
+		auto output = std::string("previous");
+		
+		assert_eq(true, session.edit(content, output));
+		assert_eq("import d.E;\n@interface F {}\n@d.E class G {}\n", output);
+		auto again = std::string();
+		assert_eq(false, session.edit(output, again));
+		assert_eq(true, session.unmatched_names().empty());
+		assert_eq(true, session.unmatched_patterns().empty());
+		assert_eq(true, session.any_annotation_removed());
+		
+		auto symbols = std::vector<std::string>();
+		
+		for (const auto& symbol : session.symbols(content))
+		{
+			symbols.push_back(std::string(symbol.kind_ == Session::Symbol_kind::annotation ? "@" : "")
+				+ symbol.name_ + (symbol.matches_ ? "+" : "-") + "=" + std::string(symbol.text_));
+		}
+		
+		assert_eq(std::vector<std::string> {"a.A+=import a.A;", "b.C+=import b.C;", "d.E-=import d.E;",
+			"@A+=@A", "@C+=@C(1)", "@d.E-=@d.E"}, symbols);
+		
+		assert_eq(true, Session(Session::Options()).symbols("class A {}").begin() == std::default_sentinel);
+	}
+	
+	{
+		// Sessions used concurrently keep their own strict mode
+		auto sessions = std::vector<Session>();
+		
+		for (auto names : {std::vector<std::string> {"A", "B"}, std::vector<std::string> {"B", "C"}})
+		{
+			auto options = Session::Options();
+			options.names_ = std::move(names);
+			sessions.emplace_back(std::move(options));
+		}
+		
+		auto threads = std::vector<std::thread>();
+		
+		for (int i = 0; i != 2; ++i)
+		{
+			threads.emplace_back([&session = sessions[i]]() -> void
+			{
+				auto output = std::string();
+				
+				for (int j = 0; j != 100; ++j)
+				{
+					session.edit("import a.A;\nimport c.C;\n", output, "A.java");
+				}
+			});
+		}
+		
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		
+		assert_eq(std::vector<std::string_view> {"B"}, sessions[0].unmatched_names());
+		assert_eq(std::vector<std::string_view> {"B"}, sessions[1].unmatched_names());
+		assert_eq(false, sessions[0].any_annotation_removed());
+		
+		// One thread alternating between the sessions
+		auto output = std::string();
+		
+		for (int j = 0; j != 1000; ++j)
+		{
+			sessions[j % 2].edit("import b.B;\n", output, "B.java");
+		}
+		
+		assert_eq(true, sessions[0].unmatched_names().empty());
+		assert_eq(true, sessions[1].unmatched_names().empty());
+		
+		auto thrown = false;
+		
+		try
+		{
+			auto options = Session::Options();
+			options.patterns_ = {"a("};
+			auto session = Session(std::move(options));
+		}
+		catch (std::invalid_argument&)
+		{
+			thrown = true;
+		}
+		
+		assert_eq(true, thrown);
+	}
+	
+	{
+		// An archive with a deflated and a stored entry
+		auto append = [](std::string& target, std::uint32_t value, int size) -> void
+		{
+			for (int i = 0; i != size; ++i)
+			{
+				target += static_cast<char>(value >> (8 * i) & 0xff);
+			}
+		};
+		
+		auto content = std::string();
+		auto directory = std::string();
+		
+		for (auto [name, text, method] : {
+			std::tuple(std::string_view("a/A.java"), std::string_view("import x.Y;\nclass A {}\n"), Zip_archive::deflated),
+			std::tuple(std::string_view("b.txt"), std::string_view("text"), Zip_archive::stored),
+		})
+		{
+			auto data = Zip_archive::compress(std::span(&text, 1), method);
+			auto offset = static_cast<std::uint32_t>(content.size());
+			
+			for (auto* target : {&content, &directory})
+			{
+				append(*target, target == &content ? 0x04034b50 : 0x02014b50, 4);
+				append(*target, 20, target == &content ? 2 : 4);
+				append(*target, 0, 2);
+				append(*target, method, 2);
+				append(*target, 0, 4);
+				append(*target, data.crc_, 4);
+				append(*target, static_cast<std::uint32_t>(data.data_.size()), 4);
+				append(*target, data.size_, 4);
+				append(*target, static_cast<std::uint32_t>(name.size()), 2);
+				append(*target, 0, 2);
+				
+				if (target == &directory)
+				{
+					// The comment, disk and attributes
+					append(*target, 0, 4);
+					append(*target, 0, 4);
+					append(*target, 0, 2);
+					append(*target, offset, 4);
+				}
+				
+				*target += name;
+			}
+			
+			content += data.data_;
+		}
+		
+		auto directory_offset = static_cast<std::uint32_t>(content.size());
+		content += directory;
+		append(content, 0x06054b50, 4);
+		append(content, 0, 4);
+		append(content, 0x00020002, 4);
+		append(content, static_cast<std::uint32_t>(directory.size()), 4);
+		append(content, directory_offset, 4);
+		append(content, 7, 2);
+		content += "comment";
+		
+		auto archive = Zip_archive(content);
+		auto buffer = std::string();
+		assert_eq(std::ptrdiff_t(2), std::ssize(archive.entries()));
+		assert_eq(std::string_view("a/A.java"), archive.entries()[0].name_);
+		assert_eq(std::string_view("comment"), archive.comment());
+		assert_eq(std::string_view("import x.Y;\nclass A {}\n"), Zip_archive::read(archive.entries()[0], buffer));
+		assert_eq(std::string_view("text"), Zip_archive::read(archive.entries()[1], buffer));
+		
+		{
+			// A size which the compressed data cannot inflate to is rejected before allocating it
+			auto oversized = content;
+			
+			for (std::size_t index = 0; index != 4; ++index)
+			{
+				oversized[directory_offset + 24 + index] = static_cast<char>(0x7ffffff0 >> (8 * index));
+			}
+			
+			auto oversized_archive = Zip_archive(oversized);
+			auto oversized_buffer = std::string();
+			bool thrown = false;
+			
+			try
+			{
+				Zip_archive::read(oversized_archive.entries()[0], oversized_buffer);
+			}
+			catch (std::runtime_error&)
+			{
+				thrown = true;
+			}
+			
+			assert_eq(true, thrown);
+			assert_eq(true, oversized_buffer.empty());
+		}
+		
+		auto spans = std::vector<std::string_view> {"class", " A {}\n"};
+		auto data = Zip_archive::compress(spans, Zip_archive::deflated);
+		auto replaced = std::vector<const Zip_archive::Data*> {&data, nullptr};
+		
+		auto path = std::filesystem::temp_directory_path() / "jurand_test_archive.zip";
+		int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+		auto size = archive.write(fd, replaced);
+		auto written = std::string(size + 1, '\0');
+		written.resize(::pread(fd, written.data(), written.size(), 0));
+		::close(fd);
+		std::filesystem::remove(path);
+		
+		auto new_archive = Zip_archive(written);
+		assert_eq(size, std::ssize(written));
+		assert_eq(std::string_view("class A {}\n"), Zip_archive::read(new_archive.entries()[0], buffer));
+		assert_eq(archive.entries()[1].local_record_, new_archive.entries()[1].local_record_);
+		assert_eq(std::string_view("comment"), new_archive.comment());
+		
+		for (auto malformed : {content.substr(0, content.size() - 1), content.substr(1), std::string(64, 'x')})
+		{
+			bool thrown = false;
+			
+			try
+			{
+				auto ignored = Zip_archive(malformed);
+			}
+			catch (std::runtime_error&)
+			{
+				thrown = true;
+			}
+			
+			assert_eq(true, thrown);
+		}
+	}
+	
+	{
+		// Files written in reverse order by several threads with a window
+		// smaller than a single output
+		auto path = std::filesystem::temp_directory_path() / "jurand_test_ordered_output";
+		int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+		auto output = Ordered_output(4, fd, 1);
+		auto roots = output.expand(output.root(), 4);
+		auto files = std::vector<Ordered_output::Slot*>();
+		auto expected = std::string("a\n");
+		files.push_back(&roots[0]);
+		
+		auto directory = output.expand(roots[1], 100);
+		
+		for (auto& slot : directory)
+		{
+			expected += std::to_string(std::ssize(files)) + "\n";
+			files.push_back(&slot);
+		}
+		
+		output.expand(roots[2], 0);
+		expected += "z\n";
+		files.push_back(&roots[3]);
+		
+		auto next = std::atomic<std::ptrdiff_t>(std::ssize(files));
+		auto threads = std::vector<std::thread>();
+		
+		for (int i = 0; i != 4; ++i)
+		{
+			threads.emplace_back([&]() -> void
+			{
+				for (auto index = next.fetch_sub(1) - 1; index >= 0; index = next.fetch_sub(1) - 1)
+				{
+					if (index == 0 or index == std::ssize(files) - 1)
+					{
+						output.write(*files[index], "", Edited_content(index == 0 ? "a\n" : "z\n"));
+					}
+					else if (index % 10 == 0)
+					{
+						auto content = std::to_string(index) + "\n";
+						output.write(*files[index], std::string_view(content).substr(0, 1), Edited_content(std::string_view(content).substr(1)));
+					}
+					else
+					{
+						auto content = "x" + std::to_string(index) + "\n";
+						auto edited = Edited_content(content);
+						edited.keep(1, std::ssize(content));
+						output.write(*files[index], "", edited);
+					}
+				}
+			});
+		}
+		
+		for (auto& thread : threads)
+		{
+			thread.join();
+		}
+		
+		output.flush();
+		auto result = std::string(expected.size() + 1, '\0');
+		result.resize(::pread(fd, result.data(), result.size(), 0));
+		::close(fd);
+		std::filesystem::remove(path);
+		
+		assert_eq(expected, result);
+	}
+	
+	{
+		auto path = std::filesystem::temp_directory_path() / "jurand_test_ordered_output";
+		int fd = ::open(path.c_str(), O_RDWR | O_CREAT | O_TRUNC | O_CLOEXEC, 0600);
+		auto output = Ordered_output(1, fd);
+		auto roots = output.expand(output.root(), 3);
+		output.write(roots[2], "c:\n", Edited_content("3"));
+		output.skip(roots[1]);
+		output.write(roots[0], "a:\n", Edited_content("1"));
+		output.flush();
+		
+		auto result = std::string(16, '\0');
+		result.resize(::pread(fd, result.data(), result.size(), 0));
+		::close(fd);
+		std::filesystem::remove(path);
+		
+		assert_eq("a:\n1c:\n3", result);
 	}
 	
 	std::cout << "[PASS] Unit tests" << "\n";
@@ -0,0 +1,304 @@
+#include <deque>
+#include <iterator>
+#include <optional>
+#include <string>
+#include <string_view>
+#include <utility>
+#include <vector>
+
+#include "java_symbols.hpp"
+#include "libjurand.hpp"
+
+namespace java_symbols
+{
+static_assert(std::input_iterator<Session::Symbol_iterator>);
+static_assert(std::sentinel_for<std::default_sentinel_t, Session::Symbol_iterator>);
+
+struct Session::Implementation
+{
+	explicit Implementation(Options&& options)
+		:
+		options_(std::move(options)),
+		parameters_(interpret_args(parameter_dict(options_))),
+		strict_mode_({}, parameters_)
+	{
+	}
+	
+	//! @return The arguments of the tool corresponding to @p options, pointing into them.
+	static Parameter_dict parameter_dict(const Options& options)
+	{
+		auto result = Parameter_dict();
+		
+		for (const auto& [flag, values] : {
+			std::pair("-n", &options.names_),
+			std::pair("-p", &options.patterns_),
+			std::pair("-m", &options.module_patterns_),
+		})
+		{
+			auto& arguments = result[flag];
+			arguments.insert(arguments.end(), values->begin(), values->end());
+		}
+		
+		if (options.also_remove_annotations_)
+		{
+			result.try_emplace("-a");
+		}
+		
+		return result;
+	}
+	
+	Options options_;
+	Parameters parameters_;
+	Strict_mode strict_mode_;
+};
+
+/*!
+ * Finds the symbols by lexing the content lazily, the tokens following an
+ * annotation which were needed to find its end are kept for the next symbol.
+ */
+struct Session::Symbol_iterator::State
+{
+	State(const Implementation& session, std::string_view content) noexcept
+		:
+		session_(session),
+		content_(content),
+		lexer_(content),
+		imported_classes_(content)
+	{
+	}
+	
+	//! Finds the next symbol, @return False if there is none.
+	bool next()
+	{
+		// Only editing records matches in the strict mode of the session
+		const auto& parameters = session_.parameters_;
+		
+		while (auto token = take())
+		{
+			tokens_.assign(1, *token);
+			
+			if (token->is_identifier(content_, "import"))
+			{
+				while (not tokens_.back().is_punctuation(content_, ';') and (token = take()))
+				{
+					tokens_.push_back(*token);
+				}
+				
+				auto declaration = parse_import(content_, tokens_, 0, parameters.patterns_, parameters.names_);
+				
+				if (not declaration)
+				{
+					return false;
+				}
+				
+				symbol_.kind_ = Symbol_kind::import_declaration;
+				symbol_.text_ = content_.substr(declaration->begin_, tokens_.back().end() - declaration->begin_);
+				symbol_.is_static_ = declaration->is_static_;
+				symbol_.matches_ = declaration->matches_;
+				symbol_.name_.assign(declaration->name_.view());
+				
+				if (declaration->matches_)
+				{
+					add_removed_class(imported_classes_, *declaration);
+				}
+				
+				return true;
+			}
+			else if (token->is_punctuation(content_, '@'))
+			{
+				read_annotation();
+				auto parsed = parse_annotation(content_, tokens_, 0);
+				
+				if (not parsed)
+				{
+					return false;
+				}
+				
+				auto& [annotation, annotation_name, next_index] = *parsed;
+				
+				for (auto index = std::ssize(tokens_) - 1; index >= next_index; --index)
+				{
+					pending_.push_front(tokens_[index]);
+				}
+				
+				if (annotation_name == "interface")
+				{
+					continue;
+				}
+				
+				symbol_.kind_ = Symbol_kind::annotation;
+				symbol_.text_ = annotation;
+				symbol_.is_static_ = false;
+				symbol_.matches_ = name_matches(annotation_name.view(), parameters.patterns_, parameters.names_, imported_classes_);
+				symbol_.name_.assign(annotation_name.view());
+				
+				return true;
+			}
+		}
+		
+		return false;
+	}
+	
+	//! Reads the tokens of the annotation starting at the `@` in tokens_ as far as parse_annotation looks.
+	void read_annotation()
+	{
+		bool expecting_dot = false;
+		
+		while (auto token = take())
+		{
+			tokens_.push_back(*token);
+			
+			if (token->is_punctuation(content_, '.') and content_.substr(token->end()).starts_with(".."))
+			{
+				return;
+			}
+			
+			if (expecting_dot and not token->is_punctuation(content_, '.'))
+			{
+				auto depth = std::ptrdiff_t(token->is_punctuation(content_, '('));
+				
+				while (depth != 0 and (token = take()))
+				{
+					tokens_.push_back(*token);
+					depth += token->is_punctuation(content_, '(');
+					depth -= token->is_punctuation(content_, ')');
+				}
+				
+				return;
+			}
+			
+			expecting_dot = not expecting_dot;
+		}
+	}
+	
+	std::optional<Token> take() noexcept
+	{
+		if (pending_.empty())
+		{
+			return lexer_.next();
+		}
+		
+		auto result = pending_.front();
+		pending_.pop_front();
+		
+		return result;
+	}
+	
+	const Implementation& session_;
+	std::string_view content_;
+	Lexer lexer_;
+	std::deque<Token> pending_;
+	std::vector<Token> tokens_;
+	Imported_names imported_classes_;
+	Symbol symbol_;
+};
+
+Session::Symbol_iterator::Symbol_iterator() noexcept = default;
+Session::Symbol_iterator::Symbol_iterator(Symbol_iterator&&) noexcept = default;
+Session::Symbol_iterator& Session::Symbol_iterator::operator=(Symbol_iterator&&) noexcept = default;
+Session::Symbol_iterator::~Symbol_iterator() = default;
+
+const Session::Symbol& Session::Symbol_iterator::operator*() const noexcept
+{
+	return state_->symbol_;
+}
+
+const Session::Symbol* Session::Symbol_iterator::operator->() const noexcept
+{
+	return &state_->symbol_;
+}
+
+Session::Symbol_iterator& Session::Symbol_iterator::operator++()
+{
+	if (not state_->next())
+	{
+		state_.reset();
+	}
+	
+	return *this;
+}
+
+void Session::Symbol_iterator::operator++(int)
+{
+	++*this;
+}
+
+bool Session::Symbol_iterator::operator==(std::default_sentinel_t) const noexcept
+{
+	return not state_;
+}
+
+Session::Symbol_iterator Session::Symbol_range::begin() const
+{
+	auto result = Symbol_iterator();
+	result.state_ = std::make_unique<Symbol_iterator::State>(*session_->implementation_, content_);
+	++result;
+	
+	return result;
+}
+
+Session::Session(Options options)
+	:
+	implementation_(std::make_unique<Implementation>(std::move(options)))
+{
+}
+
+Session::Session(Session&&) noexcept = default;
+Session& Session::operator=(Session&&) noexcept = default;
+Session::~Session() = default;
+
+bool Session::edit(std::string_view content, std::string& output, std::string_view file_name) const
+{
+	auto& implementation = *implementation_;
+	const auto& parameters = implementation.parameters_;
+	auto context = Context();
+	context.strict_mode_ = &implementation.strict_mode_;
+	const auto path = Path_origin_entry(file_name, {});
+	const auto& filter = path.filename() == "module-info.java" ? parameters.module_filter_ : parameters.filter_;
+	auto new_content = Edited_content(content);
+	
+	if (not filter or filter->matches(content))
+	{
+		new_content = handle_content(path, content, parameters, context);
+	}
+	
+	output.clear();
+	output.reserve(new_content.size());
+	
+	for (auto span : new_content.spans())
+	{
+		output += span;
+	}
+	
+	return new_content.changed();
+}
+
+Session::Symbol_range Session::symbols(std::string_view content) const noexcept
+{
+	auto result = Symbol_range();
+	result.session_ = this;
+	result.content_ = content;
+	
+	return result;
+}
+
+std::vector<std::string_view> Session::unmatched_names() const
+{
+	return implementation_->strict_mode_.unmatched_names();
+}
+
+std::vector<std::string_view> Session::unmatched_patterns() const
+{
+	return implementation_->strict_mode_.unmatched_patterns();
+}
+
+std::vector<std::string_view> Session::unmatched_module_patterns() const
+{
+	return implementation_->strict_mode_.unmatched_module_patterns();
+}
+
+bool Session::any_annotation_removed() const
+{
+	return implementation_->strict_mode_.any_annotation_removed();
+}
+} // namespace java_symbols
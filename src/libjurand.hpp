@@ -0,0 +1,160 @@
+#pragma once
+
+#include <cstddef>
+
+#include <iterator>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace java_symbols
+{
+/*!
+ * An independent use of the library: the matchers and flags of one invocation
+ * of the tool, compiled once, together with the bookkeeping of the strict mode
+ * of the contents edited with them. Sessions do not share any state, several
+ * sessions can be used concurrently and one session can be used by several
+ * threads at once.
+ * 
+ * Contents are passed in and returned through buffers of the caller, nothing
+ * is read from or written to files.
+ */
+struct Session
+{
+	//! The matchers and flags, the same as the arguments of the tool
+	struct Options
+	{
+		//! Simple class names, as with `-n`
+		std::vector<std::string> names_;
+		
+		//! Patterns matching names used in code, as with `-p`
+		std::vector<std::string> patterns_;
+		
+		//! Patterns matching module names of `requires` directives, as with `-m`
+		std::vector<std::string> module_patterns_;
+		
+		//! Whether annotations are also removed, as with `-a`
+		bool also_remove_annotations_ = false;
+	};
+	
+	enum class Symbol_kind
+	{
+		import_declaration,
+		annotation,
+	};
+	
+	struct Symbol
+	{
+		Symbol_kind kind_ = Symbol_kind::import_declaration;
+		
+		//! The whole extent of the symbol in the content, up to `;` or the end of the arguments
+		std::string_view text_;
+		
+		//! The name as written in the content without whitespace and comments
+		std::string name_;
+		
+		bool is_static_ = false;
+		
+		/*!
+		 * Whether the matchers of the session match the symbol. Annotations
+		 * are matched against the import declarations preceding them.
+		 */
+		bool matches_ = false;
+	};
+	
+	/*!
+	 * A single-pass iterator over the import declarations and annotations of a
+	 * content, each symbol is found only when the iterator is incremented.
+	 */
+	struct Symbol_iterator
+	{
+		using value_type = Symbol;
+		using difference_type = std::ptrdiff_t;
+		
+		Symbol_iterator() noexcept;
+		Symbol_iterator(Symbol_iterator&&) noexcept;
+		Symbol_iterator& operator=(Symbol_iterator&&) noexcept;
+		~Symbol_iterator();
+		
+		const Symbol& operator*() const noexcept;
+		const Symbol* operator->() const noexcept;
+		Symbol_iterator& operator++();
+		void operator++(int);
+		bool operator==(std::default_sentinel_t) const noexcept;
+	
+	private:
+		friend Session;
+		struct State;
+		
+		std::unique_ptr<State> state_;
+	};
+	
+	//! The symbols of a content, the content must outlive the range.
+	struct Symbol_range
+	{
+		Symbol_iterator begin() const;
+		
+		std::default_sentinel_t end() const noexcept
+		{
+			return std::default_sentinel;
+		}
+	
+	private:
+		friend Session;
+		
+		const Session* session_ = nullptr;
+		std::string_view content_;
+	};
+	
+	/*!
+	 * @throws std::invalid_argument If a pattern is not a valid regular
+	 * expression.
+	 */
+	explicit Session(Options options);
+	
+	Session(Session&&) noexcept;
+	Session& operator=(Session&&) noexcept;
+	~Session();
+	
+	/*!
+	 * Removes the matching symbols from @p content, which is the content of a
+	 * file named @p file_name, only `module-info.java` files are handled
+	 * differently. The matches are recorded for the strict mode.
+	 * 
+	 * @param output Replaced by the result, its capacity is reused. Must not
+	 * overlap @p content.
+	 * 
+	 * @return Whether anything was removed.
+	 */
+	bool edit(std::string_view content, std::string& output, std::string_view file_name = {}) const;
+	
+	/*!
+	 * @return The import declarations and annotations of @p content, in order.
+	 * The matches are not recorded for the strict mode.
+	 */
+	Symbol_range symbols(std::string_view content) const noexcept;
+	
+	/*!
+	 * The results of the strict mode of the edited contents, must not be
+	 * called concurrently with edit().
+	 * 
+	 * @return The sorted unique names which did not match anything.
+	 */
+	std::vector<std::string_view> unmatched_names() const;
+	
+	//! @return The sorted unique patterns which did not match anything.
+	std::vector<std::string_view> unmatched_patterns() const;
+	
+	//! @return The sorted unique module patterns which did not match anything.
+	std::vector<std::string_view> unmatched_module_patterns() const;
+	
+	//! @return Whether any annotation was removed.
+	bool any_annotation_removed() const;
+	
+private:
+	struct Implementation;
+	
+	std::unique_ptr<Implementation> implementation_;
+};
+} // namespace java_symbols
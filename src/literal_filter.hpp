@@ -0,0 +1,165 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <array>
+#include <optional>
+#include <queue>
+#include <span>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "char_scan.hpp"
+
+/*!
+ * An Aho-Corasick automaton answering whether a text contains any of a set of
+ * literals. The transitions are a dense table over classes of bytes, only the
+ * bytes present in the literals have their own class. While the automaton is
+ * in its initial state, the text is skipped to the next first byte of a
+ * literal with a vectorized scan, unless the literals start with too many
+ * different bytes.
+ */
+struct Literal_filter
+{
+	Literal_filter() = default;
+	
+	explicit Literal_filter(std::span<const std::string> literals)
+	{
+		auto first_bytes = std::string();
+		
+		for (const auto& literal : literals)
+		{
+			for (unsigned char c : literal)
+			{
+				if (byte_classes_[c] == 0)
+				{
+					byte_classes_[c] = static_cast<std::uint8_t>(class_count_++);
+				}
+			}
+			
+			if (not literal.empty() and first_bytes.find(literal[0]) == first_bytes.npos)
+			{
+				first_bytes += literal[0];
+			}
+		}
+		
+		if (std::ssize(first_bytes) <= char_scan::Byte_set::capacity)
+		{
+			first_bytes_.emplace(first_bytes);
+		}
+		
+		add_state();
+		
+		for (const auto& literal : literals)
+		{
+			auto state = std::int32_t(0);
+			
+			for (unsigned char c : literal)
+			{
+				auto transition = state * class_count_ + byte_classes_[c];
+				
+				if (transitions_[transition] == 0)
+				{
+					auto next = add_state();
+					transitions_[transition] = next;
+				}
+				
+				state = transitions_[transition];
+			}
+			
+			accepting_[state] = true;
+		}
+		
+		// Breadth-first traversal computing the failure links, missing
+		// transitions are replaced by the transitions of the failure state
+		auto failure = std::vector<std::int32_t>(accepting_.size(), 0);
+		auto queue = std::queue<std::int32_t>();
+		
+		for (std::ptrdiff_t byte_class = 0; byte_class != class_count_; ++byte_class)
+		{
+			if (auto next = transitions_[byte_class]; next != 0)
+			{
+				queue.push(next);
+			}
+		}
+		
+		while (not queue.empty())
+		{
+			auto state = queue.front();
+			queue.pop();
+			accepting_[state] = accepting_[state] or accepting_[failure[state]];
+			
+			for (std::ptrdiff_t byte_class = 0; byte_class != class_count_; ++byte_class)
+			{
+				auto& next = transitions_[state * class_count_ + byte_class];
+				auto fallback = transitions_[failure[state] * class_count_ + byte_class];
+				
+				if (next == 0)
+				{
+					next = fallback;
+				}
+				else
+				{
+					failure[next] = fallback;
+					queue.push(next);
+				}
+			}
+		}
+	}
+	
+	/*!
+	 * @return True if @p content contains any of the literals.
+	 */
+	[[nodiscard]] bool matches(std::string_view content) const noexcept
+	{
+		if (accepting_.empty())
+		{
+			return false;
+		}
+		
+		if (accepting_[0])
+		{
+			return true;
+		}
+		
+		auto state = std::int32_t(0);
+		
+		for (auto position = std::ptrdiff_t(0); position != std::ssize(content); ++position)
+		{
+			if (state == 0 and first_bytes_)
+			{
+				position = char_scan::find_any_of(*first_bytes_, content, position);
+				
+				if (position == std::ssize(content))
+				{
+					return false;
+				}
+			}
+			
+			state = transitions_[state * class_count_ + byte_classes_[static_cast<unsigned char>(content[position])]];
+			
+			if (accepting_[state])
+			{
+				return true;
+			}
+		}
+		
+		return false;
+	}
+	
+private:
+	std::int32_t add_state()
+	{
+		transitions_.resize(transitions_.size() + class_count_, 0);
+		accepting_.push_back(false);
+		return static_cast<std::int32_t>(accepting_.size() - 1);
+	}
+	
+	std::array<std::uint8_t, 256> byte_classes_ {};
+	std::ptrdiff_t class_count_ = 1;
+	std::vector<std::int32_t> transitions_;
+	std::vector<bool> accepting_;
+	std::optional<char_scan::Byte_set> first_bytes_;
+};
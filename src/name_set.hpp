@@ -0,0 +1,239 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <initializer_list>
+#include <numeric>
+#include <span>
+#include <string_view>
+#include <vector>
+
+/*!
+ * An immutable set of names built once, looked up with a minimal perfect hash.
+ * 
+ * A bitmap of the first characters and a mask of the lengths of the names
+ * reject most of the names which are not present before hashing. The hash
+ * selects a bucket, each bucket has a seed chosen when the set is built so
+ * that the seeded hashes of all the names map to distinct slots. A lookup is
+ * therefore one hash, two loads and one comparison.
+ * 
+ * The names are kept sorted and unique, the index of a name is its position
+ * in names().
+ */
+struct Name_set
+{
+	Name_set() = default;
+	
+	//! @param names Views which must outlive the set, may contain duplicates.
+	explicit Name_set(std::span<const std::string_view> names)
+		:
+		names_(names.begin(), names.end())
+	{
+		std::ranges::sort(names_);
+		names_.erase(std::ranges::unique(names_).begin(), names_.end());
+		
+		for (auto name : names_)
+		{
+			lengths_ |= std::uint64_t(1) << std::min<std::size_t>(name.size(), 63);
+			
+			if (not name.empty())
+			{
+				auto c = static_cast<unsigned char>(name[0]);
+				first_characters_[c / 64] |= std::uint64_t(1) << (c % 64);
+			}
+		}
+		
+		if (not names_.empty())
+		{
+			// Only a collision of the full hashes of two names makes building
+			// fail, another salt then gives different hashes
+			while (not build())
+			{
+				++salt_;
+			}
+		}
+	}
+	
+	Name_set(std::initializer_list<std::string_view> names)
+		:
+		Name_set(std::span(names.begin(), names.size()))
+	{
+	}
+	
+	//! @return The index of @p name in names() or `-1` if it is not present.
+	[[nodiscard]] std::ptrdiff_t find(std::string_view name) const noexcept
+	{
+		if (not ((lengths_ >> std::min<std::size_t>(name.size(), 63)) & 1))
+		{
+			return -1;
+		}
+		
+		if (not name.empty())
+		{
+			auto c = static_cast<unsigned char>(name[0]);
+			
+			if (not ((first_characters_[c / 64] >> (c % 64)) & 1))
+			{
+				return -1;
+			}
+		}
+		
+		auto hash = this->hash(name);
+		auto index = slots_[slot(hash, seeds_[bucket(hash)])];
+		
+		return names_[index] == name ? index : -1;
+	}
+	
+	[[nodiscard]] bool contains(std::string_view name) const noexcept
+	{
+		return find(name) != -1;
+	}
+	
+	//! @return The sorted unique names.
+	[[nodiscard]] std::span<const std::string_view> names() const noexcept
+	{
+		return names_;
+	}
+	
+	[[nodiscard]] std::ptrdiff_t size() const noexcept
+	{
+		return std::ssize(names_);
+	}
+	
+	[[nodiscard]] bool empty() const noexcept
+	{
+		return names_.empty();
+	}
+	
+	[[nodiscard]] auto begin() const noexcept
+	{
+		return names_.begin();
+	}
+	
+	[[nodiscard]] auto end() const noexcept
+	{
+		return names_.end();
+	}
+	
+private:
+	static constexpr auto multiplier = std::uint64_t(0x9e3779b97f4a7c15);
+	
+	static std::uint64_t mix(std::uint64_t value) noexcept
+	{
+		value = (value ^ (value >> 30)) * 0xbf58476d1ce4e5b9;
+		value = (value ^ (value >> 27)) * 0x94d049bb133111eb;
+		return value ^ (value >> 31);
+	}
+	
+	[[nodiscard]] std::uint64_t hash(std::string_view name) const noexcept
+	{
+		auto result = (salt_ * multiplier) ^ std::uint64_t(name.size());
+		
+		for (std::size_t position = 0; position < name.size(); position += 8)
+		{
+			auto word = std::uint64_t();
+			std::memcpy(&word, name.data() + position, std::min<std::size_t>(8, name.size() - position));
+			result = std::rotl(result ^ (word * multiplier), 29) * multiplier;
+		}
+		
+		return mix(result);
+	}
+	
+	[[nodiscard]] std::size_t bucket(std::uint64_t hash) const noexcept
+	{
+		return (hash >> 32) % seeds_.size();
+	}
+	
+	[[nodiscard]] std::size_t slot(std::uint64_t hash, std::uint32_t seed) const noexcept
+	{
+		return mix(hash + seed * multiplier) % slots_.size();
+	}
+	
+	/*!
+	 * Chooses the seeds of the buckets, the largest buckets first while most of
+	 * the slots are still free.
+	 * 
+	 * @return False if two names have the same hash.
+	 */
+	bool build()
+	{
+		seeds_.assign(std::max<std::size_t>(1, names_.size() / 2), 0);
+		slots_.assign(names_.size(), -1);
+		
+		auto hashes = std::vector<std::uint64_t>();
+		auto buckets = std::vector<std::vector<std::int32_t>>(seeds_.size());
+		
+		for (std::int32_t index = 0; index != std::ssize(names_); ++index)
+		{
+			hashes.push_back(hash(names_[index]));
+			buckets[bucket(hashes.back())].push_back(index);
+		}
+		
+		auto order = std::vector<std::size_t>(buckets.size());
+		std::iota(order.begin(), order.end(), 0);
+		std::ranges::stable_sort(order, std::ranges::greater(), [&](std::size_t index) noexcept
+		{
+			return buckets[index].size();
+		});
+		
+		auto taken = std::vector<std::size_t>();
+		
+		for (auto bucket_index : order)
+		{
+			const auto& members = buckets[bucket_index];
+			
+			for (std::size_t i = 0; i != members.size(); ++i)
+			{
+				for (std::size_t j = 0; j != i; ++j)
+				{
+					if (hashes[members[i]] == hashes[members[j]])
+					{
+						return false;
+					}
+				}
+			}
+			
+			for (std::uint32_t seed = 0;; ++seed)
+			{
+				taken.clear();
+				
+				for (auto index : members)
+				{
+					auto slot = this->slot(hashes[index], seed);
+					
+					if (slots_[slot] != -1 or std::ranges::find(taken, slot) != taken.end())
+					{
+						break;
+					}
+					
+					taken.push_back(slot);
+				}
+				
+				if (taken.size() == members.size())
+				{
+					for (std::size_t i = 0; i != members.size(); ++i)
+					{
+						slots_[taken[i]] = members[i];
+					}
+					
+					seeds_[bucket_index] = seed;
+					break;
+				}
+			}
+		}
+		
+		return true;
+	}
+	
+	std::vector<std::string_view> names_;
+	std::vector<std::uint32_t> seeds_;
+	std::vector<std::int32_t> slots_;
+	std::array<std::uint64_t, 4> first_characters_ = {};
+	std::uint64_t lengths_ = 0;
+	std::uint64_t salt_ = 0;
+};
@@ -0,0 +1,280 @@
+#pragma once
+
+#include <cstddef>
+
+#include <condition_variable>
+#include <exception>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <utility>
+
+#include <unistd.h>
+
+#include "edited_content.hpp"
+
+/*!
+ * Writes the outputs of files handled by several threads in a deterministic
+ * order. The order is a tree of slots: a file has a slot and a directory has a
+ * slot which is expanded into the slots of its entries once it is listed. The
+ * slots are written in depth-first order as soon as they are complete.
+ * 
+ * An output which is not the next one to be written is copied and kept until
+ * it is. If the kept outputs exceed a window size, the thread writing another
+ * one waits for the outputs before it to be written, unless all other threads
+ * already wait. The outputs are collected into large batches which are written
+ * directly to the file descriptor.
+ */
+struct Ordered_output
+{
+	//! Outputs are collected until they reach this size
+	static constexpr std::ptrdiff_t batch_size = 1024 * 1024;
+	
+	//! The default limit of the size of outputs kept out of order
+	static constexpr std::ptrdiff_t default_window_size = 16 * 1024 * 1024;
+	
+	struct Slot
+	{
+		enum class State
+		{
+			pending, ready, expanded,
+		};
+		
+		State state_ = State::pending;
+		std::string content_;
+		std::unique_ptr<Slot[]> children_;
+		std::ptrdiff_t child_count_ = 0;
+		Slot* parent_ = nullptr;
+	};
+	
+	/*!
+	 * @param worker_count The number of threads which write outputs.
+	 */
+	explicit Ordered_output(std::ptrdiff_t worker_count, int fd = STDOUT_FILENO,
+		std::ptrdiff_t window_size = default_window_size)
+		:
+		worker_count_(worker_count),
+		window_size_(window_size),
+		fd_(fd)
+	{
+		batch_.reserve(batch_size);
+	}
+	
+	Ordered_output(const Ordered_output&) = delete;
+	Ordered_output& operator=(const Ordered_output&) = delete;
+	
+	//! @return The slot containing the whole output.
+	[[nodiscard]] Slot& root() noexcept
+	{
+		return root_;
+	}
+	
+	/*!
+	 * Replaces the pending @p slot by @p count new pending slots in its place.
+	 * 
+	 * @return The new slots.
+	 */
+	std::span<Slot> expand(Slot& slot, std::ptrdiff_t count)
+	{
+		auto children = std::make_unique<Slot[]>(count);
+		
+		for (std::ptrdiff_t i = 0; i != count; ++i)
+		{
+			children[i].parent_ = &slot;
+		}
+		
+		auto result = std::span<Slot>(children.get(), count);
+		auto lock = std::lock_guard(mutex_);
+		
+		slot.children_ = std::move(children);
+		slot.child_count_ = count;
+		slot.state_ = Slot::State::expanded;
+		
+		if (&slot == cursor_)
+		{
+			settle();
+		}
+		
+		return result;
+	}
+	
+	/*!
+	 * Completes the pending @p slot with @p header followed by @p content. If
+	 * this throws, the slot is still pending. Errors of writing are not
+	 * reported here but by flush().
+	 */
+	void write(Slot& slot, std::string_view header, const Edited_content& content)
+	{
+		auto size = std::ssize(header) + content.size();
+		auto lock = std::unique_lock(mutex_);
+		
+		if (&slot != cursor_ and buffered_size_ + size > window_size_ and waiting_count_ + 1 < worker_count_)
+		{
+			++waiting_count_;
+			condition_.wait(lock, [&]() noexcept -> bool
+			{
+				return &slot == cursor_ or buffered_size_ + size <= window_size_;
+			});
+			--waiting_count_;
+		}
+		
+		if (&slot == cursor_)
+		{
+			emit(header, content);
+			next();
+			settle();
+			return;
+		}
+		
+		slot.content_.reserve(size);
+		slot.content_.append(header);
+		
+		for (auto span : content.spans())
+		{
+			slot.content_.append(span);
+		}
+		
+		slot.state_ = Slot::State::ready;
+		buffered_size_ += size;
+	}
+	
+	//! Completes the pending @p slot without any output.
+	void skip(Slot& slot)
+	{
+		write(slot, {}, Edited_content());
+	}
+	
+	/*!
+	 * Writes the collected outputs, all slots must be complete.
+	 * 
+	 * @throws std::system_error If any writing failed.
+	 */
+	void flush()
+	{
+		auto lock = std::lock_guard(mutex_);
+		write_batch();
+		
+		if (error_)
+		{
+			std::rethrow_exception(std::exchange(error_, nullptr));
+		}
+	}
+	
+private:
+	//! Writes all complete slots starting at the cursor.
+	void settle()
+	{
+		while (cursor_)
+		{
+			if (cursor_->state_ == Slot::State::pending)
+			{
+				break;
+			}
+			else if (cursor_->state_ == Slot::State::expanded and cursor_->child_count_ != 0)
+			{
+				cursor_ = &cursor_->children_[0];
+				continue;
+			}
+			else if (cursor_->state_ == Slot::State::ready)
+			{
+				emit({}, Edited_content(cursor_->content_));
+				buffered_size_ -= std::ssize(cursor_->content_);
+				cursor_->content_ = std::string();
+			}
+			
+			next();
+		}
+		
+		condition_.notify_all();
+	}
+	
+	//! Moves the cursor past the current slot, releasing finished directories.
+	void next() noexcept
+	{
+		auto* slot = cursor_;
+		
+		while (auto* parent = slot->parent_)
+		{
+			if (slot + 1 != parent->children_.get() + parent->child_count_)
+			{
+				cursor_ = slot + 1;
+				return;
+			}
+			
+			slot = parent;
+			slot->children_.reset();
+		}
+		
+		cursor_ = nullptr;
+	}
+	
+	void emit(std::string_view header, const Edited_content& content)
+	{
+		if (error_)
+		{
+			return;
+		}
+		
+		try
+		{
+			auto size = std::ssize(header) + content.size();
+			
+			if (std::ssize(batch_) + size > batch_size)
+			{
+				write_batch();
+			}
+			
+			if (size >= batch_size)
+			{
+				content.write(fd_, header);
+				return;
+			}
+			
+			batch_.append(header);
+			
+			for (auto span : content.spans())
+			{
+				batch_.append(span);
+			}
+		}
+		catch (...)
+		{
+			error_ = std::current_exception();
+		}
+	}
+	
+	void write_batch()
+	{
+		if (error_ or batch_.empty())
+		{
+			return;
+		}
+		
+		try
+		{
+			Edited_content(batch_).write(fd_);
+		}
+		catch (...)
+		{
+			error_ = std::current_exception();
+		}
+		
+		batch_.clear();
+	}
+	
+	std::ptrdiff_t worker_count_;
+	std::ptrdiff_t window_size_;
+	int fd_;
+	
+	std::mutex mutex_;
+	std::condition_variable condition_;
+	Slot root_;
+	Slot* cursor_ = &root_;
+	std::ptrdiff_t buffered_size_ = 0;
+	std::ptrdiff_t waiting_count_ = 0;
+	std::string batch_;
+	std::exception_ptr error_;
+};
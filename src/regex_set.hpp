@@ -0,0 +1,1100 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <array>
+#include <atomic>
+#include <initializer_list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "bitset.hpp"
+
+/*!
+ * A set of POSIX extended regular expressions searched for simultaneously.
+ * 
+ * All the patterns are compiled into a single Thompson NFA. The states of the
+ * equivalent DFA are built lazily as searches reach them and are shared by all
+ * the threads searching with the set. A search is a single pass over the text
+ * without backtracking and reports all the patterns which match any substring
+ * of the text. If the DFA outgrows its state limit, the rest of the text is
+ * matched by simulating the NFA, which is still linear in its length.
+ * 
+ * Matching is done on bytes, like std::regex does for `char`. Backreferences
+ * and collating elements of more than one character are not supported.
+ */
+struct Regex_set
+{
+	Regex_set() = default;
+	
+	Regex_set(std::initializer_list<std::string_view> patterns)
+		:
+		Regex_set(std::span(patterns.begin(), patterns.size()))
+	{
+	}
+	
+	/*!
+	 * @throws std::invalid_argument If any of the @p patterns is not a valid
+	 * regular expression.
+	 */
+	explicit Regex_set(std::span<const std::string_view> patterns)
+	{
+		auto starts = std::vector<std::int32_t>();
+		
+		for (auto pattern : patterns)
+		{
+			auto pattern_index = std::ssize(patterns_);
+			patterns_.emplace_back(pattern);
+			auto parser = Parser(*this, pattern);
+			auto node = parser.parse();
+			auto match = add_state(Nfa_state::match);
+			nfa_[match].pattern_ = static_cast<std::int32_t>(pattern_index);
+			starts.push_back(compile(node, match));
+		}
+		
+		root_ = add_state(Nfa_state::epsilon);
+		
+		for (auto start : starts)
+		{
+			if (nfa_[root_].next_ == -1)
+			{
+				nfa_[root_].next_ = start;
+				continue;
+			}
+			
+			auto split = add_state(Nfa_state::split);
+			nfa_[split].next_ = start;
+			nfa_[split].alternative_ = nfa_[root_].next_;
+			nfa_[root_].next_ = split;
+		}
+		
+		find_byte_classes();
+		reset_dfa();
+	}
+	
+	//! The copy starts with an empty DFA of its own.
+	Regex_set(const Regex_set& other)
+		:
+		patterns_(other.patterns_),
+		nfa_(other.nfa_),
+		byte_sets_(other.byte_sets_),
+		byte_set_indices_(other.byte_set_indices_),
+		root_(other.root_),
+		matches_empty_(other.matches_empty_),
+		byte_classes_(other.byte_classes_),
+		representatives_(other.representatives_)
+	{
+		if (other.dfa_)
+		{
+			reset_dfa();
+		}
+	}
+	
+	Regex_set(Regex_set&&) noexcept = default;
+	
+	Regex_set& operator=(const Regex_set& other)
+	{
+		auto copy = Regex_set(other);
+		return *this = std::move(copy);
+	}
+	
+	Regex_set& operator=(Regex_set&&) noexcept = default;
+	
+	[[nodiscard]] std::ptrdiff_t size() const noexcept
+	{
+		return std::ssize(patterns_);
+	}
+	
+	[[nodiscard]] bool empty() const noexcept
+	{
+		return patterns_.empty();
+	}
+	
+	[[nodiscard]] std::string_view pattern(std::ptrdiff_t index) const noexcept
+	{
+		return patterns_[index];
+	}
+	
+	[[nodiscard]] std::span<const std::string> patterns() const noexcept
+	{
+		return patterns_;
+	}
+	
+	/*!
+	 * @return True if any of the patterns matches a substring of @p text.
+	 */
+	[[nodiscard]] bool search(std::string_view text) const
+	{
+		return run(text, nullptr);
+	}
+	
+	/*!
+	 * Searches for all the patterns at once and sets the bits of the indices of
+	 * the patterns which match a substring of @p text in @p matched, which must
+	 * have the same size as this set.
+	 * 
+	 * @return True if any of the patterns matches.
+	 */
+	bool search(std::string_view text, Bitset& matched) const
+	{
+		return run(text, &matched);
+	}
+	
+private:
+	using Byte_set = std::array<std::uint64_t, 4>;
+	
+	static constexpr std::uint8_t accepting = 1;
+	static constexpr std::uint8_t accepting_at_end = 2;
+	
+	//! Limit of the number of DFA states after which the NFA is simulated
+	static constexpr std::int32_t max_dfa_states = 4096;
+	
+	//! The number of DFA states allocated at once
+	static constexpr std::int32_t chunk_size = 64;
+	
+	//! A transition which has not been built yet
+	static constexpr std::int32_t unknown = -1;
+	
+	//! Limit of bounded repetitions, larger counts make the NFA too large
+	static constexpr std::int32_t max_repetition = 1000;
+	
+	struct Nfa_state
+	{
+		enum Kind : std::uint8_t
+		{
+			bytes,
+			split,
+			epsilon,
+			begin_assertion,
+			end_assertion,
+			match,
+		};
+		
+		Kind kind_ = epsilon;
+		std::int32_t next_ = -1;
+		std::int32_t alternative_ = -1;
+		std::int32_t byte_set_ = -1;
+		std::int32_t pattern_ = -1;
+	};
+	
+	struct Node
+	{
+		enum Kind : std::uint8_t
+		{
+			bytes,
+			concatenation,
+			alternation,
+			repetition,
+			begin_assertion,
+			end_assertion,
+		};
+		
+		explicit Node(Kind kind) noexcept
+			:
+			kind_(kind)
+		{
+		}
+		
+		Kind kind_;
+		std::int32_t byte_set_ = -1;
+		std::int32_t min_ = 0;
+		
+		//! -1 means unbounded
+		std::int32_t max_ = 0;
+		std::vector<Node> children_;
+	};
+	
+	/*!
+	 * Recursive descent parser of the POSIX extended regular expression syntax.
+	 */
+	struct Parser
+	{
+		Parser(Regex_set& regex_set, std::string_view pattern) noexcept
+			:
+			regex_set_(regex_set),
+			pattern_(pattern)
+		{
+		}
+		
+		Node parse()
+		{
+			auto result = parse_alternation();
+			
+			if (position_ != std::ssize(pattern_))
+			{
+				fail("unmatched ')'");
+			}
+			
+			return result;
+		}
+	
+	private:
+		[[noreturn]] void fail(std::string_view reason) const
+		{
+			throw std::invalid_argument("invalid regular expression '" + std::string(pattern_) + "': " + std::string(reason));
+		}
+		
+		[[nodiscard]] bool at_end() const noexcept
+		{
+			return position_ == std::ssize(pattern_);
+		}
+		
+		[[nodiscard]] char peek() const noexcept
+		{
+			return pattern_[position_];
+		}
+		
+		Node parse_alternation()
+		{
+			auto result = Node(Node::alternation);
+			result.children_.push_back(parse_concatenation());
+			
+			while (not at_end() and peek() == '|')
+			{
+				++position_;
+				result.children_.push_back(parse_concatenation());
+			}
+			
+			if (result.children_.size() == 1)
+			{
+				return std::move(result.children_.front());
+			}
+			
+			return result;
+		}
+		
+		Node parse_concatenation()
+		{
+			auto result = Node(Node::concatenation);
+			
+			while (not at_end() and peek() != '|' and peek() != ')')
+			{
+				result.children_.push_back(parse_repetition());
+			}
+			
+			return result;
+		}
+		
+		Node parse_repetition()
+		{
+			auto result = parse_atom();
+			
+			while (not at_end() and (peek() == '*' or peek() == '+' or peek() == '?' or peek() == '{'))
+			{
+				auto repetition = Node(Node::repetition);
+				
+				switch (pattern_[position_++])
+				{
+				case '*':
+					repetition.max_ = -1;
+					break;
+				case '+':
+					repetition.min_ = 1;
+					repetition.max_ = -1;
+					break;
+				case '?':
+					repetition.max_ = 1;
+					break;
+				default:
+					repetition.min_ = parse_count();
+					repetition.max_ = repetition.min_;
+					
+					if (not at_end() and peek() == ',')
+					{
+						++position_;
+						repetition.max_ = (not at_end() and peek() == '}') ? -1 : parse_count();
+					}
+					
+					if (at_end() or pattern_[position_++] != '}')
+					{
+						fail("invalid interval");
+					}
+					
+					if (repetition.max_ != -1 and repetition.max_ < repetition.min_)
+					{
+						fail("invalid interval");
+					}
+				}
+				
+				repetition.children_.push_back(std::move(result));
+				result = std::move(repetition);
+			}
+			
+			return result;
+		}
+		
+		std::int32_t parse_count()
+		{
+			auto result = std::int32_t(0);
+			auto begin = position_;
+			
+			while (not at_end() and peek() >= '0' and peek() <= '9')
+			{
+				result = result * 10 + (pattern_[position_++] - '0');
+				
+				if (result > max_repetition)
+				{
+					fail("repetition count too large");
+				}
+			}
+			
+			if (position_ == begin)
+			{
+				fail("invalid interval");
+			}
+			
+			return result;
+		}
+		
+		Node parse_atom()
+		{
+			auto c = pattern_[position_++];
+			auto byte_set = Byte_set();
+			
+			switch (c)
+			{
+			case '(':
+			{
+				auto result = parse_alternation();
+				
+				if (at_end() or pattern_[position_++] != ')')
+				{
+					fail("unmatched '('");
+				}
+				
+				return result;
+			}
+			case '*':
+			case '+':
+			case '?':
+			case '{':
+				fail("repetition operator without an operand");
+			case '^':
+				return Node(Node::begin_assertion);
+			case '$':
+				return Node(Node::end_assertion);
+			case '.':
+				byte_set = Byte_set{~std::uint64_t(0), ~std::uint64_t(0), ~std::uint64_t(0), ~std::uint64_t(0)};
+				reset(byte_set, '\0');
+				break;
+			case '[':
+				byte_set = parse_bracket();
+				break;
+			case '\\':
+				if (at_end())
+				{
+					fail("trailing backslash");
+				}
+				
+				// Only the special characters of extended regular expressions
+				// can be escaped, as with std::regex::extended
+				if (std::string_view("^$\\.*+?()[]{}|").find(peek()) == std::string_view::npos)
+				{
+					fail("invalid escape");
+				}
+				
+				insert(byte_set, pattern_[position_++]);
+				break;
+			default:
+				insert(byte_set, c);
+			}
+			
+			auto result = Node(Node::bytes);
+			result.byte_set_ = regex_set_.add_byte_set(byte_set);
+			
+			return result;
+		}
+		
+		Byte_set parse_bracket()
+		{
+			auto result = Byte_set();
+			bool negated = not at_end() and peek() == '^';
+			
+			if (negated)
+			{
+				++position_;
+			}
+			
+			bool first = true;
+			
+			while (true)
+			{
+				if (at_end())
+				{
+					fail("unmatched '['");
+				}
+				
+				auto c = pattern_[position_++];
+				
+				if (c == ']' and not first)
+				{
+					break;
+				}
+				
+				first = false;
+				
+				if (c == '[' and not at_end() and (peek() == ':' or peek() == '=' or peek() == '.'))
+				{
+					auto delimiter = pattern_[position_++];
+					auto end = pattern_.find(std::string{delimiter, ']'}, position_);
+					
+					if (end == pattern_.npos)
+					{
+						fail("unmatched '['");
+					}
+					
+					auto name = pattern_.substr(position_, end - position_);
+					position_ = std::ptrdiff_t(end) + 2;
+					
+					if (delimiter == ':')
+					{
+						insert_class(result, name);
+						continue;
+					}
+					
+					if (name.size() != 1)
+					{
+						fail("unsupported collating element");
+					}
+					
+					c = name[0];
+				}
+				
+				auto last = c;
+				
+				if (position_ + 1 < std::ssize(pattern_) and peek() == '-' and pattern_[position_ + 1] != ']')
+				{
+					last = pattern_[position_ + 1];
+					position_ += 2;
+					
+					if (static_cast<unsigned char>(last) < static_cast<unsigned char>(c))
+					{
+						fail("invalid range");
+					}
+				}
+				
+				for (int byte = static_cast<unsigned char>(c); byte <= static_cast<unsigned char>(last); ++byte)
+				{
+					insert(result, static_cast<char>(byte));
+				}
+			}
+			
+			if (negated)
+			{
+				for (auto& word : result)
+				{
+					word = ~word;
+				}
+			}
+			
+			return result;
+		}
+		
+		void insert_class(Byte_set& byte_set, std::string_view name) const
+		{
+			auto predicate = [&]() -> bool(*)(int) noexcept
+			{
+				if (name == "alpha") return [](int c) noexcept {return (c | 32) >= 'a' and (c | 32) <= 'z';};
+				if (name == "digit" or name == "d") return [](int c) noexcept {return c >= '0' and c <= '9';};
+				if (name == "alnum") return [](int c) noexcept {return (c >= '0' and c <= '9') or ((c | 32) >= 'a' and (c | 32) <= 'z');};
+				if (name == "upper") return [](int c) noexcept {return c >= 'A' and c <= 'Z';};
+				if (name == "lower") return [](int c) noexcept {return c >= 'a' and c <= 'z';};
+				if (name == "space" or name == "s") return [](int c) noexcept {return c == ' ' or (c >= '\t' and c <= '\r');};
+				if (name == "blank") return [](int c) noexcept {return c == ' ' or c == '\t';};
+				if (name == "punct") return [](int c) noexcept {return (c >= 33 and c <= 47) or (c >= 58 and c <= 64) or (c >= 91 and c <= 96) or (c >= 123 and c <= 126);};
+				if (name == "xdigit") return [](int c) noexcept {return (c >= '0' and c <= '9') or ((c | 32) >= 'a' and (c | 32) <= 'f');};
+				if (name == "cntrl") return [](int c) noexcept {return c < 32 or c == 127;};
+				if (name == "graph") return [](int c) noexcept {return c >= 33 and c <= 126;};
+				if (name == "print") return [](int c) noexcept {return c >= 32 and c <= 126;};
+				if (name == "w") return [](int c) noexcept {return c == '_' or (c >= '0' and c <= '9') or ((c | 32) >= 'a' and (c | 32) <= 'z');};
+				return nullptr;
+			}();
+			
+			if (not predicate)
+			{
+				fail("invalid character class");
+			}
+			
+			for (int c = 0; c != 128; ++c)
+			{
+				if (predicate(c))
+				{
+					insert(byte_set, static_cast<char>(c));
+				}
+			}
+		}
+		
+		static void insert(Byte_set& byte_set, char c) noexcept
+		{
+			auto byte = static_cast<unsigned char>(c);
+			byte_set[byte / 64] |= std::uint64_t(1) << (byte % 64);
+		}
+		
+		static void reset(Byte_set& byte_set, char c) noexcept
+		{
+			auto byte = static_cast<unsigned char>(c);
+			byte_set[byte / 64] &= ~(std::uint64_t(1) << (byte % 64));
+		}
+		
+		Regex_set& regex_set_;
+		std::string_view pattern_;
+		std::ptrdiff_t position_ = 0;
+	};
+	
+	static bool contains(const Byte_set& byte_set, unsigned char byte) noexcept
+	{
+		return (byte_set[byte / 64] >> (byte % 64)) & 1;
+	}
+	
+	std::int32_t add_state(Nfa_state::Kind kind)
+	{
+		nfa_.emplace_back().kind_ = kind;
+		return static_cast<std::int32_t>(nfa_.size() - 1);
+	}
+	
+	std::int32_t add_byte_set(const Byte_set& byte_set)
+	{
+		auto [it, inserted] = byte_set_indices_.try_emplace(byte_set, static_cast<std::int32_t>(byte_sets_.size()));
+		
+		if (inserted)
+		{
+			byte_sets_.push_back(byte_set);
+		}
+		
+		return it->second;
+	}
+	
+	/*!
+	 * Compiles @p node into NFA states which continue to the state @p next.
+	 * 
+	 * @return The entry state of the compiled node.
+	 */
+	std::int32_t compile(const Node& node, std::int32_t next)
+	{
+		switch (node.kind_)
+		{
+		case Node::bytes:
+		{
+			auto result = add_state(Nfa_state::bytes);
+			nfa_[result].byte_set_ = node.byte_set_;
+			nfa_[result].next_ = next;
+			return result;
+		}
+		case Node::begin_assertion:
+		case Node::end_assertion:
+		{
+			auto result = add_state(node.kind_ == Node::begin_assertion ? Nfa_state::begin_assertion : Nfa_state::end_assertion);
+			nfa_[result].next_ = next;
+			return result;
+		}
+		case Node::concatenation:
+			for (auto it = node.children_.rbegin(); it != node.children_.rend(); ++it)
+			{
+				next = compile(*it, next);
+			}
+			
+			return next;
+		case Node::alternation:
+		{
+			auto result = compile(node.children_.back(), next);
+			
+			for (auto it = std::next(node.children_.rbegin()); it != node.children_.rend(); ++it)
+			{
+				auto entry = compile(*it, next);
+				auto split = add_state(Nfa_state::split);
+				nfa_[split].next_ = entry;
+				nfa_[split].alternative_ = result;
+				result = split;
+			}
+			
+			return result;
+		}
+		case Node::repetition:
+		{
+			const auto& child = node.children_.front();
+			auto result = next;
+			
+			if (node.max_ == -1)
+			{
+				auto loop = add_state(Nfa_state::split);
+				auto entry = compile(child, loop);
+				nfa_[loop].next_ = entry;
+				nfa_[loop].alternative_ = next;
+				result = loop;
+			}
+			else
+			{
+				for (auto i = node.min_; i != node.max_; ++i)
+				{
+					auto entry = compile(child, result);
+					auto split = add_state(Nfa_state::split);
+					nfa_[split].next_ = entry;
+					nfa_[split].alternative_ = next;
+					result = split;
+				}
+			}
+			
+			for (auto i = 0; i != node.min_; ++i)
+			{
+				result = compile(child, result);
+			}
+			
+			return result;
+		}
+		}
+		
+		return next;
+	}
+	
+	//! Buffers of closure() reused between its calls
+	struct Closure_buffers
+	{
+		std::vector<std::int32_t> stack_;
+		
+		//! The states visited by the current call are marked by its generation
+		std::vector<std::uint32_t> visited_;
+		std::uint32_t generation_ = 0;
+	};
+	
+	/*!
+	 * The DFA states built so far, they are added under the mutex and read
+	 * without locking. A transition is published by storing its target only
+	 * after the target state is complete.
+	 */
+	struct Dfa
+	{
+		struct Chunk
+		{
+			std::array<std::uint8_t, chunk_size> flags_ {};
+			std::array<Bitset, chunk_size> accept_;
+			std::array<Bitset, chunk_size> accept_at_end_;
+			
+			//! The transitions of the states indexed by the state and the byte class
+			std::unique_ptr<std::atomic<std::int32_t>[]> transitions_;
+		};
+		
+		std::array<std::unique_ptr<Chunk>, max_dfa_states / chunk_size> chunks_;
+		
+		std::mutex mutex_;
+		
+		//! The sorted NFA states of all the DFA states one after another
+		std::vector<std::int32_t> keys_;
+		
+		//! The offset of the key of each state in keys_ and the end of keys_
+		std::vector<std::int32_t> key_offsets_ {0};
+		
+		//! Open addressing hash table of the states by their keys
+		std::vector<std::int32_t> table_;
+		
+		Closure_buffers buffers_;
+		std::vector<std::int32_t> next_;
+		std::vector<std::int32_t> key_;
+	};
+	
+	[[nodiscard]] const Dfa::Chunk& chunk(std::int32_t state) const noexcept
+	{
+		return *dfa_->chunks_[state / chunk_size];
+	}
+	
+	[[nodiscard]] std::atomic<std::int32_t>& transition(std::int32_t state, std::uint8_t byte_class) const noexcept
+	{
+		return chunk(state).transitions_[(state % chunk_size) * std::ssize(representatives_) + byte_class];
+	}
+	
+	bool run(std::string_view text, Bitset* matched) const
+	{
+		if (patterns_.empty())
+		{
+			return false;
+		}
+		
+		if (text.empty())
+		{
+			if (matched)
+			{
+				*matched |= matches_empty_;
+			}
+			
+			return matches_empty_.any();
+		}
+		
+		auto state = std::int32_t(0);
+		bool result = false;
+		
+		for (std::ptrdiff_t position = 0; position != std::ssize(text); ++position)
+		{
+			const auto& state_chunk = chunk(state);
+			
+			if (state_chunk.flags_[state % chunk_size] & accepting)
+			{
+				if (not matched)
+				{
+					return true;
+				}
+				
+				*matched |= state_chunk.accept_[state % chunk_size];
+				result = true;
+			}
+			
+			auto byte_class = byte_classes_[static_cast<unsigned char>(text[position])];
+			auto next = transition(state, byte_class).load(std::memory_order_acquire);
+			
+			if (next == unknown)
+			{
+				next = add_transition(state, byte_class);
+			}
+			
+			if (next == unknown)
+			{
+				return simulate(text.substr(position), state, matched) or result;
+			}
+			
+			state = next;
+		}
+		
+		const auto& state_chunk = chunk(state);
+		
+		if (state_chunk.flags_[state % chunk_size] & accepting_at_end)
+		{
+			if (matched)
+			{
+				*matched |= state_chunk.accept_at_end_[state % chunk_size];
+			}
+			
+			result = true;
+		}
+		
+		return result;
+	}
+	
+	/*!
+	 * Computes the states reachable from @p states without consuming a byte
+	 * into @p result.
+	 * 
+	 * @return A sorted set of states which consume a byte, match states and end
+	 * assertions which could not be passed.
+	 */
+	void closure(std::span<const std::int32_t> states, bool at_begin, bool at_end,
+		Closure_buffers& buffers, std::vector<std::int32_t>& result) const
+	{
+		result.clear();
+		buffers.visited_.resize(nfa_.size());
+		
+		if (++buffers.generation_ == 0)
+		{
+			std::ranges::fill(buffers.visited_, 0);
+			buffers.generation_ = 1;
+		}
+		
+		auto& stack = buffers.stack_;
+		stack.assign(states.begin(), states.end());
+		
+		while (not stack.empty())
+		{
+			auto state = stack.back();
+			stack.pop_back();
+			
+			if (buffers.visited_[state] == buffers.generation_)
+			{
+				continue;
+			}
+			
+			buffers.visited_[state] = buffers.generation_;
+			const auto& nfa_state = nfa_[state];
+			
+			switch (nfa_state.kind_)
+			{
+			case Nfa_state::bytes:
+			case Nfa_state::match:
+				result.push_back(state);
+				break;
+			case Nfa_state::split:
+				stack.push_back(nfa_state.alternative_);
+				stack.push_back(nfa_state.next_);
+				break;
+			case Nfa_state::epsilon:
+				if (nfa_state.next_ != -1)
+				{
+					stack.push_back(nfa_state.next_);
+				}
+				break;
+			case Nfa_state::begin_assertion:
+				if (at_begin)
+				{
+					stack.push_back(nfa_state.next_);
+				}
+				break;
+			case Nfa_state::end_assertion:
+				if (at_end)
+				{
+					stack.push_back(nfa_state.next_);
+				}
+				else
+				{
+					result.push_back(state);
+				}
+				break;
+			}
+		}
+		
+		std::ranges::sort(result);
+	}
+	
+	/*!
+	 * Computes the closure of the states following @p states after consuming
+	 * @p byte, including a new search starting at the following position, into
+	 * @p result.
+	 */
+	void step(std::span<const std::int32_t> states, unsigned char byte, Closure_buffers& buffers,
+		std::vector<std::int32_t>& next, std::vector<std::int32_t>& result) const
+	{
+		next.assign(1, root_);
+		
+		for (auto state : states)
+		{
+			if (nfa_[state].kind_ == Nfa_state::bytes and contains(byte_sets_[nfa_[state].byte_set_], byte))
+			{
+				next.push_back(nfa_[state].next_);
+			}
+		}
+		
+		closure(next, false, false, buffers, result);
+	}
+	
+	void add_matches(std::span<const std::int32_t> states, Bitset& matched) const noexcept
+	{
+		for (auto state : states)
+		{
+			if (nfa_[state].kind_ == Nfa_state::match)
+			{
+				matched.set(nfa_[state].pattern_);
+			}
+		}
+	}
+	
+	/*!
+	 * Matches @p text by simulating the NFA starting at the NFA states of the
+	 * DFA state @p state, used once the DFA is full.
+	 */
+	bool simulate(std::string_view text, std::int32_t state, Bitset* matched) const
+	{
+		auto states = std::vector<std::int32_t>();
+		
+		{
+			auto lock = std::lock_guard(dfa_->mutex_);
+			const auto& keys = dfa_->keys_;
+			states.assign(keys.begin() + dfa_->key_offsets_[state], keys.begin() + dfa_->key_offsets_[state + 1]);
+		}
+		
+		auto result = Bitset(size());
+		auto buffers = Closure_buffers();
+		auto next = std::vector<std::int32_t>();
+		auto following = std::vector<std::int32_t>();
+		
+		for (unsigned char c : text)
+		{
+			add_matches(states, result);
+			step(states, c, buffers, next, following);
+			std::swap(states, following);
+		}
+		
+		closure(states, false, true, buffers, following);
+		add_matches(following, result);
+		
+		if (matched)
+		{
+			*matched |= result;
+		}
+		
+		return result.any();
+	}
+	
+	static std::uint64_t hash(std::span<const std::int32_t> key) noexcept
+	{
+		auto result = std::uint64_t(0xcbf29ce484222325);
+		
+		for (auto state : key)
+		{
+			result = (result ^ static_cast<std::uint32_t>(state)) * 0x100000001b3;
+		}
+		
+		return result ^ (result >> 29);
+	}
+	
+	/*!
+	 * Finds or adds the DFA state whose key is Dfa::key_, must be called under
+	 * the mutex.
+	 * 
+	 * @return The index of the state or #unknown if the DFA is full.
+	 */
+	std::int32_t find_state() const
+	{
+		auto& dfa = *dfa_;
+		const auto& key = dfa.key_;
+		auto mask = std::ssize(dfa.table_) - 1;
+		auto slot = std::ptrdiff_t(hash(key)) & mask;
+		
+		for (; dfa.table_[slot] != unknown; slot = (slot + 1) & mask)
+		{
+			auto state = dfa.table_[slot];
+			auto begin = dfa.keys_.begin() + dfa.key_offsets_[state];
+			auto end = dfa.keys_.begin() + dfa.key_offsets_[state + 1];
+			
+			if (std::ranges::equal(begin, end, key.begin(), key.end()))
+			{
+				return state;
+			}
+		}
+		
+		auto state = static_cast<std::int32_t>(dfa.key_offsets_.size() - 1);
+		
+		if (state == max_dfa_states)
+		{
+			return unknown;
+		}
+		
+		if (state % chunk_size == 0)
+		{
+			auto& new_chunk = dfa.chunks_[state / chunk_size];
+			new_chunk = std::make_unique<Dfa::Chunk>();
+			auto transition_count = chunk_size * std::ssize(representatives_);
+			new_chunk->transitions_ = std::make_unique<std::atomic<std::int32_t>[]>(transition_count);
+			
+			for (std::ptrdiff_t i = 0; i != transition_count; ++i)
+			{
+				new_chunk->transitions_[i].store(unknown, std::memory_order_relaxed);
+			}
+		}
+		
+		auto& state_chunk = *dfa.chunks_[state / chunk_size];
+		auto& accept = state_chunk.accept_[state % chunk_size];
+		auto& accept_at_end = state_chunk.accept_at_end_[state % chunk_size];
+		accept = Bitset(size());
+		accept_at_end = Bitset(size());
+		add_matches(key, accept);
+		closure(key, false, true, dfa.buffers_, dfa.next_);
+		add_matches(dfa.next_, accept_at_end);
+		state_chunk.flags_[state % chunk_size] = static_cast<std::uint8_t>((accept.any() ? accepting : 0) | (accept_at_end.any() ? accepting_at_end : 0));
+		
+		dfa.keys_.insert(dfa.keys_.end(), key.begin(), key.end());
+		dfa.key_offsets_.push_back(static_cast<std::int32_t>(dfa.keys_.size()));
+		dfa.table_[slot] = state;
+		
+		// The table is kept at most half full
+		if (2 * (state + 1) > std::ssize(dfa.table_))
+		{
+			auto table = std::vector<std::int32_t>(2 * dfa.table_.size(), unknown);
+			mask = std::ssize(table) - 1;
+			
+			for (std::int32_t existing = 0; existing <= state; ++existing)
+			{
+				auto begin = dfa.keys_.data() + dfa.key_offsets_[existing];
+				auto end = dfa.keys_.data() + dfa.key_offsets_[existing + 1];
+				slot = std::ptrdiff_t(hash(std::span(begin, end))) & mask;
+				
+				while (table[slot] != unknown)
+				{
+					slot = (slot + 1) & mask;
+				}
+				
+				table[slot] = existing;
+			}
+			
+			dfa.table_ = std::move(table);
+		}
+		
+		return state;
+	}
+	
+	/*!
+	 * Builds the transition of @p state on @p byte_class.
+	 * 
+	 * @return The target state or #unknown if the DFA is full.
+	 */
+	std::int32_t add_transition(std::int32_t state, std::uint8_t byte_class) const
+	{
+		auto& dfa = *dfa_;
+		auto lock = std::lock_guard(dfa.mutex_);
+		
+		if (auto existing = transition(state, byte_class).load(std::memory_order_relaxed); existing != unknown)
+		{
+			return existing;
+		}
+		
+		auto begin = dfa.keys_.data() + dfa.key_offsets_[state];
+		auto end = dfa.keys_.data() + dfa.key_offsets_[state + 1];
+		step(std::span(begin, end), representatives_[byte_class], dfa.buffers_, dfa.next_, dfa.key_);
+		auto result = find_state();
+		
+		if (result != unknown)
+		{
+			transition(state, byte_class).store(result, std::memory_order_release);
+		}
+		
+		return result;
+	}
+	
+	//! Splits the bytes into classes of bytes which no byte set tells apart.
+	void find_byte_classes()
+	{
+		auto signatures = std::map<std::vector<bool>, std::uint8_t>();
+		
+		for (int byte = 0; byte != 256; ++byte)
+		{
+			auto signature = std::vector<bool>(byte_sets_.size());
+			
+			for (std::size_t i = 0; i != byte_sets_.size(); ++i)
+			{
+				signature[i] = contains(byte_sets_[i], static_cast<unsigned char>(byte));
+			}
+			
+			auto [it, inserted] = signatures.try_emplace(std::move(signature), static_cast<std::uint8_t>(representatives_.size()));
+			
+			if (inserted)
+			{
+				representatives_.push_back(static_cast<unsigned char>(byte));
+			}
+			
+			byte_classes_[byte] = it->second;
+		}
+		
+		// The empty text is both at the beginning and at the end
+		auto buffers = Closure_buffers();
+		auto states = std::vector<std::int32_t>();
+		matches_empty_ = Bitset(size());
+		closure(std::span(&root_, 1), true, true, buffers, states);
+		add_matches(states, matches_empty_);
+	}
+	
+	//! Makes an empty DFA containing only the start state.
+	void reset_dfa()
+	{
+		dfa_ = std::make_unique<Dfa>();
+		dfa_->table_.assign(64, unknown);
+		closure(std::span(&root_, 1), true, false, dfa_->buffers_, dfa_->key_);
+		find_state();
+	}
+	
+	std::vector<std::string> patterns_;
+	std::vector<Nfa_state> nfa_;
+	std::vector<Byte_set> byte_sets_;
+	std::map<Byte_set, std::int32_t> byte_set_indices_;
+	std::int32_t root_ = -1;
+	
+	Bitset matches_empty_;
+	
+	std::array<std::uint8_t, 256> byte_classes_ {};
+	
+	//! A byte of each class
+	std::vector<unsigned char> representatives_;
+	
+	std::unique_ptr<Dfa> dfa_;
+};
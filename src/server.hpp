@@ -0,0 +1,452 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+
+#include <array>
+#include <chrono>
+#include <filesystem>
+#include <map>
+#include <memory>
+#include <optional>
+#include <span>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include "java_symbols.hpp"
+
+/*!
+ * The Parameters of the recently used sets of matchers and flags of a resident
+ * process, so that the patterns of a repeated invocation are not compiled
+ * again. The arguments are copied into the cache together with the
+ * Parameters which refer to them.
+ */
+struct Parameters_cache
+{
+	//! The number of sets of matchers kept, the least recently used is dropped
+	static constexpr std::ptrdiff_t capacity = 64;
+	
+	/*!
+	 * @return The Parameters interpreted from the matchers and flags of
+	 * @p parameter_dict, file paths and other options are ignored.
+	 * 
+	 * @throws std::invalid_argument If interpret_args throws it.
+	 */
+	const Parameters& find(const Parameter_dict& parameter_dict)
+	{
+		constexpr auto flags = std::array<std::string_view, 8>
+		{
+			"-n", "-p", "-m", "-a", "-i", "--in-place", "-s", "--strict",
+		};
+		
+		auto key = std::string();
+		
+		for (auto flag : flags)
+		{
+			if (auto it = parameter_dict.find(flag); it != parameter_dict.end())
+			{
+				key += flag;
+				
+				for (auto value : it->second)
+				{
+					key += ' ';
+					key += std::to_string(value.size());
+					key += ':';
+					key += value;
+				}
+				
+				key += '\n';
+			}
+		}
+		
+		++uses_;
+		
+		if (auto it = entries_.find(key); it != entries_.end())
+		{
+			it->second->last_use_ = uses_;
+			return it->second->parameters_;
+		}
+		
+		auto entry = std::make_unique<Entry>();
+		
+		for (auto flag : flags)
+		{
+			if (auto it = parameter_dict.find(flag); it != parameter_dict.end())
+			{
+				entry->strings_.emplace_back(flag);
+				entry->strings_.insert(entry->strings_.end(), it->second.begin(), it->second.end());
+			}
+		}
+		
+		// Views are taken only after all the strings are in place
+		auto arguments = Parameter_dict();
+		
+		for (auto it = entry->strings_.begin(); it != entry->strings_.end();)
+		{
+			auto& values = arguments[*it];
+			auto count = parameter_dict.find(*it)->second.size();
+			++it;
+			
+			for (; count != 0; --count, ++it)
+			{
+				values.emplace_back(*it);
+			}
+		}
+		
+		entry->parameters_ = java_symbols::interpret_args(arguments);
+		entry->last_use_ = uses_;
+		
+		if (std::ssize(entries_) == capacity)
+		{
+			entries_.erase(std::ranges::min_element(entries_, {}, [](const auto& pair) noexcept -> std::uint64_t
+			{
+				return pair.second->last_use_;
+			}));
+		}
+		
+		return entries_.try_emplace(std::move(key), std::move(entry)).first->second->parameters_;
+	}
+	
+private:
+	struct Entry
+	{
+		std::vector<std::string> strings_;
+		Parameters parameters_;
+		std::uint64_t last_use_ = 0;
+	};
+	
+	std::uint64_t uses_ = 0;
+	std::map<std::string, std::unique_ptr<Entry>, std::less<>> entries_;
+};
+
+/*!
+ * An invocation forwarded by a client to a resident process over a Unix
+ * socket: the working directory and arguments of the client together with its
+ * standard input, output and error output, so that the resident process can
+ * read and write them directly.
+ * 
+ * The request is a header with the descriptors attached, followed by the
+ * directory and the arguments, each terminated by a null character. The
+ * response is the exit code.
+ */
+struct Server_request
+{
+	//! The time a peer has to send its whole request
+	static constexpr auto default_timeout = std::chrono::milliseconds(10'000);
+	
+	Server_request() = default;
+	
+	Server_request(const Server_request&) = delete;
+	Server_request& operator=(const Server_request&) = delete;
+	
+	~Server_request()
+	{
+		for (int fd : fds_)
+		{
+			if (fd != -1)
+			{
+				::close(fd);
+			}
+		}
+	}
+	
+	/*!
+	 * Sends a request with @p arguments and the working directory and
+	 * standard streams of the current process over @p socket.
+	 * 
+	 * @throws std::system_error If the request could not be sent.
+	 */
+	static void send(int socket, std::span<const char* const> arguments)
+	{
+		auto payload = std::filesystem::current_path().native();
+		payload += '\0';
+		
+		for (std::string_view argument : arguments)
+		{
+			payload += argument;
+			payload += '\0';
+		}
+		
+		auto header = Header(magic, static_cast<std::uint32_t>(payload.size()));
+		auto fds = std::array<int, 3>({STDIN_FILENO, STDOUT_FILENO, STDERR_FILENO});
+		
+		alignas(::cmsghdr) char control[CMSG_SPACE(sizeof(fds))] = {};
+		auto data = ::iovec(&header, sizeof(header));
+		auto message = ::msghdr();
+		message.msg_iov = &data;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+		
+		auto* control_message = CMSG_FIRSTHDR(&message);
+		control_message->cmsg_level = SOL_SOCKET;
+		control_message->cmsg_type = SCM_RIGHTS;
+		control_message->cmsg_len = CMSG_LEN(sizeof(fds));
+		std::memcpy(CMSG_DATA(control_message), fds.data(), sizeof(fds));
+		
+		if (::sendmsg(socket, &message, MSG_NOSIGNAL) != sizeof(header))
+		{
+			throw std::system_error(errno, std::generic_category(), "Could not send the request");
+		}
+		
+		write_all(socket, payload);
+	}
+	
+	/*!
+	 * Receives a request from @p socket, waiting at most @p timeout for the
+	 * whole request so that a peer which stops sending does not hold up the
+	 * following requests.
+	 * 
+	 * @return False if the peer did not send a valid request in time.
+	 */
+	bool receive(int socket, std::chrono::milliseconds timeout = default_timeout)
+	{
+		auto deadline = std::chrono::steady_clock::now() + timeout;
+		auto header = Header();
+		alignas(::cmsghdr) char control[CMSG_SPACE(sizeof(fds_))] = {};
+		auto data = ::iovec(&header, sizeof(header));
+		auto message = ::msghdr();
+		message.msg_iov = &data;
+		message.msg_iovlen = 1;
+		message.msg_control = control;
+		message.msg_controllen = sizeof(control);
+		
+		if (not wait_readable(socket, deadline) or ::recvmsg(socket, &message, MSG_CMSG_CLOEXEC) != sizeof(header))
+		{
+			return false;
+		}
+		
+		for (auto* control_message = CMSG_FIRSTHDR(&message); control_message; control_message = CMSG_NXTHDR(&message, control_message))
+		{
+			if (control_message->cmsg_level == SOL_SOCKET and control_message->cmsg_type == SCM_RIGHTS
+				and control_message->cmsg_len == CMSG_LEN(sizeof(fds_)))
+			{
+				std::memcpy(fds_.data(), CMSG_DATA(control_message), sizeof(fds_));
+			}
+		}
+		
+		if (header.magic_ != magic or header.size_ > max_size or (message.msg_flags & MSG_CTRUNC)
+			or std::ranges::find(fds_, -1) != fds_.end())
+		{
+			return false;
+		}
+		
+		auto payload = std::string(header.size_, '\0');
+		
+		for (auto position = std::size_t(0); position != payload.size();)
+		{
+			if (not wait_readable(socket, deadline))
+			{
+				return false;
+			}
+			
+			auto result = ::read(socket, payload.data() + position, payload.size() - position);
+			
+			if (result <= 0 and not (result == -1 and errno == EINTR))
+			{
+				return false;
+			}
+			
+			position += std::max<::ssize_t>(result, 0);
+		}
+		
+		if (not payload.ends_with('\0'))
+		{
+			return false;
+		}
+		
+		for (auto position = std::size_t(0); position != payload.size();)
+		{
+			auto end = payload.find('\0', position);
+			(position == 0 ? directory_ : arguments_.emplace_back()) = payload.substr(position, end - position);
+			position = end + 1;
+		}
+		
+		return true;
+	}
+	
+	//! Sends the @p exit_code of a request over @p socket.
+	static void send_exit_code(int socket, int exit_code)
+	{
+		auto value = static_cast<std::int32_t>(exit_code);
+		write_all(socket, std::string_view(reinterpret_cast<const char*>(&value), sizeof(value)));
+	}
+	
+	//! @return The exit code received from @p socket or `std::nullopt` on failure.
+	static std::optional<int> receive_exit_code(int socket)
+	{
+		auto value = std::int32_t();
+		auto position = std::size_t(0);
+		
+		while (position != sizeof(value))
+		{
+			auto result = ::read(socket, reinterpret_cast<char*>(&value) + position, sizeof(value) - position);
+			
+			if (result <= 0 and not (result == -1 and errno == EINTR))
+			{
+				return std::nullopt;
+			}
+			
+			position += std::max<::ssize_t>(result, 0);
+		}
+		
+		return value;
+	}
+	
+	std::string directory_;
+	std::vector<std::string> arguments_;
+	
+	//! The standard input, output and error output of the client
+	std::array<int, 3> fds_ = {-1, -1, -1};
+	
+private:
+	static constexpr std::uint32_t magic = 0x6a726e31;
+	static constexpr std::uint32_t max_size = 64 * 1024 * 1024;
+	
+	struct Header
+	{
+		std::uint32_t magic_ = 0;
+		std::uint32_t size_ = 0;
+	};
+	
+	//! @return False if nothing can be read from @p socket until @p deadline.
+	static bool wait_readable(int socket, std::chrono::steady_clock::time_point deadline) noexcept
+	{
+		while (true)
+		{
+			auto remaining = std::chrono::ceil<std::chrono::milliseconds>(deadline - std::chrono::steady_clock::now());
+			
+			if (remaining.count() <= 0)
+			{
+				return false;
+			}
+			
+			auto descriptor = ::pollfd(socket, POLLIN, 0);
+			auto result = ::poll(&descriptor, 1, static_cast<int>(std::min<std::int64_t>(remaining.count(), 60'000)));
+			
+			if (result == 1)
+			{
+				return true;
+			}
+			else if (result == -1 and errno != EINTR)
+			{
+				return false;
+			}
+		}
+	}
+	
+	static void write_all(int socket, std::string_view data)
+	{
+		while (not data.empty())
+		{
+			auto result = ::send(socket, data.data(), data.size(), MSG_NOSIGNAL);
+			
+			if (result == -1 and errno == EINTR)
+			{
+				continue;
+			}
+			else if (result == -1)
+			{
+				throw std::system_error(errno, std::generic_category(), "Could not write to the socket");
+			}
+			
+			data.remove_prefix(result);
+		}
+	}
+};
+
+//! @return The address of the Unix socket at @p path.
+inline ::sockaddr_un socket_address(const std::filesystem::path& path)
+{
+	auto result = ::sockaddr_un();
+	result.sun_family = AF_UNIX;
+	
+	if (path.native().size() >= sizeof(result.sun_path))
+	{
+		throw std::system_error(std::make_error_code(std::errc::filename_too_long), "Socket path is too long: " + path.native());
+	}
+	
+	std::memcpy(result.sun_path, path.c_str(), path.native().size());
+	
+	return result;
+}
+
+/*!
+ * @return A socket listening at @p path which only the current user can
+ * connect to. A stale socket file at @p path is replaced.
+ * 
+ * @throws std::system_error If the socket could not be created, for example
+ * because another process listens at @p path.
+ */
+inline int listen_socket(const std::filesystem::path& path)
+{
+	auto address = socket_address(path);
+	int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	
+	if (fd == -1)
+	{
+		throw std::system_error(errno, std::generic_category(), "Could not create a socket");
+	}
+	
+	if (::connect(fd, reinterpret_cast<const ::sockaddr*>(&address), sizeof(address)) == 0)
+	{
+		::close(fd);
+		throw std::system_error(std::make_error_code(std::errc::address_in_use), "Another server listens at " + path.native());
+	}
+	
+	::close(fd);
+	fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	
+	if (struct ::stat status; ::lstat(path.c_str(), &status) == 0 and S_ISSOCK(status.st_mode))
+	{
+		::unlink(path.c_str());
+	}
+	
+	auto mask = ::umask(0077);
+	bool bound = fd != -1 and ::bind(fd, reinterpret_cast<const ::sockaddr*>(&address), sizeof(address)) == 0;
+	::umask(mask);
+	
+	if (not bound or ::listen(fd, SOMAXCONN) == -1)
+	{
+		auto error = errno;
+		
+		if (fd != -1)
+		{
+			::close(fd);
+		}
+		
+		throw std::system_error(error, std::generic_category(), "Could not listen at " + path.native());
+	}
+	
+	return fd;
+}
+
+//! @return A socket connected to @p path or `-1` if no server listens there.
+inline int connect_socket(const std::filesystem::path& path) noexcept
+{
+	if (path.native().size() >= sizeof(::sockaddr_un::sun_path))
+	{
+		return -1;
+	}
+	
+	auto address = socket_address(path);
+	int fd = ::socket(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0);
+	
+	if (fd != -1 and ::connect(fd, reinterpret_cast<const ::sockaddr*>(&address), sizeof(address)) == -1)
+	{
+		::close(fd);
+		fd = -1;
+	}
+	
+	return fd;
+}
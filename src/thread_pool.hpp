@@ -0,0 +1,331 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <exception>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+/*!
+ * Threads which are kept between runs of a function on several of them, so
+ * that a resident process does not start new threads for every request and
+ * the thread local buffers stay allocated.
+ */
+struct Thread_pool
+{
+	Thread_pool() = default;
+	
+	Thread_pool(const Thread_pool&) = delete;
+	Thread_pool& operator=(const Thread_pool&) = delete;
+	
+	~Thread_pool()
+	{
+		{
+			auto lock = std::lock_guard(mutex_);
+			stopping_ = true;
+		}
+		
+		start_.notify_all();
+		
+		for (auto& thread : threads_)
+		{
+			thread.join();
+		}
+	}
+	
+	[[nodiscard]] std::ptrdiff_t size() const noexcept
+	{
+		return std::ssize(threads_);
+	}
+	
+	/*!
+	 * Calls @p function with the indices `0` to @p count - 1, each on a
+	 * different thread, and waits for all the calls to return. Threads are
+	 * started if the pool has less than @p count of them. Must not be called
+	 * concurrently.
+	 */
+	void run(std::ptrdiff_t count, const std::function<void(std::ptrdiff_t)>& function)
+	{
+		auto lock = std::unique_lock(mutex_);
+		
+		while (std::ssize(threads_) < count)
+		{
+			threads_.emplace_back(&Thread_pool::loop, this, std::ssize(threads_), generation_);
+		}
+		
+		function_ = &function;
+		count_ = count;
+		remaining_ = count;
+		++generation_;
+		start_.notify_all();
+		finished_.wait(lock, [&]() noexcept -> bool {return remaining_ == 0;});
+		function_ = nullptr;
+	}
+	
+private:
+	void loop(std::ptrdiff_t index, std::uint64_t generation)
+	{
+		auto lock = std::unique_lock(mutex_);
+		
+		while (true)
+		{
+			start_.wait(lock, [&]() noexcept -> bool {return stopping_ or generation_ != generation;});
+			
+			if (stopping_)
+			{
+				return;
+			}
+			
+			generation = generation_;
+			
+			if (index >= count_)
+			{
+				continue;
+			}
+			
+			const auto& function = *function_;
+			lock.unlock();
+			function(index);
+			lock.lock();
+			
+			if (--remaining_ == 0)
+			{
+				finished_.notify_one();
+			}
+		}
+	}
+	
+	std::mutex mutex_;
+	std::condition_variable start_;
+	std::condition_variable finished_;
+	std::vector<std::thread> threads_;
+	const std::function<void(std::ptrdiff_t)>* function_ = nullptr;
+	std::ptrdiff_t count_ = 0;
+	std::ptrdiff_t remaining_ = 0;
+	std::uint64_t generation_ = 0;
+	bool stopping_ = false;
+};
+
+/*!
+ * Threads which help the threads of the process with the parts of a piece of
+ * work which they split. The helpers are shared, so several threads splitting
+ * work at once do not start threads of their own and oversubscribe the CPU:
+ * a helper only takes a part while fewer threads than the pool size plus one,
+ * the number of cores, are busy. Threads are busy while they help or hold a
+ * Busy scope, so a pool of workers which hold one while handling their tasks
+ * is only helped on the cores of its idle workers.
+ */
+struct Helper_pool
+{
+	//! Counts the current thread as busy during the lifetime of the scope
+	struct Busy
+	{
+		explicit Busy(Helper_pool& pool) noexcept
+			:
+			pool_(pool)
+		{
+			pool_.busy_.fetch_add(1, std::memory_order_relaxed);
+		}
+		
+		Busy(const Busy&) = delete;
+		Busy& operator=(const Busy&) = delete;
+		
+		~Busy()
+		{
+			pool_.busy_.fetch_sub(1, std::memory_order_relaxed);
+		}
+		
+	private:
+		Helper_pool& pool_;
+	};
+	
+	//! @param size The maximum number of helper threads, started when first needed.
+	explicit Helper_pool(std::ptrdiff_t size) noexcept
+		:
+		size_(size)
+	{
+	}
+	
+	Helper_pool(const Helper_pool&) = delete;
+	Helper_pool& operator=(const Helper_pool&) = delete;
+	
+	~Helper_pool()
+	{
+		{
+			auto lock = std::lock_guard(mutex_);
+			stopping_ = true;
+		}
+		
+		start_.notify_all();
+		
+		for (auto& thread : threads_)
+		{
+			thread.join();
+		}
+	}
+	
+	[[nodiscard]] std::ptrdiff_t size() const noexcept
+	{
+		return size_;
+	}
+	
+	//! @return The number of helpers which could take a part now.
+	[[nodiscard]] std::ptrdiff_t available() const noexcept
+	{
+		auto lock = std::lock_guard(mutex_);
+		return std::clamp<std::ptrdiff_t>(free_cores(), 0, size_);
+	}
+	
+	/*!
+	 * Calls @p function with the indices `0` to @p count - 1 on the current
+	 * thread and on the helpers which are available, and waits for all the
+	 * calls to return. Rethrows the first exception thrown by the calls. May
+	 * be called concurrently.
+	 */
+	void run(std::ptrdiff_t count, const std::function<void(std::ptrdiff_t)>& function)
+	{
+		auto work = Work {&function, count};
+		auto lock = std::unique_lock(mutex_);
+		
+		if (count == 0)
+		{
+			return;
+		}
+		
+		if (count > 1 and size_ != 0)
+		{
+			while (std::ssize(threads_) < size_)
+			{
+				threads_.emplace_back(&Helper_pool::loop, this);
+			}
+			
+			works_.push_back(&work);
+			start_.notify_all();
+		}
+		
+		for (auto index = claim(work); index != -1; index = claim(work))
+		{
+			lock.unlock();
+			auto exception = call(work, index);
+			lock.lock();
+			complete(work, std::move(exception));
+		}
+		
+		finished_.wait(lock, [&]() noexcept -> bool {return work.remaining_ == 0;});
+		
+		if (work.exception_)
+		{
+			std::rethrow_exception(work.exception_);
+		}
+	}
+	
+private:
+	struct Work
+	{
+		const std::function<void(std::ptrdiff_t)>* function_;
+		std::ptrdiff_t count_;
+		std::ptrdiff_t next_ = 0;
+		std::ptrdiff_t remaining_ = count_;
+		std::exception_ptr exception_ = nullptr;
+	};
+	
+	//! @return The number of cores not used by busy threads, must be called with the mutex locked.
+	std::ptrdiff_t free_cores() const noexcept
+	{
+		return size_ + 1 - busy_.load(std::memory_order_relaxed) - helping_;
+	}
+	
+	//! @return The next index of @p work or `-1`, must be called with the mutex locked.
+	std::ptrdiff_t claim(Work& work)
+	{
+		if (work.next_ == work.count_)
+		{
+			return -1;
+		}
+		
+		auto result = work.next_++;
+		
+		if (work.next_ == work.count_)
+		{
+			std::erase(works_, &work);
+		}
+		
+		return result;
+	}
+	
+	static std::exception_ptr call(const Work& work, std::ptrdiff_t index) noexcept
+	{
+		try
+		{
+			(*work.function_)(index);
+		}
+		catch (...)
+		{
+			return std::current_exception();
+		}
+		
+		return nullptr;
+	}
+	
+	//! Must be called with the mutex locked.
+	void complete(Work& work, std::exception_ptr exception)
+	{
+		if (exception and not work.exception_)
+		{
+			work.exception_ = std::move(exception);
+		}
+		
+		if (--work.remaining_ == 0)
+		{
+			finished_.notify_all();
+		}
+	}
+	
+	void loop()
+	{
+		auto lock = std::unique_lock(mutex_);
+		
+		while (true)
+		{
+			start_.wait(lock, [&]() noexcept -> bool
+			{
+				return stopping_ or (not works_.empty() and free_cores() > 0);
+			});
+			
+			if (stopping_)
+			{
+				return;
+			}
+			
+			auto& work = *works_.front();
+			auto index = claim(work);
+			++helping_;
+			lock.unlock();
+			auto exception = call(work, index);
+			lock.lock();
+			--helping_;
+			complete(work, std::move(exception));
+			
+			if (not works_.empty())
+			{
+				start_.notify_one();
+			}
+		}
+	}
+	
+	const std::ptrdiff_t size_;
+	mutable std::mutex mutex_;
+	std::condition_variable start_;
+	std::condition_variable finished_;
+	std::vector<std::thread> threads_;
+	std::vector<Work*> works_;
+	std::atomic<std::ptrdiff_t> busy_ = 0;
+	std::ptrdiff_t helping_ = 0;
+	bool stopping_ = false;
+};
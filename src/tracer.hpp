@@ -0,0 +1,225 @@
+#pragma once
+
+#include <cstdint>
+
+#include <atomic>
+#include <chrono>
+#include <filesystem>
+#include <fstream>
+#include <iomanip>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+/*!
+ * Collects spans of time into a file in the Trace Event Format, which can be
+ * viewed in Perfetto or chrome://tracing. Every thread has its own track and
+ * appends to its own buffer without locking, asynchronous spans of all threads
+ * are shown on shared tracks.
+ */
+struct Tracer
+{
+	Tracer() noexcept
+		:
+		id_(next_id_.fetch_add(1, std::memory_order_relaxed)),
+		start_(std::chrono::steady_clock::now())
+	{
+	}
+	
+	//! Names the track of the current thread.
+	void name_thread(std::string name)
+	{
+		record().name_ = std::move(name);
+	}
+	
+	/*!
+	 * Adds a span named @p name to the track of the current thread. The name
+	 * must outlive the tracer, @p detail is copied.
+	 */
+	void add(std::string_view name, std::chrono::steady_clock::time_point begin,
+		std::chrono::steady_clock::time_point end, std::string_view detail = {})
+	{
+		record().events_.push_back(Event(name, std::string(detail), begin - start_, end - begin, false));
+	}
+	
+	/*!
+	 * Same as add but the span is added to a track named @p name shared by
+	 * all threads, where spans may overlap.
+	 */
+	void add_async(std::string_view name, std::chrono::steady_clock::time_point begin,
+		std::chrono::steady_clock::time_point end, std::string_view detail = {})
+	{
+		record().events_.push_back(Event(name, std::string(detail), begin - start_, end - begin, true));
+	}
+	
+	/*!
+	 * Writes the collected spans to @p path, must not be called concurrently
+	 * with adding spans.
+	 * 
+	 * @throws std::system_error If the file could not be written.
+	 */
+	void write(const std::filesystem::path& path) const
+	{
+		auto stream = std::ofstream(path);
+		stream << std::fixed << std::setprecision(3);
+		stream << "{\"displayTimeUnit\": \"ms\", \"traceEvents\": [\n";
+		stream << "{\"ph\": \"M\", \"pid\": 1, \"name\": \"process_name\", \"args\": {\"name\": \"jurand\"}}";
+		
+		auto lock = std::lock_guard(mutex_);
+		auto async_id = std::uint64_t(0);
+		
+		for (std::size_t tid = 0; tid != records_.size(); ++tid)
+		{
+			const auto& record = *records_[tid];
+			auto name = record.name_.empty() ? "thread " + std::to_string(tid) : record.name_;
+			
+			stream << ",\n{\"ph\": \"M\", \"pid\": 1, \"tid\": " << tid
+				<< ", \"name\": \"thread_name\", \"args\": {\"name\": " << quoted(name) << "}}";
+			stream << ",\n{\"ph\": \"M\", \"pid\": 1, \"tid\": " << tid
+				<< ", \"name\": \"thread_sort_index\", \"args\": {\"sort_index\": " << tid << "}}";
+			
+			for (const auto& event : record.events_)
+			{
+				auto begin = std::chrono::duration<double, std::micro>(event.begin_).count();
+				auto duration = std::chrono::duration<double, std::micro>(event.duration_).count();
+				auto args = event.detail_.empty() ? std::string() : ", \"args\": {\"path\": " + quoted(event.detail_) + "}";
+				
+				if (event.async_)
+				{
+					++async_id;
+					stream << ",\n{\"ph\": \"b\", \"cat\": " << quoted(event.name_) << ", \"name\": " << quoted(event.name_)
+						<< ", \"id\": " << async_id << ", \"pid\": 1, \"tid\": " << tid << ", \"ts\": " << begin << args << "}";
+					stream << ",\n{\"ph\": \"e\", \"cat\": " << quoted(event.name_) << ", \"name\": " << quoted(event.name_)
+						<< ", \"id\": " << async_id << ", \"pid\": 1, \"tid\": " << tid << ", \"ts\": " << begin + duration << "}";
+				}
+				else
+				{
+					stream << ",\n{\"ph\": \"X\", \"name\": " << quoted(event.name_)
+						<< ", \"pid\": 1, \"tid\": " << tid << ", \"ts\": " << begin << ", \"dur\": " << duration << args << "}";
+				}
+			}
+		}
+		
+		stream << "\n]}\n";
+		stream.close();
+		
+		if (not stream)
+		{
+			throw std::system_error(std::make_error_code(std::errc::io_error), "Could not write trace file " + path.native());
+		}
+	}
+	
+	//! @return @p value as a quoted JSON string.
+	static std::string quoted(std::string_view value)
+	{
+		auto result = std::string("\"");
+		
+		for (char c : value)
+		{
+			if (c == '"' or c == '\\')
+			{
+				result += '\\';
+				result += c;
+			}
+			else if (static_cast<unsigned char>(c) < 0x20)
+			{
+				constexpr auto digits = std::string_view("0123456789abcdef");
+				result += "\\u00";
+				result += digits[c >> 4];
+				result += digits[c & 0xf];
+			}
+			else
+			{
+				result += c;
+			}
+		}
+		
+		result += '"';
+		
+		return result;
+	}
+	
+private:
+	struct Event
+	{
+		std::string_view name_;
+		std::string detail_;
+		std::chrono::nanoseconds begin_;
+		std::chrono::nanoseconds duration_;
+		bool async_;
+	};
+	
+	struct Record
+	{
+		std::string name_;
+		std::vector<Event> events_;
+	};
+	
+	Record& record()
+	{
+		thread_local auto current_id = std::uint64_t(0);
+		thread_local auto current = static_cast<Record*>(nullptr);
+		
+		if (current_id != id_)
+		{
+			auto record = std::make_unique<Record>();
+			current = record.get();
+			current_id = id_;
+			auto lock = std::lock_guard(mutex_);
+			records_.push_back(std::move(record));
+		}
+		
+		return *current;
+	}
+	
+	inline static auto next_id_ = std::atomic<std::uint64_t>(1);
+	
+	std::uint64_t id_;
+	std::chrono::steady_clock::time_point start_;
+	mutable std::mutex mutex_;
+	std::vector<std::unique_ptr<Record>> records_;
+};
+
+/*!
+ * Adds a span from its construction to its destruction to the track of the
+ * current thread in a tracer, if there is one.
+ */
+struct Trace_span
+{
+	/*!
+	 * @param tracer The tracer or null if tracing is disabled.
+	 * @param name Must outlive the tracer.
+	 * @param detail Must outlive the span.
+	 */
+	explicit Trace_span(Tracer* tracer, std::string_view name, std::string_view detail = {}) noexcept
+		:
+		tracer_(tracer),
+		name_(name),
+		detail_(detail)
+	{
+		if (tracer_)
+		{
+			begin_ = std::chrono::steady_clock::now();
+		}
+	}
+	
+	Trace_span(const Trace_span&) = delete;
+	Trace_span& operator=(const Trace_span&) = delete;
+	
+	~Trace_span()
+	{
+		if (tracer_)
+		{
+			tracer_->add(name_, begin_, std::chrono::steady_clock::now(), detail_);
+		}
+	}
+	
+private:
+	Tracer* tracer_;
+	std::string_view name_;
+	std::string_view detail_;
+	std::chrono::steady_clock::time_point begin_;
+};
@@ -0,0 +1,186 @@
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <optional>
+#include <vector>
+
+/*!
+ * Distributes chunks of tasks among a fixed number of worker threads, where
+ * handling a chunk may push more chunks. Every worker has its own heap of
+ * chunks ordered by weight, it takes the heaviest chunk of its own heap and
+ * when it is empty, it steals the heaviest chunk of another worker. Each heap
+ * has its own lock and the number of queued chunks is atomic, so the shared
+ * lock is only taken by workers which wait because all the heaps are empty and
+ * by pushes which wake them. The scheduler is finished once all heaps are
+ * empty and no popped chunk is still being handled. The @p Weight of chunks is
+ * any type ordered by `<`.
+ */
+template<typename Task, typename Weight = std::uintmax_t>
+struct Work_scheduler
+{
+	struct Chunk
+	{
+		Weight weight_ = Weight();
+		std::vector<Task> tasks_;
+		
+		bool operator<(const Chunk& other) const noexcept
+		{
+			return weight_ < other.weight_;
+		}
+	};
+	
+	explicit Work_scheduler(std::ptrdiff_t worker_count)
+		:
+		heaps_(worker_count)
+	{
+	}
+	
+	[[nodiscard]] std::ptrdiff_t worker_count() const noexcept
+	{
+		return std::ssize(heaps_);
+	}
+	
+	//! Pushes @p chunks to the heap of @p worker.
+	void push(std::ptrdiff_t worker, std::vector<Chunk>&& chunks)
+	{
+		if (chunks.empty())
+		{
+			return;
+		}
+		
+		pending_.fetch_add(std::ssize(chunks), std::memory_order_relaxed);
+		
+		{
+			auto& heap = heaps_[worker];
+			auto lock = std::lock_guard(heap.mutex_);
+			
+			for (auto& chunk : chunks)
+			{
+				heap.chunks_.push_back(std::move(chunk));
+				std::push_heap(heap.chunks_.begin(), heap.chunks_.end());
+			}
+			
+			heap.size_.store(std::ssize(heap.chunks_), std::memory_order_relaxed);
+			
+			// Either a waiting worker is seen below or it sees the queued
+			// chunks before it sleeps, both are sequentially consistent
+			queued_.fetch_add(std::ssize(chunks));
+		}
+		
+		if (waiting_.load() != 0)
+		{
+			{
+				auto lock = std::lock_guard(mutex_);
+			}
+			
+			condition_.notify_all();
+		}
+	}
+	
+	/*!
+	 * Takes a chunk for @p worker, waiting if other workers may still push more
+	 * chunks. Every popped chunk must be followed by a call to done().
+	 * 
+	 * @return The chunk or std::nullopt if the scheduler is finished.
+	 */
+	std::optional<Chunk> pop(std::ptrdiff_t worker)
+	{
+		while (true)
+		{
+			// The count may be briefly ahead of the heaps while another worker
+			// takes a chunk, then the heaps are scanned again
+			while (queued_.load(std::memory_order_acquire) != 0)
+			{
+				for (std::ptrdiff_t i = 0; i != worker_count(); ++i)
+				{
+					if (auto result = take(heaps_[(worker + i) % worker_count()]))
+					{
+						return result;
+					}
+				}
+			}
+			
+			auto lock = std::unique_lock(mutex_);
+			waiting_.fetch_add(1);
+			condition_.wait(lock, [&]() noexcept -> bool
+			{
+				return queued_.load() != 0 or pending_.load(std::memory_order_acquire) == 0;
+			});
+			waiting_.fetch_sub(1);
+			
+			if (queued_.load() == 0)
+			{
+				return std::nullopt;
+			}
+		}
+	}
+	
+	//! Marks a popped chunk as handled, including pushing its follow-up chunks.
+	void done()
+	{
+		if (pending_.fetch_sub(1, std::memory_order_acq_rel) == 1)
+		{
+			// Taking the lock orders the notification after a concurrent
+			// check of the waiting condition
+			{
+				auto lock = std::lock_guard(mutex_);
+			}
+			
+			condition_.notify_all();
+		}
+	}
+	
+private:
+	struct Heap
+	{
+		std::mutex mutex_;
+		std::vector<Chunk> chunks_;
+		
+		//! The size of chunks_, read without the lock to skip empty heaps
+		std::atomic<std::ptrdiff_t> size_ = 0;
+	};
+	
+	std::optional<Chunk> take(Heap& heap)
+	{
+		if (heap.size_.load(std::memory_order_relaxed) == 0)
+		{
+			return std::nullopt;
+		}
+		
+		auto lock = std::lock_guard(heap.mutex_);
+		
+		if (heap.chunks_.empty())
+		{
+			return std::nullopt;
+		}
+		
+		std::pop_heap(heap.chunks_.begin(), heap.chunks_.end());
+		auto result = std::optional<Chunk>(std::move(heap.chunks_.back()));
+		heap.chunks_.pop_back();
+		heap.size_.store(std::ssize(heap.chunks_), std::memory_order_relaxed);
+		queued_.fetch_sub(1, std::memory_order_relaxed);
+		
+		return result;
+	}
+	
+	std::vector<Heap> heaps_;
+	
+	//! The number of chunks which were pushed and are not done yet
+	std::atomic<std::ptrdiff_t> pending_ = 0;
+	
+	//! The number of chunks in the heaps
+	std::atomic<std::ptrdiff_t> queued_ = 0;
+	
+	//! The number of workers waiting for new chunks
+	std::atomic<std::ptrdiff_t> waiting_ = 0;
+	
+	//! Only used for waiting for new chunks
+	std::mutex mutex_;
+	std::condition_variable condition_;
+};
@@ -0,0 +1,413 @@
+#pragma once
+
+#include <cerrno>
+#include <cstddef>
+#include <cstdint>
+
+#include <algorithm>
+#include <span>
+#include <stdexcept>
+#include <string>
+#include <string_view>
+#include <system_error>
+#include <vector>
+
+#include <unistd.h>
+
+#include <zlib.h>
+
+/*!
+ * A zip archive in memory, read through its central directory. The entries
+ * refer to the content of the archive, which must outlive them, nothing is
+ * decompressed until asked for. Split and ZIP64 archives are not supported.
+ */
+struct Zip_archive
+{
+	static constexpr std::uint16_t stored = 0;
+	static constexpr std::uint16_t deflated = 8;
+	
+	struct Entry
+	{
+		std::string_view name_;
+		
+		//! The record of the entry in the central directory
+		std::string_view central_record_;
+		
+		//! The local header including the name and the extra field
+		std::string_view local_header_;
+		
+		//! The compressed data
+		std::string_view data_;
+		
+		//! The local header, the compressed data and the data descriptor, if any
+		std::string_view local_record_;
+		
+		std::uint16_t flags_ = 0;
+		std::uint16_t method_ = stored;
+		std::uint32_t crc_ = 0;
+		std::uint32_t size_ = 0;
+		
+		//! @return True if the entry is not encrypted and is stored or deflated.
+		[[nodiscard]] bool is_readable() const noexcept
+		{
+			return not (flags_ & encrypted_flag) and (method_ == stored or method_ == deflated);
+		}
+	};
+	
+	//! New data of an entry, compressed with the method of the original entry
+	struct Data
+	{
+		std::string data_;
+		std::uint16_t method_ = stored;
+		std::uint32_t crc_ = 0;
+		std::uint32_t size_ = 0;
+	};
+	
+	/*!
+	 * Reads the central directory of the archive @p content.
+	 * 
+	 * @throws std::runtime_error If @p content is not a supported zip archive.
+	 */
+	explicit Zip_archive(std::string_view content)
+		:
+		content_(content)
+	{
+		auto end_record = std::string_view::npos;
+		
+		for (auto position = std::ssize(content) - end_record_size; position >= 0
+			and std::ssize(content) - position <= end_record_size + 0xffff; --position)
+		{
+			if (read32(content, position) == end_signature
+				and position + end_record_size + read16(content, position + 20) == std::ssize(content))
+			{
+				end_record = position;
+				break;
+			}
+		}
+		
+		require(end_record != std::string_view::npos, "no end of central directory record");
+		require(read16(content, end_record + 4) == 0 and read16(content, end_record + 6) == 0, "split archives are not supported");
+		
+		auto count = read16(content, end_record + 10);
+		auto directory_size = read32(content, end_record + 12);
+		auto directory_offset = read32(content, end_record + 16);
+		require(count != 0xffff and directory_offset != 0xffffffff, "ZIP64 archives are not supported");
+		require(std::size_t(directory_offset) + directory_size <= end_record, "central directory out of bounds");
+		comment_ = content.substr(end_record + end_record_size);
+		entries_.reserve(count);
+		
+		for (auto position = std::size_t(directory_offset); entries_.size() != count;)
+		{
+			require(position + central_header_size <= end_record and read32(content, position) == central_signature,
+				"invalid central directory record");
+			
+			auto& entry = entries_.emplace_back();
+			entry.flags_ = read16(content, position + 8);
+			entry.method_ = read16(content, position + 10);
+			entry.crc_ = read32(content, position + 16);
+			auto compressed_size = read32(content, position + 20);
+			entry.size_ = read32(content, position + 24);
+			auto name_size = read16(content, position + 28);
+			auto record_size = central_header_size + name_size + read16(content, position + 30) + read16(content, position + 32);
+			auto local_offset = std::size_t(read32(content, position + 42));
+			require(compressed_size != 0xffffffff and entry.size_ != 0xffffffff and local_offset != 0xffffffff,
+				"ZIP64 archives are not supported");
+			require(position + record_size <= end_record, "central directory record out of bounds");
+			entry.central_record_ = content.substr(position, record_size);
+			entry.name_ = content.substr(position + central_header_size, name_size);
+			position += record_size;
+			
+			require(local_offset + local_header_size <= directory_offset and read32(content, local_offset) == local_signature,
+				"invalid local header");
+			auto header_size = local_header_size + read16(content, local_offset + 26) + read16(content, local_offset + 28);
+			auto data_end = local_offset + header_size + compressed_size;
+			require(data_end <= directory_offset, "entry data out of bounds");
+			entry.local_header_ = content.substr(local_offset, header_size);
+			entry.data_ = content.substr(local_offset + header_size, compressed_size);
+			
+			if (entry.flags_ & descriptor_flag)
+			{
+				// The signature of the data descriptor is optional
+				auto has_signature = data_end + 4 <= directory_offset and read32(content, data_end) == descriptor_signature;
+				data_end += has_signature ? 16 : 12;
+				require(data_end <= directory_offset, "data descriptor out of bounds");
+			}
+			
+			entry.local_record_ = content.substr(local_offset, data_end - local_offset);
+		}
+	}
+	
+	[[nodiscard]] std::span<const Entry> entries() const noexcept
+	{
+		return entries_;
+	}
+	
+	[[nodiscard]] std::string_view comment() const noexcept
+	{
+		return comment_;
+	}
+	
+	/*!
+	 * @return The uncompressed content of @p entry, which is either its data or
+	 * decompressed into @p buffer.
+	 * 
+	 * @throws std::runtime_error If the entry is not readable or its data are
+	 * corrupted, including a size which its compressed data cannot inflate to.
+	 */
+	static std::string_view read(const Entry& entry, std::string& buffer)
+	{
+		require(entry.is_readable(), "unsupported compression of entry", entry.name_);
+		auto result = entry.data_;
+		
+		if (entry.method_ == deflated)
+		{
+			// The size comes from the archive, it only sizes the buffer once it is known to be possible
+			require(entry.size_ <= entry.data_.size() * max_deflate_ratio, "size out of bounds of entry", entry.name_);
+			buffer.resize(std::max<std::size_t>(buffer.size(), entry.size_));
+			auto stream = ::z_stream();
+			require(::inflateInit2(&stream, -MAX_WBITS) == Z_OK, "could not initialize decompression");
+			stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(entry.data_.data()));
+			stream.avail_in = static_cast<uInt>(entry.data_.size());
+			stream.next_out = reinterpret_cast<Bytef*>(buffer.data());
+			stream.avail_out = entry.size_;
+			auto status = ::inflate(&stream, Z_FINISH);
+			::inflateEnd(&stream);
+			require(status == Z_STREAM_END and stream.total_out == entry.size_, "corrupted data of entry", entry.name_);
+			result = std::string_view(buffer.data(), entry.size_);
+		}
+		
+		require(result.size() == entry.size_ and crc(std::span(&result, 1)) == entry.crc_,
+			"corrupted data of entry", entry.name_);
+		
+		return result;
+	}
+	
+	/*!
+	 * @return The concatenation of @p spans compressed with @p method, the
+	 * spans are not joined before compressing.
+	 */
+	static Data compress(std::span<const std::string_view> spans, std::uint16_t method)
+	{
+		auto result = Data();
+		result.method_ = method;
+		result.crc_ = crc(spans);
+		
+		for (auto span : spans)
+		{
+			result.size_ += static_cast<std::uint32_t>(span.size());
+		}
+		
+		if (method == stored)
+		{
+			result.data_.reserve(result.size_);
+			
+			for (auto span : spans)
+			{
+				result.data_ += span;
+			}
+			
+			return result;
+		}
+		
+		auto stream = ::z_stream();
+		require(::deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, -MAX_WBITS, 8, Z_DEFAULT_STRATEGY) == Z_OK,
+			"could not initialize compression");
+		
+		// The bound is enough to compress everything with a single call each
+		result.data_.resize(::deflateBound(&stream, result.size_));
+		stream.next_out = reinterpret_cast<Bytef*>(result.data_.data());
+		stream.avail_out = static_cast<uInt>(result.data_.size());
+		
+		for (auto span : spans)
+		{
+			stream.next_in = reinterpret_cast<Bytef*>(const_cast<char*>(span.data()));
+			stream.avail_in = static_cast<uInt>(span.size());
+			::deflate(&stream, Z_NO_FLUSH);
+		}
+		
+		auto status = ::deflate(&stream, Z_FINISH);
+		result.data_.resize(stream.total_out);
+		::deflateEnd(&stream);
+		require(status == Z_STREAM_END, "could not compress data");
+		
+		return result;
+	}
+	
+	/*!
+	 * Writes the archive to @p fd with the entries replaced by the non-null
+	 * elements of @p replaced, which has an element for each entry. The other
+	 * entries are copied without being decompressed.
+	 * 
+	 * @return The number of bytes written.
+	 * 
+	 * @throws std::system_error If writing fails.
+	 */
+	std::ptrdiff_t write(int fd, std::span<const Data* const> replaced) const
+	{
+		auto writer = Writer(fd);
+		auto directory = std::string();
+		
+		for (std::size_t index = 0; index != entries_.size(); ++index)
+		{
+			const auto& entry = entries_[index];
+			auto record = std::string(entry.central_record_);
+			write32(record, 42, static_cast<std::uint32_t>(writer.written_));
+			
+			if (const auto* data = replaced[index])
+			{
+				auto header = std::string(entry.local_header_);
+				
+				for (auto [target, offset] : {std::pair(&header, 6), std::pair(&record, 8)})
+				{
+					write16(*target, offset, entry.flags_ & ~descriptor_flag);
+					write16(*target, offset + 2, data->method_);
+					write32(*target, offset + 8, data->crc_);
+					write32(*target, offset + 12, static_cast<std::uint32_t>(data->data_.size()));
+					write32(*target, offset + 16, data->size_);
+				}
+				
+				writer.write(header);
+				writer.write(data->data_);
+			}
+			else
+			{
+				writer.write(entry.local_record_);
+			}
+			
+			directory += record;
+		}
+		
+		auto end_record = std::string(content_.substr(content_.size() - comment_.size() - end_record_size, end_record_size));
+		write32(end_record, 12, static_cast<std::uint32_t>(directory.size()));
+		write32(end_record, 16, static_cast<std::uint32_t>(writer.written_));
+		writer.write(directory);
+		writer.write(end_record);
+		writer.write(comment_);
+		writer.flush();
+		
+		return writer.written_;
+	}
+	
+private:
+	static constexpr std::uint32_t local_signature = 0x04034b50;
+	static constexpr std::uint32_t descriptor_signature = 0x08074b50;
+	static constexpr std::uint32_t central_signature = 0x02014b50;
+	static constexpr std::uint32_t end_signature = 0x06054b50;
+	static constexpr std::ptrdiff_t local_header_size = 30;
+	static constexpr std::ptrdiff_t central_header_size = 46;
+	static constexpr std::ptrdiff_t end_record_size = 22;
+	static constexpr std::uint16_t encrypted_flag = 1 << 0;
+	static constexpr std::uint16_t descriptor_flag = 1 << 3;
+	
+	//! Writes small pieces through a buffer and large ones directly
+	struct Writer
+	{
+		static constexpr std::size_t buffer_size = 64 * 1024;
+		
+		explicit Writer(int fd) noexcept
+			:
+			fd_(fd)
+		{
+		}
+		
+		void write(std::string_view data)
+		{
+			if (buffer_.size() + data.size() > buffer_size)
+			{
+				flush();
+			}
+			
+			if (data.size() >= buffer_size)
+			{
+				write_all(data);
+			}
+			else
+			{
+				buffer_ += data;
+			}
+			
+			written_ += std::ssize(data);
+		}
+		
+		void flush()
+		{
+			write_all(buffer_);
+			buffer_.clear();
+		}
+		
+		void write_all(std::string_view data)
+		{
+			while (not data.empty())
+			{
+				auto result = ::write(fd_, data.data(), data.size());
+				
+				if (result == -1 and errno == EINTR)
+				{
+					continue;
+				}
+				else if (result == -1)
+				{
+					throw std::system_error(errno, std::generic_category(), "Could not write archive");
+				}
+				
+				data.remove_prefix(result);
+			}
+		}
+		
+		int fd_;
+		std::string buffer_;
+		std::ptrdiff_t written_ = 0;
+	};
+	
+	//! No deflate stream inflates to more than this many times its size
+	static constexpr std::size_t max_deflate_ratio = 1032;
+	
+	static void require(bool condition, std::string_view what, std::string_view entry_name = {})
+	{
+		if (not condition)
+		{
+			auto message = "Malformed zip archive: " + std::string(what);
+			message += entry_name.empty() ? "" : " ";
+			message += entry_name;
+			throw std::runtime_error(message);
+		}
+	}
+	
+	static std::uint32_t crc(std::span<const std::string_view> spans) noexcept
+	{
+		auto result = ::crc32(0, nullptr, 0);
+		
+		for (auto span : spans)
+		{
+			result = ::crc32(result, reinterpret_cast<const Bytef*>(span.data()), static_cast<uInt>(span.size()));
+		}
+		
+		return static_cast<std::uint32_t>(result);
+	}
+	
+	static std::uint16_t read16(std::string_view content, std::size_t position) noexcept
+	{
+		return static_cast<std::uint16_t>(std::uint8_t(content[position]) | std::uint8_t(content[position + 1]) << 8);
+	}
+	
+	static std::uint32_t read32(std::string_view content, std::size_t position) noexcept
+	{
+		return read16(content, position) | std::uint32_t(read16(content, position + 2)) << 16;
+	}
+	
+	static void write16(std::string& content, std::size_t position, std::uint32_t value) noexcept
+	{
+		content[position] = static_cast<char>(value & 0xff);
+		content[position + 1] = static_cast<char>(value >> 8 & 0xff);
+	}
+	
+	static void write32(std::string& content, std::size_t position, std::uint32_t value) noexcept
+	{
+		write16(content, position, value & 0xffff);
+		write16(content, position + 2, value >> 16);
+	}
+	
+	std::string_view content_;
+	std::string_view comment_;
+	std::vector<Entry> entries_;
+};
@@ -222,6 +222,144 @@ test_file "simple_module/module-info.java" "simple_module/module-info.1.java" -s
 # Module pattern that doesn't match anything
 test_strict "simple_module/module-info.java" "simple_module/module-info.java" -m "nonexistent[.]module"
 
+################################################################################
+# Tests of the cache, the second runs use the results of the first ones
+
+rm -rf target/test_cache
+for run in 1 2; do
+	test_file "Simple.java" "Simple.1.java" -a -s -n "D" --cache-dir=target/test_cache
+	test_strict "Strict.1.java" "Strict.1.java" -n "z" --cache-dir target/test_cache
+	rm -rf target/test_resources/directory
+	run_tool "directory" -a -n "Annotation" --cache-dir=target/test_cache
+	for filename in A a/B a/b/C; do
+		diff -u "target/test_resources/directory/${filename}.java" "target/test_resources/directory/${filename}.1.java"
+	done
+done
+
+# The results with and without -a are cached separately
+run_tool "Simple.java" -n "D" --cache-dir=target/test_cache
+grep "@D" target/test_resources/Simple.java 1>/dev/null
+test_file "Simple.java" "Simple.1.java" -a -n "D" --cache-dir=target/test_cache
+
+# The hits of matchers in cached files are counted
+rm -rf target/test_cache
+for run in 1 2; do
+	./target/bin/jurand -a -n "Annotation" -s --stats --cache-dir=target/test_cache test_resources/directory 2>&1 1>/dev/null \
+		| grep "simple name Annotation matched 3 times" 1>/dev/null
+done
+
+# The same content is cached separately for module-info.java files
+rm -rf target/test_resources/same_content
+mkdir -p target/test_resources/same_content/a target/test_resources/same_content/b
+for run in 1 2; do
+	for filename in a/X b/module-info; do
+		printf 'import b.C;\nmodule a { requires b; }\n' > "target/test_resources/same_content/${filename}.java"
+	done
+	./target/bin/jurand -i -n "C" -m "b" --cache-dir=target/test_cache target/test_resources/same_content/a target/test_resources/same_content/b
+	diff -u <(printf 'module a { requires b; }\n') target/test_resources/same_content/a/X.java
+	diff -u <(printf 'import b.C;\nmodule a { }\n') target/test_resources/same_content/b/module-info.java
+done
+
+################################################################################
+# Tests of jobs files, the results must be the same as of the separate invocations
+
+rm -rf target/test_resources/directory target/test_jobs
+mkdir -p target/test_jobs
+cp -r test_resources/directory target/test_resources/directory
+cp test_resources/Simple.java test_resources/Imports.java target/test_resources
+cp test_resources/Imports.java target/test_jobs/Imports.java
+./target/bin/jurand -i -a -p "static" target/test_jobs/Imports.java
+./target/bin/jurand -i -a -p "util" target/test_jobs/Imports.java
+cat > target/test_jobs/jobs <<'END'
+# Comments and empty lines are ignored
+
+-i -a -n Annotation target/test_resources/directory
+-i -a -s -n 'D' target/test_resources/Simple.java
+-i -a -p 'static' target/test_resources/Imports.java
+-i -a -p "util" target/test_resources/Imports.java target/test_resources/directory/a
+END
+./target/bin/jurand --jobs-file target/test_jobs/jobs
+for filename in A a/B a/b/C; do
+	diff -u "target/test_resources/directory/${filename}.java" "target/test_resources/directory/${filename}.1.java"
+done
+diff -u target/test_resources/Simple.java test_resources/Simple.1.java
+diff -u target/test_resources/Imports.java target/test_jobs/Imports.java
+
+# Strict mode failures are reported for each job
+cp test_resources/Strict.1.java target/test_resources/Strict.1.java
+printf '%s\n' "-i -n Annotation target/test_resources/directory" "-i -s -n z target/test_resources/Strict.1.java" > target/test_jobs/jobs
+./target/bin/jurand --jobs-file=target/test_jobs/jobs | grep "jobs file line 2: strict mode" 1>/dev/null
+if ./target/bin/jurand --jobs-file=target/test_jobs/jobs -n A; then
+	exit 1
+fi
+
+################################################################################
+# Tests of zip archives, their Java entries must be handled as the files are
+
+rm -rf target/test_resources/directory target/test_archive
+mkdir -p target/test_archive
+cp -r test_resources/directory target/test_resources/directory
+echo "not Java" > target/test_resources/directory/data.txt
+(cd target/test_resources/directory && zip -q -r ../../test_archive/sources.jar . && zip -q -0 ../../test_archive/stored.zip A.java)
+cp target/test_archive/sources.jar target/test_archive/original.jar
+diff -u <(echo "target/test_archive/stored.zip!/A.java:"; cat target/test_resources/directory/A.1.java) \
+	<(./target/bin/jurand -a -n "Annotation" target/test_archive/stored.zip)
+./target/bin/jurand -i -a -s -n "Annotation" target/test_archive/sources.jar target/test_archive/stored.zip
+unzip -tq target/test_archive/sources.jar 1>/dev/null
+for filename in A a/B a/b/C; do
+	diff -u <(unzip -p target/test_archive/sources.jar "${filename}.java") "target/test_resources/directory/${filename}.1.java"
+done
+diff -u <(unzip -p target/test_archive/stored.zip A.java) target/test_resources/directory/A.1.java
+unzip -v target/test_archive/stored.zip | grep " Stored .* A.java" 1>/dev/null
+diff <(unzip -v target/test_archive/original.jar | grep "data.txt") <(unzip -v target/test_archive/sources.jar | grep "data.txt")
+
+# Malformed archives are reported
+printf "no archive" > target/test_archive/malformed.jar
+if ./target/bin/jurand -i -n "Annotation" target/test_archive/malformed.jar; [ $? -ne 2 ]; then
+	exit 1
+fi
+
+################################################################################
+# Tests of the server, the invocations are forwarded to it
+
+rm -f target/test_server.socket
+./target/bin/jurand --serve target/test_server.socket &
+server_pid=$!
+trap 'kill ${server_pid} 2>/dev/null' EXIT
+for attempt in $(seq 50); do
+	[ -S target/test_server.socket ] && break
+	sleep 0.1
+done
+export JURAND_SERVER=target/test_server.socket
+
+test_file "Simple.java" "Simple.1.java" -a -s -n "D"
+test_file "Simple.java" "Simple.1.java" -a -p "a[.]b[.]c[.]D"
+test_strict "Strict.1.java" "Strict.1.java" -n "z"
+rm -rf target/test_resources/directory
+run_tool "directory" -a -n "Annotation"
+for filename in A a/B a/b/C; do
+	diff -u "target/test_resources/directory/${filename}.java" "target/test_resources/directory/${filename}.1.java"
+done
+diff -u test_resources/Simple.1.java <(./target/bin/jurand -a -n "D" < test_resources/Simple.java)
+if ./target/bin/jurand -n "D" "nonexisting_file"; [ $? -ne 2 ]; then
+	exit 1
+fi
+./target/bin/jurand --serve target/test_server.socket | grep "Another server" 1>/dev/null
+
+# A client which closed its output does not silence the later ones
+cp test_resources/Strict.1.java target/test_resources/Strict.1.java
+(sleep 0.5; ./target/bin/jurand -i -s -n "Q" target/test_resources/Strict.1.java) | true
+./target/bin/jurand -i -s -n "Q" target/test_resources/Strict.1.java | grep "strict mode" 1>/dev/null
+
+kill ${server_pid}
+wait ${server_pid}
+trap - EXIT
+[ ! -e target/test_server.socket ]
+
+# Without a server the invocation is handled locally
+test_file "Simple.java" "Simple.1.java" -a -n "D"
+unset JURAND_SERVER
+
 ################################################################################
 
 echo "[PASS] Integration tests"